@@ -11,6 +11,8 @@ typedef struct window* (*script_on_create_window_func)();
 
 typedef void (*script_on_init_func)();
 typedef void (*script_on_update_func)(f64 ts);
+typedef void (*script_on_fixed_update_func)(f64 ts);
+typedef u64 (*script_get_state_hash_func)();
 typedef void (*script_on_deinit_func)();
 
 typedef void (*script_on_reload_func)(void*);
@@ -24,6 +26,8 @@ struct script_context {
 
 	script_on_init_func on_init;
 	script_on_update_func on_update;
+	script_on_fixed_update_func on_fixed_update;
+	script_get_state_hash_func get_state_hash;
 	script_on_deinit_func on_deinit;
 
 	script_on_reload_func on_reload;
@@ -61,6 +65,13 @@ static void open_funcs(struct script_context* ctx) {
 	if (!ctx->on_update) {
 		fprintf(stderr, "Failed to locate function `on_update'.\n");
 	}
+
+	/* Optional; Logic that doesn't have it is only ever given the frame's
+	 * timestep. */
+	ctx->on_fixed_update = (script_on_fixed_update_func)dynlib_get_sym(ctx->handle, "on_fixed_update");
+
+	/* Also optional; Only used with `-hash'. */
+	ctx->get_state_hash = (script_get_state_hash_func)dynlib_get_sym(ctx->handle, "get_state_hash");
 	
 	ctx->on_deinit = (script_on_deinit_func)dynlib_get_sym(ctx->handle, "on_deinit");
 	if (!ctx->on_deinit) {
@@ -207,6 +218,20 @@ void call_on_update(struct script_context* ctx, f64 ts) {
 	}
 }
 
+void call_on_fixed_update(struct script_context* ctx, f64 ts) {
+	if (ctx->on_fixed_update) {
+		ctx->on_fixed_update(ts);
+	}
+}
+
+u64 call_get_state_hash(struct script_context* ctx) {
+	if (ctx->get_state_hash) {
+		return ctx->get_state_hash();
+	}
+
+	return 0;
+}
+
 void call_on_deinit(struct script_context* ctx) {
 	if (ctx->on_deinit) {
 		ctx->on_deinit();
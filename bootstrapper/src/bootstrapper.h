@@ -15,4 +15,6 @@ struct window* script_call_create_window(struct script_context* ctx);
 
 void call_on_init(struct script_context* ctx);
 void call_on_update(struct script_context* ctx, f64 ts);
+void call_on_fixed_update(struct script_context* ctx, f64 ts);
+u64 call_get_state_hash(struct script_context* ctx);
 void call_on_deinit(struct script_context* ctx);
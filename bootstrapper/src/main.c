@@ -1,15 +1,157 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "audio.h"
 #include "bootstrapper.h"
+#include "clock.h"
 #include "core.h"
+#include "jobs.h"
 #include "platform.h"
+#include "replay.h"
 #include "res.h"
 #include "video.h"
 
-i32 main() {
-	srand((u32)time(null));
+/* Set from the command line; See `main'. */
+static struct input_recording* recording;
+static bool replaying;
+static bool print_hash;
+
+/* Records or replays the frame's input, if either was asked for. Returns
+ * false once a replay has run out of frames. */
+static bool frame_input(f64* timestep) {
+	if (!recording) { return true; }
+
+	if (replaying) {
+		return replay_input(recording, main_window, timestep);
+	}
+
+	record_input(recording, main_window, *timestep);
+	return true;
+}
+
+static void frame_hash(struct script_context* scripts, u32 frame) {
+	if (print_hash) {
+		printf("Frame %u: %016llx\n", frame, (unsigned long long)call_get_state_hash(scripts));
+	}
+}
+
+static i32 frame_time_cmp(const void* a, const void* b) {
+	const f64 x = *(const f64*)a, y = *(const f64*)b;
+	return (x > y) - (x < y);
+}
+
+/* Runs the game for a number of frames, each stepped by the same timestep
+ * no matter how long it actually took, without a window or a GL context,
+ * and prints how long the frames took. For measuring the logic on machines
+ * without a display; Everything the renderer does on the CPU is still done,
+ * only the OpenGL calls are skipped. */
+static void run_headless(struct script_context* scripts, u32 frame_count, f64 timestep) {
+	f64* times = core_alloc(frame_count * sizeof(f64));
+
+	u64 init_start = get_time();
+
+	scripts_allocate_storage(scripts);
+	call_on_init(scripts);
+
+	const f64 init_time = (f64)(get_time() - init_start) / (f64)get_frequency();
+
+	u32 frames = 0;
+	while (frames < frame_count && !window_should_close(main_window)) {
+		u64 start = get_time();
+
+		update_events(main_window);
+
+		f64 ts = timestep;
+		if (!frame_input(&ts)) { break; }
+
+		const u32 ticks = fixed_clock_advance(&main_clock, ts);
+		for (u32 i = 0; i < ticks; i++) {
+			call_on_fixed_update(scripts, main_clock.step);
+		}
+
+		call_on_update(scripts, ts);
+
+		frame_hash(scripts, frames);
+
+		swap_window(main_window);
+
+		times[frames++] = (f64)(get_time() - start) / (f64)get_frequency();
+	}
+
+	const u64 memory = core_get_memory_usage();
+
+	call_on_deinit(scripts);
+
+	if (frames > 0) {
+		f64 total = 0.0;
+		for (u32 i = 0; i < frames; i++) {
+			total += times[i];
+		}
+
+		qsort(times, frames, sizeof(f64), frame_time_cmp);
+
+		if (replaying) {
+			printf("Replayed %u frames (%u ticks).\n", frames, (u32)main_clock.total_ticks);
+		} else {
+			printf("Ran %u frames at a timestep of %g (%u ticks).\n",
+				frames, timestep, (u32)main_clock.total_ticks);
+		}
+		printf("on_init: %.3f ms\n", init_time * 1000.0);
+		printf("Frame mean: %.3f ms\n", (total / (f64)frames) * 1000.0);
+		printf("Frame p50:  %.3f ms\n", times[(frames - 1) / 2] * 1000.0);
+		printf("Frame p99:  %.3f ms\n", times[((frames - 1) * 99) / 100] * 1000.0);
+		printf("Frame max:  %.3f ms\n", times[frames - 1] * 1000.0);
+
+		/* Only tracked in debug builds. */
+		printf("Memory usage: %.2f KIB\n", (f64)memory / 1024.0);
+	}
+
+	core_free(times);
+}
+
+i32 main(i32 argc, const char** argv) {
+	u32 headless_frames = 0;
+	f64 headless_timestep = 1.0 / 60.0;
+
+	const char* record_path = null;
+	const char* replay_path = null;
+	u64 seed = (u64)time(null);
+
+	for (i32 i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-headless") == 0 && i + 1 < argc) {
+			headless_frames = (u32)atoi(argv[++i]);
+		} else if (strcmp(argv[i], "-timestep") == 0 && i + 1 < argc) {
+			headless_timestep = atof(argv[++i]);
+		} else if (strcmp(argv[i], "-record") == 0 && i + 1 < argc) {
+			record_path = argv[++i];
+		} else if (strcmp(argv[i], "-replay") == 0 && i + 1 < argc) {
+			replay_path = argv[++i];
+		} else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], null, 10);
+		} else if (strcmp(argv[i], "-hash") == 0) {
+			print_hash = true;
+		} else {
+			fprintf(stderr, "Unknown argument `%s'.\n", argv[i]);
+			return -1;
+		}
+	}
+
+	/* A replay is seeded with what the recording was, so that it goes the
+	 * same way. */
+	if (replay_path) {
+		recording = open_input_recording(replay_path);
+		if (!recording) { return -1; }
+
+		replaying = true;
+		seed = get_input_recording_seed(recording);
+	} else if (record_path) {
+		recording = new_input_recording(record_path, seed);
+		if (!recording) { return -1; }
+	}
+
+	seed_random(seed);
 
 	init_time();
 
@@ -20,14 +162,38 @@ i32 main() {
 #endif
 
 	struct script_context* scripts = new_script_context(lib_path);
-	main_window = script_call_create_window(scripts);
 
-	video_init();
+	if (headless_frames > 0) {
+		main_window = new_headless_window(make_v2i(1366, 768));
+		video_init_headless();
+	} else {
+		main_window = script_call_create_window(scripts);
+		video_init();
+	}
+
 	audio_init();
 	res_init();
 
 	init_time();
 
+	if (headless_frames > 0) {
+		run_headless(scripts, headless_frames, headless_timestep);
+
+		free_script_context(scripts);
+
+		deinit_jobs();
+		audio_deinit();
+		res_deinit();
+
+		free_window(main_window);
+
+		if (recording) {
+			free_input_recording(recording);
+		}
+
+		return 0;
+	}
+
 	/* Loading screen */
 	{
 		struct shader sprite_shader = load_shader("res/shaders/sprite.glsl");
@@ -69,15 +235,31 @@ i32 main() {
 
 	u64 now = get_time(), last = now; 
 	f64 timestep = 0.0;
+	u32 frame = 0;
 
 	while (!window_should_close(main_window)) {
 		update_events(main_window);
 
+		/* Replays step by the timesteps that were recorded, rather than
+		 * by how long the frames take now. */
+		if (!frame_input(&timestep)) { break; }
+
 		video_clear();
 
 		script_context_update(scripts, timestep);
+
+		/* The simulation steps in fixed ticks, when the logic has set a
+		 * tick rate; `on_update' then only has to draw, between the last
+		 * two ticks by `main_clock.alpha'. */
+		const u32 ticks = fixed_clock_advance(&main_clock, timestep);
+		for (u32 i = 0; i < ticks; i++) {
+			call_on_fixed_update(scripts, main_clock.step);
+		}
+
 		call_on_update(scripts, timestep);
 
+		frame_hash(scripts, frame++);
+
 		swap_window(main_window);
 
 		audio_update();
@@ -94,9 +276,15 @@ i32 main() {
 	call_on_deinit(scripts);
 	free_script_context(scripts);
 
+	deinit_jobs();
+
 	audio_deinit();
 
 	res_deinit();
 
 	free_window(main_window);
+
+	if (recording) {
+		free_input_recording(recording);
+	}
 }
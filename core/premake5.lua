@@ -13,6 +13,8 @@ project "core"
 	files {
 		"src/audio.c",
 		"src/audio.h",
+		"src/clock.c",
+		"src/clock.h",
 		"src/common.h",
 		"src/core.c",
 		"src/core.h",
@@ -25,6 +27,8 @@ project "core"
 		"src/entity.h",
 		"src/imui.c",
 		"src/imui.h",
+		"src/jobs.c",
+		"src/jobs.h",
 		"src/keytable.c",
 		"src/keytable.h",
 		"src/lsp.c",
@@ -36,8 +40,16 @@ project "core"
 		"src/platform.c",
 		"src/platform.h",
 		"src/renderer.c",
+		"src/replay.c",
+		"src/replay.h",
 		"src/res.c",
 		"src/res.h",
+		"src/rewind.c",
+		"src/rewind.h",
+		"src/rng.c",
+		"src/rng.h",
+		"src/scheduler.c",
+		"src/scheduler.h",
 		"src/table.c",
 		"src/table.h",
 		"src/tiled.c",
@@ -0,0 +1,43 @@
+#include "clock.h"
+
+API struct fixed_clock main_clock = {
+	.max_ticks = 5
+};
+
+void set_tick_rate(struct fixed_clock* clock, f64 rate) {
+	clock->step = rate > 0.0 ? 1.0 / rate : 0.0;
+	clock->accumulator = 0.0;
+	clock->alpha = 0.0;
+}
+
+f64 get_tick_rate(struct fixed_clock* clock) {
+	return clock->step > 0.0 ? 1.0 / clock->step : 0.0;
+}
+
+u32 fixed_clock_advance(struct fixed_clock* clock, f64 ts) {
+	if (clock->step <= 0.0) {
+		clock->frame_ticks = 0;
+		clock->alpha = 1.0;
+		return 0;
+	}
+
+	clock->accumulator += ts;
+
+	u32 ticks = 0;
+	while (clock->accumulator >= clock->step) {
+		clock->accumulator -= clock->step;
+
+		if (ticks < clock->max_ticks) {
+			ticks++;
+		} else {
+			clock->dropped_ticks++;
+		}
+	}
+
+	clock->alpha = clock->accumulator / clock->step;
+
+	clock->frame_ticks = ticks;
+	clock->total_ticks += ticks;
+
+	return ticks;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "common.h"
+
+/* Fixed timestep.
+ *
+ * Simulating with the frame's timestep makes the outcome depend on the frame
+ * rate: Fast objects tunnel through walls on slow frames, and collision
+ * response behaves differently at different rates. A fixed clock collects
+ * the time that each frame takes and hands it back out in ticks of a fixed
+ * length, so that the simulation always steps by the same amount.
+ *
+ * `fixed_clock_advance' is called once a frame with the frame's timestep,
+ * and returns how many ticks to simulate. What is left over, less than one
+ * tick, is carried to the next frame; `alpha' is how far into the next tick
+ * the frame is, from zero to one, for drawing things between where they were
+ * on the last two ticks.
+ *
+ * If the simulation can't keep up, each frame would need more ticks than
+ * the one before it. To stop that from spiralling, no more than `max_ticks'
+ * are run in a frame, and any time beyond that is dropped, slowing the game
+ * down instead.
+ *
+ * A clock with a tick rate of zero is off, and never ticks. */
+
+struct fixed_clock {
+	f64 step;
+	u32 max_ticks;
+
+	f64 accumulator;
+	f64 alpha;
+
+	/* Ticks run on the last frame, in total, and dropped in total. */
+	u32 frame_ticks;
+	u64 total_ticks;
+	u64 dropped_ticks;
+};
+
+/* The clock that the bootstrapper runs `on_fixed_update' from. Off unless
+ * a tick rate is set. */
+API extern struct fixed_clock main_clock;
+
+API void set_tick_rate(struct fixed_clock* clock, f64 rate);
+API f64 get_tick_rate(struct fixed_clock* clock);
+
+API u32 fixed_clock_advance(struct fixed_clock* clock, f64 ts);
@@ -60,3 +60,24 @@ typedef double f64;
 	#define force_inline static inline
 	#define dont_inline
 #endif
+
+/* Atomic access to single words, for the few places that share data between
+ * threads without a mutex. The loads and stores have no ordering, so they're
+ * only for values that are whole on their own. `spin_lock' and `spin_unlock'
+ * take and give back a lock held in a `volatile i32' that starts as zero. */
+#if defined(_MSC_VER)
+	#include <intrin.h>
+
+	/* Plain 64-bit accesses are atomic on 64-bit targets. */
+	#define atomic_load_u64(p_) (*(volatile u64*)(p_))
+	#define atomic_store_u64(p_, v_) (*(volatile u64*)(p_) = (v_))
+
+	#define spin_lock(p_) while (_InterlockedExchange((volatile long*)(p_), 1)) {}
+	#define spin_unlock(p_) _InterlockedExchange((volatile long*)(p_), 0)
+#else
+	#define atomic_load_u64(p_) __atomic_load_n((p_), __ATOMIC_RELAXED)
+	#define atomic_store_u64(p_, v_) __atomic_store_n((p_), (v_), __ATOMIC_RELAXED)
+
+	#define spin_lock(p_) while (__atomic_exchange_n((p_), 1, __ATOMIC_ACQUIRE)) {}
+	#define spin_unlock(p_) __atomic_store_n((p_), 0, __ATOMIC_RELEASE)
+#endif
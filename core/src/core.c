@@ -1,8 +1,10 @@
+#include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "core.h"
+#include "rng.h"
 #include "vector.h"
 
 u64 elf_hash(const u8* data, u32 size) {
@@ -31,6 +33,125 @@ u32 str_id(const char* str) {
 	return r;
 }
 
+struct type_registry_el {
+	u64 hash;
+	u32 index;
+	bool taken;
+};
+
+API u64 type_cache[type_cache_size];
+
+/* Everything here is guarded by `lock', but the cache, which is read
+ * without it. */
+static struct {
+	volatile i32 lock;
+
+	char** names;
+	u32 count;
+	u32 capacity;
+
+	struct type_registry_el* table;
+	u32 table_capacity;
+} type_registry;
+
+static u64 fnv1a(const char* str) {
+	u64 hash = 0xcbf29ce484222325;
+
+	for (const char* c = str; *c; c++) {
+		hash ^= (u8)*c;
+		hash *= 0x100000001b3;
+	}
+
+	return hash;
+}
+
+static struct type_registry_el* find_type_el(struct type_registry_el* els, u32 capacity, u64 hash, const char* name) {
+	u32 idx = (u32)(hash & (capacity - 1));
+
+	for (;;) {
+		struct type_registry_el* el = els + idx;
+		if (!el->taken || (el->hash == hash && strcmp(type_registry.names[el->index], name) == 0)) {
+			return el;
+		}
+
+		idx = (idx + 1) & (capacity - 1);
+	}
+}
+
+static void type_registry_resize(u32 capacity) {
+	struct type_registry_el* els = core_calloc(capacity, sizeof(struct type_registry_el));
+
+	for (u32 i = 0; i < type_registry.table_capacity; i++) {
+		struct type_registry_el* el = type_registry.table + i;
+		if (!el->taken) { continue; }
+
+		*find_type_el(els, capacity, el->hash, type_registry.names[el->index]) = *el;
+	}
+
+	if (type_registry.table) { core_free(type_registry.table); }
+
+	type_registry.table = els;
+	type_registry.table_capacity = capacity;
+}
+
+u32 _type_index(const char* name) {
+	spin_lock(&type_registry.lock);
+
+	if (type_registry.count * 2 >= type_registry.table_capacity) {
+		type_registry_resize(type_registry.table_capacity < 64 ? 64 : type_registry.table_capacity * 2);
+	}
+
+	const u64 hash = fnv1a(name);
+
+	struct type_registry_el* el = find_type_el(type_registry.table, type_registry.table_capacity, hash, name);
+	if (!el->taken) {
+		assert(type_registry.count < max_type_count);
+
+		if (type_registry.count >= type_registry.capacity) {
+			type_registry.capacity = type_registry.capacity < 32 ? 32 : type_registry.capacity * 2;
+			type_registry.names = core_realloc(type_registry.names, type_registry.capacity * sizeof(char*));
+		}
+
+		el->taken = true;
+		el->hash = hash;
+		el->index = type_registry.count;
+
+		type_registry.names[type_registry.count++] = copy_string(name);
+	}
+
+	const u32 index = el->index;
+
+	spin_unlock(&type_registry.lock);
+
+	const u64 addr = (u64)(uintptr_t)name;
+	assert(addr >> 48 == 0);
+
+	atomic_store_u64(type_cache + ((addr ^ (addr >> 10)) & (type_cache_size - 1)), (addr << 16) | index);
+
+	return index;
+}
+
+u32 get_type_count() {
+	spin_lock(&type_registry.lock);
+	const u32 count = type_registry.count;
+	spin_unlock(&type_registry.lock);
+
+	return count;
+}
+
+const char* get_type_name(u32 index) {
+	spin_lock(&type_registry.lock);
+	const char* name = index < type_registry.count ? type_registry.names[index] : null;
+	spin_unlock(&type_registry.lock);
+
+	return name;
+}
+
+/* Only when no other thread is resolving types, as `free_dynlib' does. */
+void flush_type_cache() {
+	memset(type_cache, 0, sizeof(type_cache));
+}
+
 char* copy_string(const char* src) {
 	const u32 len = (u32)strlen(src);
 
@@ -158,15 +279,13 @@ u64 core_get_memory_usage() {
 #endif
 
 i32 random_int(i32 min, i32 max) {
-	return (rand() % (max - min + 1)) + min;
+	return rng_int(thread_rng(), min, max);
 }
 
 f64 random_f64(f64 min, f64 max) {
-	f64 scale = rand() / (f64)RAND_MAX;
-	return min + scale * (max - min);
+	return rng_f64(thread_rng(), min, max);
 }
 
 bool random_chance(f64 chance) {
-	f64 scale = rand() / (f64)RAND_MAX;
-	return (scale * (100.0 - 0.0)) <= chance;
+	return rng_chance(thread_rng(), chance);
 }
@@ -19,13 +19,51 @@ API u64 elf_hash(const u8* data, u32 size);
  * that string. Not to be used in place of a hash function. */
 API u32 str_id(const char* str);
 
+/* `id' is the type's index in the type registry. */
 struct type_info {
 	u32 id;
 	u32 size;
 	const char* name;
 };
 
-#define type_info(t_) ((struct type_info) { str_id(#t_), sizeof(t_), (#t_) })
+#define type_info(t_) ((struct type_info) { type_index(#t_), sizeof(t_), (#t_) })
+
+/* Type registry.
+ *
+ * Every distinct type name is given a small, dense index the first time it
+ * is seen. Indices are process-wide and never reused, so they can be used to
+ * index arrays directly; The ECS uses them to find a world's pools.
+ *
+ * The names that `type_info' passes in are string literals, so the index is
+ * cached in a direct-mapped table keyed by the address of the literal. After
+ * the first lookup from a given call site, resolving a type is a compare and
+ * a load. The cache is flushed whenever a dynamic library is closed, because
+ * its literals go away with it and the addresses may be reused.
+ *
+ * Types can be resolved from any thread. Each cache entry is a single word,
+ * holding the address of the literal in its top 48 bits and the index in its
+ * bottom 16, so it's always read whole; User space addresses fit in 48 bits
+ * on every platform that's supported. A miss takes a lock. */
+#define type_cache_size 1024
+#define max_type_count 0x10000
+
+API extern u64 type_cache[type_cache_size];
+
+API u32 _type_index(const char* name);
+API u32 get_type_count();
+API const char* get_type_name(u32 index);
+API void flush_type_cache();
+
+force_inline u32 type_index(const char* name) {
+	const u64 addr = (u64)(uintptr_t)name;
+	const u64 entry = atomic_load_u64(type_cache + ((addr ^ (addr >> 10)) & (type_cache_size - 1)));
+
+	if (entry >> 16 == addr) {
+		return (u32)(entry & 0xFFFF);
+	}
+
+	return _type_index(name);
+}
 
 API char* copy_string(const char* src);
 
@@ -36,6 +74,9 @@ API void core_free(void* ptr);
 
 API u64 core_get_memory_usage();
 
+/* Drawn from the calling thread's generator; See `rng.h'. Every run with
+ * the same seed gets the same numbers, in the same order. */
+API void seed_random(u64 seed);
 API i32 random_int(i32 min, i32 max);
 API f64 random_f64(f64 min, f64 max);
 API bool random_chance(f64 chance);
@@ -34,6 +34,40 @@ static void render_queue_flush(struct render_queue* queue, struct renderer* rend
 	queue->count = 0;
 }
 
+void store_previous_positions(struct world* world) {
+	for (view(world, view, type_info(struct transform), type_info(struct interpolated))) {
+		struct transform* t = view_get(&view, struct transform);
+		struct interpolated* i = view_get(&view, struct interpolated);
+
+		i->previous = t->position;
+		i->valid = true;
+	}
+}
+
+void begin_interpolation(struct world* world, f64 alpha) {
+	const f32 a = (f32)alpha;
+
+	for (view(world, view, type_info(struct transform), type_info(struct interpolated))) {
+		struct transform* t = view_get(&view, struct transform);
+		struct interpolated* i = view_get(&view, struct interpolated);
+
+		i->current = t->position;
+
+		if (i->valid) {
+			t->position = v2f_add(i->previous, v2f_scale(v2f_sub(i->current, i->previous), a));
+		}
+	}
+}
+
+void end_interpolation(struct world* world) {
+	for (view(world, view, type_info(struct transform), type_info(struct interpolated))) {
+		struct transform* t = view_get(&view, struct transform);
+		struct interpolated* i = view_get(&view, struct interpolated);
+
+		t->position = i->current;
+	}
+}
+
 void apply_lights(struct world* world, struct renderer* renderer) {
 	for (view(world, view, type_info(struct transform), type_info(struct light))) {
 		struct transform* transform = view_get(&view, struct transform);
@@ -48,9 +82,11 @@ void apply_lights(struct world* world, struct renderer* renderer) {
 void render_system(struct world* world, struct renderer* renderer, f64 ts) {
 	render_queue.count = 0;
 
-	for (view(world, view, type_info(struct transform), type_info(struct sprite))) {
-		struct transform* t = view_get(&view, struct transform);
-		struct sprite* s = view_get(&view, struct sprite);
+	struct group* sprites = get_group(world, type_info(struct transform), type_info(struct sprite));
+
+	for (group_view(sprites, view)) {
+		struct transform* t = group_view_get(&view, struct transform);
+		struct sprite* s = group_view_get(&view, struct sprite);
 
 		if (s->hidden) { continue; }
 
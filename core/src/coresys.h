@@ -47,8 +47,33 @@ struct animated_sprite {
 	f32 rotation;
 };
 
+/* For drawing between fixed ticks (see `clock.h'). Entities with one of
+ * these are drawn where they would be at the frame's time, between where
+ * they were on the last two ticks, instead of jumping from one to the next.
+ *
+ * `store_previous_positions' is called before each tick.
+ * `begin_interpolation' moves the transforms to where they should be drawn,
+ * and `end_interpolation' puts them back; Nothing should move them in
+ * between. */
+struct interpolated {
+	v2f previous;
+	v2f current;
+
+	/* Not until a tick has stored the previous position, so that new
+	 * entities don't slide in from the origin. */
+	bool valid;
+};
+
+API void store_previous_positions(struct world* world);
+API void begin_interpolation(struct world* world, f64 alpha);
+API void end_interpolation(struct world* world);
+
 API void apply_lights(struct world* world, struct renderer* renderer);
 
 /* Process all the entities in the world that have a sprite and a transform,
- * or an animated sprite and a transform. */
+ * or an animated sprite and a transform.
+ *
+ * Sprites are drawn through a group of transform and sprite, which the
+ * system creates the first time it runs if it doesn't exist yet. Groups
+ * that own the transform pool must therefore nest with that one. */
 API void render_system(struct world* world, struct renderer* renderer, f64 ts);
@@ -1,5 +1,6 @@
 #include <dlfcn.h>
 
+#include "core.h"
 #include "dynlib.h"
 
 void* open_dynlib(const char* path) {
@@ -8,6 +9,9 @@ void* open_dynlib(const char* path) {
 
 void close_dynlib(void* handle) {
 	dlclose(handle);
+
+	/* Any type names cached from the library are now dangling. */
+	flush_type_cache();
 }
 
 void* dynlib_get_sym(void* handle, const char* name) {
@@ -1,8 +1,10 @@
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "entity.h"
+#include "jobs.h"
 
 API const entity null_entity = (UINT64_MAX);
 API const entity_id null_entity_id = (UINT32_MAX);
@@ -21,223 +23,435 @@ entity make_handle(entity_id id, entity_version v) {
 
 struct pool;
 
-#define free_queue_size 256
-#define pool_table_load_factor 0.75
+/* Component data lives in fixed-size pages, so growing a pool never moves
+ * the components that are already in it, and pointers returned from
+ * `get_component' stay valid while other components are added. Each page
+ * holds a power-of-two number of components, so finding one by its dense
+ * index is a shift and a mask.
+ *
+ * The sparse array is paged too, and its pages are only allocated when an
+ * entity ID in their range is added. A high entity ID costs one page, not
+ * an array as long as the ID. */
+#define pool_page_size 16384
+#define sparse_page_shift 12
+#define sparse_page_entries (1 << sparse_page_shift)
+
+struct group {
+	u64 mask[signature_words];
+	struct pool* pools[view_max];
+	u32 types[view_max];
+	u32 pool_count;
+
+	u32 count;
+
+	/* Entities that became members since the group was last
+	 * sorted. See `world_flush_groups'. */
+	entity* pending;
+	u32 pending_count;
+	u32 pending_capacity;
 
-struct pool_table_el {
-	u32 key;
-	u32 val_idx;
-	bool taken;
+	struct world* world;
 };
 
 struct world {
-	struct pool_table_el* pool_table;
-	u32 pool_table_count;
-	u32 pool_table_capacity;
-
-	struct pool* pools;
+	/* Indexed directly by the registry index of the component type,
+	 * see `type_index'. Null for types that the world hasn't seen. */
+	struct pool** type_pools;
+	u32 type_pool_capacity;
+
+	/* Every pool in the world, in the order they were created. Each pool
+	 * is allocated on its own so that pointers to it stay valid. */
+	struct pool** pools;
 	u32 pool_count;
 	u32 pool_capacity;
 
+	/* Sorted by the number of owned pools, smallest first, so that
+	 * nested groups are always sorted after the groups they nest in. */
+	struct group** groups;
+	u32 group_count;
+	u32 group_capacity;
+
 	entity* entities;
 	u32 entity_count;
 	u32 entity_capacity;
 
+	/* `signature_words' words per entity ID. */
+	u64* signatures;
+
 	u32 alive_entity_count;
 
 	entity_id avail_id;
 
-	i32 iteration_scope;
+	/* See `lock_world'. */
+	bool locked;
+
+	/* See `world_tick'. */
+	u32 tick;
+
+	/* Indexed by entity ID; Which scene the entity is in, if any, and
+	 * where. Only allocated once an entity is added to a scene. */
+	struct scene_slot* scene_slots;
+	u32 scene_slot_capacity;
+
+	/* Every scene made for the world, so that snapshots can find them. */
+	struct scene** scenes;
+	u32 scene_count;
+	u32 scene_capacity;
+};
+
+struct scene_slot {
+	struct scene* scene;
+	u32 idx;
+};
+
+struct scene {
+	char* name;
+
+	entity* entities;
+	u32 count;
+	u32 capacity;
 
-	void* free_queue[free_queue_size];
-	u32 free_queue_count;
+	struct world* world;
 };
 
-static void world_push_free(struct world* world, void* ptr);
+#define assert_unlocked(w_) \
+	assert(!(w_)->locked && "The world can't be changed structurally while it is locked.")
 
 struct pool {
-	i32* sparse;
-	u32 sparse_capacity;
+	i32** sparse_pages;
+	u32 sparse_page_count;
 
 	entity* dense;
-	u32 dense_count;
 	u32 dense_capacity;
 
-	void* data;
+	/* The tick that each component was last changed on, parallel to
+	 * `dense'. Null unless tracking was turned on with
+	 * `set_component_tracking'. */
+	u32* changed;
+
+	u8** pages;
+	u32 page_count;
+	u32 page_shift;
+	u32 page_mask;
+
 	u32 count;
-	u32 capacity;
 
 	struct type_info type;
 
 	struct world* world;
 
+	bool owned;
+
+	/* Null unless the pool is a structure of arrays; See
+	 * `set_component_soa'. Each field is stored in its own array within a
+	 * page, at `field_offsets'. */
+	struct component_field* fields;
+	u32* field_offsets;
+	u32 field_count;
+
+	u32 page_bytes;
+
 	component_create_func on_create;
 	component_destroy_func on_destroy;
+
+	component_snapshot_func on_save;
+	component_snapshot_func on_load;
 };
 
+/* Components of structure of arrays pools are gathered into a buffer on the
+ * stack when they need to be handed out whole. */
+#define soa_max_component_size 256
+
 static void init_pool(struct pool* pool, struct world* world, struct type_info t) {
 	*pool = (struct pool) { 0 };
 
 	pool->type = t;
+	pool->type.name = get_type_name(t.id);
 
 	pool->world = world;
+
+	const u32 size = t.size > 0 ? t.size : 1;
+	while (pool->page_shift < 31 && (2u << pool->page_shift) * size <= pool_page_size) {
+		pool->page_shift++;
+	}
+	pool->page_mask = (1u << pool->page_shift) - 1;
+
+	pool->page_bytes = (pool->page_mask + 1) * pool->type.size;
 }
 
-static void* pool_get(struct pool* pool, entity e);
+static void pool_call(struct pool* pool, component_create_func f, u32 idx);
 
 static void deinit_pool(struct pool* pool) {	
 	if (pool->on_destroy) {
-		for (u32 i = 0; i < pool->dense_count; i++) {
-			const entity e = pool->dense[i];
+		for (u32 i = 0; i < pool->count; i++) {
+			pool_call(pool, pool->on_destroy, i);
+		}
+	}
 
-			void* ptr = pool_get(pool, e);
-			pool->on_destroy(pool->world, e, ptr);
+	for (u32 i = 0; i < pool->sparse_page_count; i++) {
+		if (pool->sparse_pages[i]) {
+			core_free(pool->sparse_pages[i]);
 		}
 	}
 
-	if (pool->sparse) {
-		core_free(pool->sparse);
+	for (u32 i = 0; i < pool->page_count; i++) {
+		core_free(pool->pages[i]);
+	}
+
+	if (pool->sparse_pages) {
+		core_free(pool->sparse_pages);
+	}
+	if (pool->pages) {
+		core_free(pool->pages);
 	}
 	if (pool->dense) {
 		core_free(pool->dense);
 	}
-	if (pool->data) {
-		core_free(pool->data);
+	if (pool->changed) {
+		core_free(pool->changed);
+	}
+	if (pool->fields) {
+		core_free(pool->fields);
+		core_free(pool->field_offsets);
 	}
 }
 
 static bool pool_has(struct pool* pool, entity e) {
 	const entity_id id = get_entity_id(e);
-	return (id < pool->sparse_capacity) && (pool->sparse[id] != -1);
+	const u32 page = id >> sparse_page_shift;
+
+	return page < pool->sparse_page_count && pool->sparse_pages[page] &&
+		pool->sparse_pages[page][id & (sparse_page_entries - 1)] != -1;
+}
+
+static i32* pool_sparse_slot(struct pool* pool, entity_id id) {
+	return pool->sparse_pages[id >> sparse_page_shift] + (id & (sparse_page_entries - 1));
 }
 
 static i32 pool_sparse_idx(struct pool* pool, entity e) {
-	return pool->sparse[get_entity_id(e)];
+	return *pool_sparse_slot(pool, get_entity_id(e));
 }
 
-static void* pool_add(struct pool* pool, entity e, void* init) {
-	if (pool->count >= pool->capacity) {
-		u32 capacity = pool->capacity < 8 ? 8 : pool->capacity * 2;
-		void* new_allocation = core_alloc(capacity * pool->type.size);
-		memcpy(new_allocation, pool->data, pool->capacity * pool->type.size);
-		if (pool->data) {
-			if (pool->world->iteration_scope <= 0) {
-				core_free(pool->data);
-			} else {
-				world_push_free(pool->world, pool->data);
-			}
-		}
+static void* pool_get_by_idx(struct pool* pool, i32 idx) {
+	return pool->pages[(u32)idx >> pool->page_shift] + ((u32)idx & pool->page_mask) * pool->type.size;
+}
+
+static void* pool_get(struct pool* pool, entity e) {
+	assert(!pool->fields && "Components in a structure of arrays pool can't be pointed to; "
+		"Use `read_component' and `write_component'.");
+	return pool_get_by_idx(pool, pool_sparse_idx(pool, e));
+}
+
+static void* pool_get_field(struct pool* pool, u32 field, u32 idx) {
+	return pool->pages[idx >> pool->page_shift] + pool->field_offsets[field] +
+		(idx & pool->page_mask) * pool->fields[field].size;
+}
 
-		pool->data = new_allocation;
-		pool->capacity = capacity;
+static void pool_touch(struct pool* pool, u32 idx) {
+	if (pool->changed) {
+		pool->changed[idx] = pool->world->tick;
 	}
+}
 
-	void* ptr = &((u8*)pool->data)[(pool->count++) * pool->type.size];
+static void pool_write(struct pool* pool, u32 idx, const void* src) {
+	pool_touch(pool, idx);
 
-	const u32 eid = get_entity_id(e);
-	if (eid >= pool->sparse_capacity) {
-		const u32 new_cap = eid + 1;
-		i32* alloc = core_alloc(new_cap * sizeof(i32));
-		memcpy(alloc, pool->sparse, pool->sparse_capacity * sizeof(i32));
-		if (pool->sparse) {
-			if (pool->world->iteration_scope <= 0) {
-				core_free(pool->sparse);
-			} else {
-				world_push_free(pool->world, pool->sparse);
-			}
+	if (!pool->fields) {
+		memcpy(pool_get_by_idx(pool, (i32)idx), src, pool->type.size);
+		return;
+	}
+
+	for (u32 i = 0; i < pool->field_count; i++) {
+		memcpy(pool_get_field(pool, i, idx), (const u8*)src + pool->fields[i].offset, pool->fields[i].size);
+	}
+}
+
+static void pool_read(struct pool* pool, u32 idx, void* dst) {
+	if (!pool->fields) {
+		memcpy(dst, pool_get_by_idx(pool, (i32)idx), pool->type.size);
+		return;
+	}
+
+	/* Padding isn't stored. */
+	memset(dst, 0, pool->type.size);
+
+	for (u32 i = 0; i < pool->field_count; i++) {
+		memcpy((u8*)dst + pool->fields[i].offset, pool_get_field(pool, i, idx), pool->fields[i].size);
+	}
+}
+
+static void pool_move(struct pool* pool, u32 dst, u32 src) {
+	if (pool->changed) {
+		pool->changed[dst] = pool->changed[src];
+	}
+
+	if (!pool->fields) {
+		memcpy(pool_get_by_idx(pool, (i32)dst), pool_get_by_idx(pool, (i32)src), pool->type.size);
+		return;
+	}
+
+	for (u32 i = 0; i < pool->field_count; i++) {
+		memcpy(pool_get_field(pool, i, dst), pool_get_field(pool, i, src), pool->fields[i].size);
+	}
+}
+
+/* Calls a create or destroy function. Structure of arrays components are
+ * gathered for it and scattered back afterwards. */
+static void pool_call(struct pool* pool, component_create_func f, u32 idx) {
+	const entity e = pool->dense[idx];
+
+	if (!pool->fields) {
+		f(pool->world, e, pool_get_by_idx(pool, (i32)idx));
+		return;
+	}
+
+	u8 tmp[soa_max_component_size];
+	pool_read(pool, idx, tmp);
+	f(pool->world, e, tmp);
+	pool_write(pool, pool_sparse_idx(pool, e), tmp);
+}
+
+static void pool_reserve_sparse(struct pool* pool, entity_id id) {
+	const u32 page = id >> sparse_page_shift;
+
+	if (page >= pool->sparse_page_count) {
+		u32 page_count = pool->sparse_page_count < 8 ? 8 : pool->sparse_page_count;
+		while (page_count <= page) { page_count *= 2; }
+
+		pool->sparse_pages = core_realloc(pool->sparse_pages, page_count * sizeof(i32*));
+		for (u32 i = pool->sparse_page_count; i < page_count; i++) {
+			pool->sparse_pages[i] = null;
 		}
 
-		pool->sparse = alloc;
+		pool->sparse_page_count = page_count;
+	}
+
+	if (!pool->sparse_pages[page]) {
+		pool->sparse_pages[page] = core_alloc(sparse_page_entries * sizeof(i32));
+		memset(pool->sparse_pages[page], 0xff, sparse_page_entries * sizeof(i32));
+	}
+}
+
+/* Make room for `count' components in total. Only ever appends pages. */
+static void pool_reserve(struct pool* pool, u32 count) {
+	if (count > pool->dense_capacity) {
+		u32 dense_capacity = pool->dense_capacity < 8 ? 8 : pool->dense_capacity;
+		while (dense_capacity < count) { dense_capacity *= 2; }
+
+		pool->dense = core_realloc(pool->dense, dense_capacity * sizeof(entity));
+		pool->dense_capacity = dense_capacity;
 
-		for (u32 i = pool->sparse_capacity; i < new_cap; i++) {
-			pool->sparse[i] = -1;
+		if (pool->changed) {
+			pool->changed = core_realloc(pool->changed, dense_capacity * sizeof(u32));
 		}
-		pool->sparse_capacity = new_cap;
 	}
 
-	pool->sparse[eid] = (i32)pool->dense_count;
+	const u32 page_count = (count + pool->page_mask) >> pool->page_shift;
+	if (page_count > pool->page_count) {
+		pool->pages = core_realloc(pool->pages, page_count * sizeof(u8*));
 
-	if (pool->dense_count >= pool->dense_capacity) {
-		u32 dense_capacity = pool->dense_capacity < 8 ? 8 : pool->dense_capacity * 2;
-		void* alloc = core_alloc(dense_capacity * sizeof(entity));
-		memcpy(alloc, pool->dense, pool->dense_capacity * sizeof(entity));
-		if (pool->dense) {
-			if (pool->world->iteration_scope <= 0) {
-				core_free(pool->dense);
-			} else {
-				world_push_free(pool->world, pool->dense);
-			}
+		for (u32 i = pool->page_count; i < page_count; i++) {
+			pool->pages[i] = core_alloc(pool->page_bytes);
 		}
 
-		pool->dense_capacity = dense_capacity;
-		pool->dense = alloc;
+		pool->page_count = page_count;
 	}
+}
+
+static void* pool_add(struct pool* pool, entity e, void* init) {
+	pool_reserve(pool, pool->count + 1);
+	pool_reserve_sparse(pool, get_entity_id(e));
+
+	const u32 idx = pool->count++;
 
-	pool->dense[pool->dense_count++] = e;
+	*pool_sparse_slot(pool, get_entity_id(e)) = (i32)idx;
+	pool->dense[idx] = e;
 
-	memcpy(ptr, init, pool->type.size);
+	pool_write(pool, idx, init);
 
 	if (pool->on_create) {
-		pool->on_create(pool->world, e, ptr);
+		pool_call(pool, pool->on_create, idx);
 	}
 
-	return ptr;
+	return pool->fields ? null : pool_get_by_idx(pool, pool_sparse_idx(pool, e));
 }
 
 static void pool_remove(struct pool* pool, entity e) {
-	const i32 pos = pool->sparse[get_entity_id(e)];
+	const i32 pos = pool_sparse_idx(pool, e);
 
 	if (pool->on_destroy) {
-		void* ptr = &((char*)pool->data)[pos * pool->type.size];
-		pool->on_destroy(pool->world, e, ptr);
+		pool_call(pool, pool->on_destroy, (u32)pos);
 	}
 
-	const entity other = pool->dense[pool->dense_count - 1];
+	const i32 last = (i32)pool->count - 1;
+	const entity other = pool->dense[last];
 
-	pool->sparse[get_entity_id(other)] = pos;
+	*pool_sparse_slot(pool, get_entity_id(other)) = pos;
 	pool->dense[pos] = other;
-	pool->sparse[get_entity_id(e)] = -1;
-
-	pool->dense_count--;
+	*pool_sparse_slot(pool, get_entity_id(e)) = -1;
 
-	memmove(
-		&((char*)pool->data)[pos * pool->type.size],
-		&((char*)pool->data)[(pool->count - 1) * pool->type.size],
-		pool->type.size);
+	if (pos != last) {
+		pool_move(pool, (u32)pos, (u32)last);
+	}
 
 	pool->count--;
 }
 
-static void* pool_get_by_idx(struct pool* pool, i32 idx) {
-	return &((char*)pool->data)[idx * pool->type.size];
+static u64* entity_signature(struct world* world, entity e) {
+	return world->signatures + (u64)get_entity_id(e) * signature_words;
 }
 
-static void* pool_get(struct pool* pool, entity e) {
-	return pool_get_by_idx(pool, pool_sparse_idx(pool, e));
+static void signature_set(u64* sig, u32 type) {
+	sig[type >> 6] |= (u64)1 << (type & 63);
 }
 
-static void world_push_free(struct world* world, void* ptr) {
-	if (world->free_queue_count < free_queue_size) {
-		world->free_queue[world->free_queue_count++] = ptr;
-		return;
-	}
+static void signature_clear(u64* sig, u32 type) {
+	sig[type >> 6] &= ~((u64)1 << (type & 63));
+}
 
-	assert(0 && "Free queue too small.");
+static bool signature_test(const u64* sig, u32 type) {
+	return (sig[type >> 6] >> (type & 63)) & 1;
 }
 
-static void world_clear_free_queue(struct world* world) {
-	for (u32 i = 0; i < world->free_queue_count; i++) {
-		core_free(world->free_queue[i]);
+static bool signature_contains(const u64* sig, const u64* mask) {
+	for (u32 i = 0; i < signature_words; i++) {
+		if ((sig[i] & mask[i]) != mask[i]) {
+			return false;
+		}
 	}
 
-	world->free_queue_count = 0;
+	return true;
 }
 
-static entity generate_entity(struct world* world) {
-	if (world->entity_count >= world->entity_capacity) {
-		world->entity_capacity = world->entity_capacity < 8 ? 8 : world->entity_capacity * 2;
-		world->entities = core_realloc(world->entities, world->entity_capacity * sizeof(entity));
+/* Index of the lowest set bit of a non-zero word. */
+static u32 lowest_bit(u64 v) {
+	static const u8 table[64] = {
+		0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+		62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+		63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+		46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+	};
+
+	return table[((v & (~v + 1)) * 0x03f79d71b4cb0a89) >> 58];
+}
+
+/* Make room for `count' entity IDs in total. */
+static void world_reserve_entities(struct world* world, u32 count) {
+	if (count > world->entity_capacity) {
+		u32 capacity = world->entity_capacity < 8 ? 8 : world->entity_capacity;
+		while (capacity < count) { capacity *= 2; }
+
+		world->entities = core_realloc(world->entities, capacity * sizeof(entity));
+		world->signatures = core_realloc(world->signatures,
+			(u64)capacity * signature_words * sizeof(u64));
+		world->entity_capacity = capacity;
 	}
+}
+
+static entity generate_entity(struct world* world) {
+	world_reserve_entities(world, world->entity_count + 1);
+
+	memset(world->signatures + (u64)world->entity_count * signature_words, 0, signature_words * sizeof(u64));
 
 	const entity e = make_handle(world->entity_count, 0);
 	world->entities[world->entity_count++] = e;
@@ -264,120 +478,312 @@ static void release_entity(struct world* world, entity e, entity_version desired
 	world->avail_id = id;
 }
 
-static struct pool_table_el* find_pool_el(struct pool_table_el* els, u32 capacity, u32 key) {
-	u32 idx = key % capacity;
+static struct pool* get_pool_no_create(struct world* world, struct type_info type) {
+	return type.id < world->type_pool_capacity ? world->type_pools[type.id] : null;
+}
+
+static struct pool* get_pool(struct world* world, struct type_info type) {
+	struct pool* pool = get_pool_no_create(world, type);
+	if (pool) { return pool; }
+
+	assert(type.id < max_component_types && "Too many component types; Increase `max_component_types'.");
+	assert_unlocked(world);
 
-	for (;;) {
-		struct pool_table_el* el = els + idx;
-		if (!el->taken || el->key == key) {
-			return el;
+	if (type.id >= world->type_pool_capacity) {
+		u32 capacity = world->type_pool_capacity < 8 ? 8 : world->type_pool_capacity;
+		while (capacity <= type.id) { capacity *= 2; }
+
+		world->type_pools = core_realloc(world->type_pools, capacity * sizeof(struct pool*));
+		for (u32 i = world->type_pool_capacity; i < capacity; i++) {
+			world->type_pools[i] = null;
 		}
 
-		idx = (idx + 1) % capacity;
+		world->type_pool_capacity = capacity;
+	}
+
+	if (world->pool_count >= world->pool_capacity) {
+		world->pool_capacity = world->pool_capacity < 8 ? 8 : world->pool_capacity * 2;
+		world->pools = core_realloc(world->pools, world->pool_capacity * sizeof(struct pool*));
+	}
+
+	pool = core_alloc(sizeof(struct pool));
+	init_pool(pool, world, type);
+
+	world->pools[world->pool_count++] = pool;
+	world->type_pools[type.id] = pool;
+
+	return pool;
+}
+
+static void swap_bytes(u8* a, u8* b, u32 size) {
+	u8 tmp[64];
+	for (u32 i = 0; i < size; i += sizeof(tmp)) {
+		const u32 chunk = minimum((u32)sizeof(tmp), size - i);
+		memcpy(tmp, a + i, chunk);
+		memcpy(a + i, b + i, chunk);
+		memcpy(b + i, tmp, chunk);
 	}
 }
 
-static void pool_table_resize(struct world* world, u32 capacity) {
-	struct pool_table_el* els = core_calloc(capacity, sizeof(struct pool_table_el));
+static void pool_swap(struct pool* pool, u32 a, u32 b) {
+	if (a == b) { return; }
+
+	const entity ea = pool->dense[a];
+	const entity eb = pool->dense[b];
+
+	pool->dense[a] = eb;
+	pool->dense[b] = ea;
+	*pool_sparse_slot(pool, get_entity_id(ea)) = (i32)b;
+	*pool_sparse_slot(pool, get_entity_id(eb)) = (i32)a;
 
-	for (u32 i = 0; i < world->pool_table_capacity; i++) {
-		struct pool_table_el* el = world->pool_table + i;
-		if (!el->taken) { continue; }
+	if (pool->changed) {
+		const u32 tmp = pool->changed[a];
+		pool->changed[a] = pool->changed[b];
+		pool->changed[b] = tmp;
+	}
+
+	if (!pool->fields) {
+		swap_bytes(pool_get_by_idx(pool, (i32)a), pool_get_by_idx(pool, (i32)b), pool->type.size);
+		return;
+	}
 
-		struct pool_table_el* dst = find_pool_el(els, capacity, el->key);
-		dst->key = el->key;
-		dst->val_idx = el->val_idx;
-		dst->taken = el->taken;
+	for (u32 i = 0; i < pool->field_count; i++) {
+		swap_bytes(pool_get_field(pool, i, a), pool_get_field(pool, i, b), pool->fields[i].size);
 	}
+}
 
-	if (world->pool_table) { core_free(world->pool_table); }
+static bool group_owns(struct group* group, struct pool* pool) {
+	for (u32 i = 0; i < group->pool_count; i++) {
+		if (group->pools[i] == pool) {
+			return true;
+		}
+	}
 
-	world->pool_table = els;
-	world->pool_table_capacity = capacity;
+	return false;
 }
 
-static struct pool* get_pool(struct world* world, struct type_info type) {
-	if (world->pool_table_count == 0) { goto create_new_pool; }
+static bool group_matches(struct group* group, entity e) {
+	return signature_contains(entity_signature(group->world, e), group->mask);
+}
+
+static bool group_contains(struct group* group, entity e) {
+	struct pool* first = group->pools[0];
+	return pool_has(first, e) && (u32)pool_sparse_idx(first, e) < group->count;
+}
+
+/* Move an entity that has all of the group's components to the end of
+ * the group, in every pool that the group owns. */
+static void group_insert(struct group* group, entity e) {
+	for (u32 i = 0; i < group->pool_count; i++) {
+		struct pool* pool = group->pools[i];
+		pool_swap(pool, (u32)pool_sparse_idx(pool, e), group->count);
+	}
+
+	group->count++;
+}
+
+static void group_erase(struct group* group, entity e) {
+	const u32 last = group->count - 1;
 
-	struct pool_table_el* el = find_pool_el(world->pool_table, world->pool_table_capacity, type.id);
-	if (el->taken) { return world->pools + el->val_idx; }
+	for (u32 i = 0; i < group->pool_count; i++) {
+		struct pool* pool = group->pools[i];
+		pool_swap(pool, (u32)pool_sparse_idx(pool, e), last);
+	}
 
-create_new_pool:
+	group->count--;
+}
 
-	if (world->pool_table_count >= world->pool_table_capacity * pool_table_load_factor) {
-		u32 capacity = world->pool_table_capacity < 8 ? 8 : world->pool_table_capacity * 2;
-		pool_table_resize(world, capacity);
+static void group_push_pending(struct group* group, entity e) {
+	if (group->pending_count >= group->pending_capacity) {
+		group->pending_capacity = group->pending_capacity < 8 ? 8 : group->pending_capacity * 2;
+		group->pending = core_realloc(group->pending, group->pending_capacity * sizeof(entity));
 	}
 
-	el = find_pool_el(world->pool_table, world->pool_table_capacity, type.id);
-	el->taken = true;
-	el->key = type.id;
-	el->val_idx = world->pool_count;
+	group->pending[group->pending_count++] = e;
+}
 
-	world->pool_table_count++;
+/* New members aren't sorted into the group straight away, since doing so
+ * would move the components of other entities around while the caller
+ * might still be holding pointers to them. Instead, they are queued and
+ * sorted in just before the group is next iterated. */
+static void groups_on_add(struct world* world, struct pool* pool, entity e) {
+	for (u32 i = 0; i < world->group_count; i++) {
+		struct group* group = world->groups[i];
 
-	if (world->pool_count >= world->pool_capacity) {
-		u32 pool_capacity = world->pool_capacity < 8 ? 8 : world->pool_capacity * 2;
-		void* new_alloc = core_alloc(pool_capacity * sizeof(struct pool));
-		memcpy(new_alloc, world->pools, world->pool_capacity * sizeof(struct pool));
-		
-		if (world->pools) {
-			if (world->iteration_scope >= 0) {
-				world_push_free(world, world->pools);
-			} else {
-				core_free(world->pools);
+		if (group_owns(group, pool) && group_matches(group, e)) {
+			group_push_pending(group, e);
+		}
+	}
+}
+
+/* Removal can't be deferred, because the component is about to go away.
+ * Nested groups are visited first so that their members are moved out
+ * before the enclosing group's range shrinks. */
+static void groups_on_remove(struct world* world, struct pool* pool, entity e) {
+	for (u32 i = world->group_count; i > 0; i--) {
+		struct group* group = world->groups[i - 1];
+
+		if (group_owns(group, pool) && group_contains(group, e)) {
+			group_erase(group, e);
+		}
+	}
+}
+
+static void world_flush_groups(struct world* world) {
+	assert_unlocked(world);
+
+	for (u32 i = 0; i < world->group_count; i++) {
+		struct group* group = world->groups[i];
+
+		for (u32 ii = 0; ii < group->pending_count; ii++) {
+			const entity e = group->pending[ii];
+
+			if (entity_valid(world, e) && group_matches(group, e) && !group_contains(group, e)) {
+				group_insert(group, e);
 			}
 		}
 
-		world->pools = new_alloc;
-		world->pool_capacity = pool_capacity;
+		group->pending_count = 0;
+	}
+}
+
+static bool group_is_subset(struct group* a, struct group* b) {
+	for (u32 i = 0; i < a->pool_count; i++) {
+		if (!group_owns(b, a->pools[i])) {
+			return false;
+		}
 	}
 
-	struct pool* new = &world->pools[world->pool_count++];
-	init_pool(new, world, type);
-	return new;
+	return true;
 }
 
-static struct pool* get_pool_no_create(struct world* world, struct type_info type) {
-	if (world->pool_table_count == 0) { return null; }
+static struct group* new_group(struct world* world, u32 type_count, struct type_info* types) {
+	assert(type_count > 0 && type_count <= view_max);
 
-	struct pool_table_el* el = find_pool_el(world->pool_table, world->pool_table_capacity, type.id);
-	if (el->taken) { return world->pools + el->val_idx; }
+	struct group* group = core_calloc(1, sizeof(struct group));
+	group->world = world;
+	group->pool_count = type_count;
 
-	return null;
+	for (u32 i = 0; i < type_count; i++) {
+		group->pools[i] = get_pool(world, types[i]);
+		group->types[i] = types[i].id;
+		signature_set(group->mask, types[i].id);
+	}
+
+	for (u32 i = 0; i < world->group_count; i++) {
+		struct group* other = world->groups[i];
+
+		bool shared = false;
+		for (u32 ii = 0; ii < group->pool_count; ii++) {
+			shared = shared || group_owns(other, group->pools[ii]);
+		}
+
+		if (shared && !group_is_subset(other, group) && !group_is_subset(group, other)) {
+			assert(0 && "Groups that own the same pool must nest inside each other.");
+		}
+	}
+
+	world_flush_groups(world);
+
+	/* Members of a group nested in this one are already sorted to the
+	 * front of every pool this group owns. */
+	for (u32 i = 0; i < world->group_count; i++) {
+		struct group* other = world->groups[i];
+		if (group_is_subset(group, other) && other->count > group->count) {
+			group->count = other->count;
+		}
+	}
+
+	struct pool* first = group->pools[0];
+	for (u32 i = group->count; i < first->count; i++) {
+		const entity e = first->dense[i];
+		if (group_matches(group, e)) {
+			group_insert(group, e);
+		}
+	}
+
+	for (u32 i = 0; i < group->pool_count; i++) {
+		group->pools[i]->owned = true;
+	}
+
+	if (world->group_count >= world->group_capacity) {
+		world->group_capacity = world->group_capacity < 8 ? 8 : world->group_capacity * 2;
+		world->groups = core_realloc(world->groups, world->group_capacity * sizeof(struct group*));
+	}
+
+	u32 at = world->group_count;
+	while (at > 0 && world->groups[at - 1]->pool_count > group->pool_count) {
+		world->groups[at] = world->groups[at - 1];
+		at--;
+	}
+
+	world->groups[at] = group;
+	world->group_count++;
+
+	return group;
+}
+
+static void free_group(struct group* group) {
+	if (group->pending) {
+		core_free(group->pending);
+	}
+
+	core_free(group);
 }
 
 struct world* new_world() {
 	struct world* w = core_calloc(1, sizeof(struct world));
 
 	w->avail_id = null_entity_id;
+	w->tick = 1;
 
 	return w;
 }
 
 void free_world(struct world* world) {
-	world_clear_free_queue(world);
+	for (u32 i = 0; i < world->group_count; i++) {
+		free_group(world->groups[i]);
+	}
+
+	if (world->groups) {
+		core_free(world->groups);
+	}
 
 	if (world->pools) {
 		for (u32 i = 0; i < world->pool_count; i++) {
-			deinit_pool(&world->pools[i]);
+			deinit_pool(world->pools[i]);
+			core_free(world->pools[i]);
 		}
 
 		core_free(world->pools);
 	}
 
-	if (world->pool_table) {
-		core_free(world->pool_table);
+	if (world->type_pools) {
+		core_free(world->type_pools);
 	}
 
 	if (world->entities) {
 		core_free(world->entities);
 	}
 
+	if (world->signatures) {
+		core_free(world->signatures);
+	}
+
+	if (world->scene_slots) {
+		core_free(world->scene_slots);
+	}
+
+	if (world->scenes) {
+		core_free(world->scenes);
+	}
+
 	core_free(world);
 }
 
 entity new_entity(struct world* world) {
+	assert_unlocked(world);
+
 	world->alive_entity_count++;
 	
 	if (world->avail_id == null_entity_id) {
@@ -387,10 +793,41 @@ entity new_entity(struct world* world) {
 	}
 }
 
-void destroy_entity(struct world* world, entity e) {
-	for (u32 i = 0; i < world->pool_count; i++) {
-		if (pool_has(&world->pools[i], e)) {
-			pool_remove(&world->pools[i], e);
+static struct scene_slot* entity_scene_slot(struct world* world, entity e) {
+	const entity_id id = get_entity_id(e);
+	if (id >= world->scene_slot_capacity) { return null; }
+
+	struct scene_slot* slot = world->scene_slots + id;
+	if (!slot->scene || slot->scene->entities[slot->idx] != e) { return null; }
+
+	return slot;
+}
+
+static void scene_erase(struct world* world, struct scene_slot* slot) {
+	struct scene* scene = slot->scene;
+
+	const entity last = scene->entities[--scene->count];
+	scene->entities[slot->idx] = last;
+	world->scene_slots[get_entity_id(last)].idx = slot->idx;
+
+	slot->scene = null;
+}
+
+static void world_destroy_entity(struct world* world, entity e) {
+	u64* sig = entity_signature(world, e);
+
+	for (u32 i = 0; i < signature_words; i++) {
+		while (sig[i]) {
+			const u32 type = i * 64 + lowest_bit(sig[i]);
+			struct pool* pool = world->type_pools[type];
+
+			if (pool->owned) {
+				groups_on_remove(world, pool, e);
+			}
+
+			pool_remove(pool, e);
+
+			signature_clear(sig, type);
 		}
 	}
 
@@ -400,22 +837,35 @@ void destroy_entity(struct world* world, entity e) {
 	world->alive_entity_count--;
 }
 
+void destroy_entity(struct world* world, entity e) {
+	assert_unlocked(world);
+
+	struct scene_slot* slot = entity_scene_slot(world, e);
+	if (slot) {
+		scene_erase(world, slot);
+	}
+
+	world_destroy_entity(world, e);
+}
+
 bool entity_valid(struct world* world, entity e) {
 	const entity_id id = get_entity_id(e);
 	return id < world->entity_count && world->entities[id] == e;
 }
 
 u32 get_entity_component_types(struct world* world, entity e, struct type_info* info, u32 count) {
-	if (count == 0) { return 0; }
+	const u64* sig = entity_signature(world, e);
 
 	u32 c = 0;
 
-	for (u32 i = 0; i < world->pool_count; i++) {
-		if (pool_has(&world->pools[i], e)) {
-			info[c++] = world->pools[i].type;
-			if (c > count) {
-				return c;
-			}
+	for (u32 i = 0; i < signature_words; i++) {
+		u64 bits = sig[i];
+
+		while (bits && c < count) {
+			const u32 type = i * 64 + lowest_bit(bits);
+			info[c++] = world->type_pools[type]->type;
+
+			bits &= bits - 1;
 		}
 	}
 
@@ -430,60 +880,835 @@ void _set_component_destroy_func(struct world* world, struct type_info type, com
 	get_pool(world, type)->on_destroy = f;
 }
 
-void* _add_component(struct world* world, entity e, struct type_info type, void* init) {
+void _set_component_snapshot_funcs(struct world* world, struct type_info type,
+	component_snapshot_func save, component_snapshot_func load) {
 	struct pool* pool = get_pool(world, type);
 
-	return pool_add(pool, e, init);
-}
+	assert(!pool->fields && "Structure of arrays pools can't have snapshot functions.");
 
-void _remove_component(struct world* world, entity e, struct type_info type) {
-	struct pool* p = get_pool(world, type);
-	
-	pool_remove(p, e);
+	pool->on_save = save;
+	pool->on_load = load;
 }
 
-bool _has_component(struct world* world, entity e, struct type_info type) {
-	return pool_has(get_pool(world, type), e);
-}
+void _set_component_soa(struct world* world, struct type_info type, u32 field_count, struct component_field* fields) {
+	struct pool* pool = get_pool(world, type);
 
-void* _get_component(struct world* world, entity e, struct type_info type) {
-	return pool_get(get_pool(world, type), e);
-}
+	assert(!pool->on_save && !pool->on_load && "Structure of arrays pools can't have snapshot functions.");
+	assert(pool->page_count == 0 && "`set_component_soa' must be called before any components are added.");
+	assert(type.size <= soa_max_component_size && "Component too large for a structure of arrays pool.");
+	assert(field_count > 0);
 
-u32 get_component_pool_count(struct world* world) {
-	return world->pool_count;
-}
+	pool->fields = core_alloc(field_count * sizeof(struct component_field));
+	pool->field_offsets = core_alloc(field_count * sizeof(u32));
+	pool->field_count = field_count;
 
-u32 get_alive_entity_count(struct world* world) {
-	return world->alive_entity_count;
-}
+	memcpy(pool->fields, fields, field_count * sizeof(struct component_field));
 
-static bool view_contains(struct view* view, entity e) {
-	for (u32 i = 0; i < view->pool_count; i++) {
-		if (!pool_has(view->pools[i], e)) {
+	/* Each field's array is aligned to 16 bytes, for SIMD. */
+	const u32 per_page = pool->page_mask + 1;
+
+	u32 offset = 0;
+	for (u32 i = 0; i < field_count; i++) {
+		assert(fields[i].offset + fields[i].size <= type.size);
+
+		pool->field_offsets[i] = offset;
+		offset += (per_page * fields[i].size + 15) & ~15u;
+	}
+
+	pool->page_bytes = offset;
+}
+
+static void* world_add_component(struct world* world, struct pool* pool, entity e, void* init) {
+	assert_unlocked(world);
+
+	signature_set(entity_signature(world, e), pool->type.id);
+
+	void* ptr = pool_add(pool, e, init);
+
+	if (pool->owned) {
+		groups_on_add(world, pool, e);
+	}
+
+	return ptr;
+}
+
+static void world_remove_component(struct world* world, struct pool* pool, entity e) {
+	assert_unlocked(world);
+
+	if (pool->owned) {
+		groups_on_remove(world, pool, e);
+	}
+	
+	pool_remove(pool, e);
+
+	signature_clear(entity_signature(world, e), pool->type.id);
+}
+
+void* _add_component(struct world* world, entity e, struct type_info type, void* init) {
+	return world_add_component(world, get_pool(world, type), e, init);
+}
+
+void _remove_component(struct world* world, entity e, struct type_info type) {
+	world_remove_component(world, get_pool(world, type), e);
+}
+
+bool _has_component(struct world* world, entity e, struct type_info type) {
+	return type.id < max_component_types && get_entity_id(e) < world->entity_count &&
+		signature_test(entity_signature(world, e), type.id);
+}
+
+void* _get_component(struct world* world, entity e, struct type_info type) {
+	return pool_get(get_pool(world, type), e);
+}
+
+void* _get_component_mut(struct world* world, entity e, struct type_info type) {
+	struct pool* pool = get_pool(world, type);
+	pool_touch(pool, (u32)pool_sparse_idx(pool, e));
+	return pool_get(pool, e);
+}
+
+void _set_component_tracking(struct world* world, struct type_info type) {
+	struct pool* pool = get_pool(world, type);
+	if (pool->changed) { return; }
+
+	/* Whatever is already in the pool counts as changed now. */
+	pool->changed = core_alloc(maximum(pool->dense_capacity, 1) * sizeof(u32));
+	for (u32 i = 0; i < pool->count; i++) {
+		pool->changed[i] = world->tick;
+	}
+}
+
+bool _component_changed(struct world* world, entity e, struct type_info type, u32 since) {
+	struct pool* pool = get_pool_no_create(world, type);
+	if (!pool || !pool_has(pool, e)) { return false; }
+
+	return !pool->changed || pool->changed[pool_sparse_idx(pool, e)] >= since;
+}
+
+u32 get_world_tick(struct world* world) {
+	return world->tick;
+}
+
+u32 world_tick(struct world* world) {
+	return ++world->tick;
+}
+
+void _read_component(struct world* world, entity e, struct type_info type, void* out) {
+	struct pool* pool = get_pool(world, type);
+	pool_read(pool, (u32)pool_sparse_idx(pool, e), out);
+}
+
+void _write_component(struct world* world, entity e, struct type_info type, const void* in) {
+	struct pool* pool = get_pool(world, type);
+	pool_write(pool, (u32)pool_sparse_idx(pool, e), in);
+}
+
+void* _get_component_array(struct world* world, struct type_info type, u32 begin, u32* count) {
+	struct pool* pool = get_pool(world, type);
+	assert(!pool->fields && "Use `get_component_field_array' for structure of arrays pools.");
+	assert(begin < pool->count);
+
+	*count = minimum(pool->count - begin, pool->page_mask + 1 - (begin & pool->page_mask));
+
+	return pool_get_by_idx(pool, (i32)begin);
+}
+
+void* _get_component_field_array(struct world* world, struct type_info type, u32 field, u32 begin, u32* count) {
+	struct pool* pool = get_pool(world, type);
+	assert(pool->fields && field < pool->field_count);
+	assert(begin < pool->count);
+
+	*count = minimum(pool->count - begin, pool->page_mask + 1 - (begin & pool->page_mask));
+
+	return pool_get_field(pool, field, begin);
+}
+
+void spawn_batch(struct world* world, u32 count, u32 type_count, struct type_info* types, void** init, entity* out) {
+	assert(type_count <= view_max);
+
+	if (count == 0) { return; }
+
+	/* Worst case, none of the IDs are recycled. */
+	world_reserve_entities(world, world->entity_count + count);
+
+	u64 mask[signature_words] = { 0 };
+	struct pool* pools[view_max];
+
+	for (u32 i = 0; i < type_count; i++) {
+		pools[i] = get_pool(world, types[i]);
+
+		assert(!signature_test(mask, types[i].id) && "Duplicate type passed to `spawn_batch'.");
+		signature_set(mask, types[i].id);
+	}
+
+	for (u32 i = 0; i < count; i++) {
+		out[i] = new_entity(world);
+		memcpy(entity_signature(world, out[i]), mask, sizeof(mask));
+	}
+
+	for (u32 i = 0; i < type_count; i++) {
+		struct pool* pool = pools[i];
+		const u32 base = pool->count;
+
+		pool_reserve(pool, base + count);
+
+		for (u32 ii = 0; ii < count; ii++) {
+			const entity_id id = get_entity_id(out[ii]);
+
+			pool_reserve_sparse(pool, id);
+			*pool_sparse_slot(pool, id) = (i32)(base + ii);
+			pool->dense[base + ii] = out[ii];
+		}
+
+		const u8* src = init ? init[i] : null;
+
+		if (pool->fields) {
+			u8 zero[soa_max_component_size] = { 0 };
+
+			for (u32 ii = 0; ii < count; ii++) {
+				pool_write(pool, base + ii, src ? src + (u64)ii * pool->type.size : zero);
+			}
+
+			pool->count += count;
+			continue;
+		}
+
+		for (u32 ii = 0; ii < count; ii++) {
+			pool_touch(pool, base + ii);
+		}
+
+		/* The components are contiguous within a page, so they can be
+		 * copied in one go per page. */
+		for (u32 done = 0; done < count;) {
+			const u32 idx = base + done;
+			const u32 run = minimum(count - done, pool->page_mask + 1 - (idx & pool->page_mask));
+			const u64 size = (u64)run * pool->type.size;
+
+			void* dst = pool_get_by_idx(pool, (i32)idx);
+
+			if (src) {
+				memcpy(dst, src + (u64)done * pool->type.size, size);
+			} else {
+				memset(dst, 0, size);
+			}
+
+			done += run;
+		}
+
+		pool->count += count;
+	}
+
+	/* Only once every component is in place, so that a create function
+	 * sees the entity as it will be. */
+	for (u32 i = 0; i < type_count; i++) {
+		struct pool* pool = pools[i];
+
+		if (pool->on_create) {
+			for (u32 ii = 0; ii < count; ii++) {
+				pool_call(pool, pool->on_create, pool_sparse_idx(pool, out[ii]));
+			}
+		}
+	}
+
+	for (u32 i = 0; i < world->group_count; i++) {
+		struct group* group = world->groups[i];
+
+		bool owns = false;
+		for (u32 ii = 0; ii < type_count && !owns; ii++) {
+			owns = group_owns(group, pools[ii]);
+		}
+
+		if (!owns || !signature_contains(mask, group->mask)) { continue; }
+
+		for (u32 ii = 0; ii < count; ii++) {
+			group_push_pending(group, out[ii]);
+		}
+	}
+}
+
+/* Snapshots are laid out as a header, the entity array and then each pool
+ * in turn: A header, the type's name, the dense array and then the pool's
+ * used pages exactly as they are in memory. Then each scene: A header, its
+ * name and its members. Every block starts on an eight byte boundary, so
+ * that save functions can be given pointers into the snapshot itself.
+ *
+ * Sparse arrays and signatures aren't stored. Both are rebuilt from the
+ * dense arrays on reading, which is cheap, and signatures are indexed by
+ * the type registry, whose indices depend on the order in which types
+ * were first seen. */
+#define snapshot_magic 0x534d564f
+#define snapshot_version 2
+
+struct snapshot_header {
+	u32 magic;
+	u32 version;
+	u32 entity_count;
+	u32 alive_entity_count;
+	entity_id avail_id;
+	u32 pool_count;
+	u32 scene_count;
+};
+
+struct snapshot_pool_header {
+	u32 name_length;
+	u32 size;
+	u32 field_count;
+	u32 page_bytes;
+	u32 count;
+	u32 page_count;
+};
+
+struct snapshot_scene_header {
+	u32 name_length;
+	u32 count;
+};
+
+static u64 snapshot_align(u64 offset) {
+	return (offset + 7) & ~(u64)7;
+}
+
+static u32 pool_used_pages(struct pool* pool) {
+	return (pool->count + pool->page_mask) >> pool->page_shift;
+}
+
+void* world_snapshot_write(struct world* world, u64* size) {
+	u64 total = snapshot_align(sizeof(struct snapshot_header)) +
+		snapshot_align((u64)world->entity_count * sizeof(entity));
+
+	for (u32 i = 0; i < world->pool_count; i++) {
+		struct pool* pool = world->pools[i];
+
+		total += snapshot_align(sizeof(struct snapshot_pool_header));
+		total += snapshot_align(strlen(pool->type.name));
+		total += snapshot_align((u64)pool->count * sizeof(entity));
+		total += (u64)pool_used_pages(pool) * snapshot_align(pool->page_bytes);
+	}
+
+	for (u32 i = 0; i < world->scene_count; i++) {
+		struct scene* scene = world->scenes[i];
+
+		total += snapshot_align(sizeof(struct snapshot_scene_header));
+		total += snapshot_align(strlen(scene->name));
+		total += snapshot_align((u64)scene->count * sizeof(entity));
+	}
+
+	u8* data = core_alloc(total);
+	u64 offset = 0;
+
+	*(struct snapshot_header*)data = (struct snapshot_header) {
+		.magic = snapshot_magic,
+		.version = snapshot_version,
+		.entity_count = world->entity_count,
+		.alive_entity_count = world->alive_entity_count,
+		.avail_id = world->avail_id,
+		.pool_count = world->pool_count,
+		.scene_count = world->scene_count
+	};
+	offset += snapshot_align(sizeof(struct snapshot_header));
+
+	memcpy(data + offset, world->entities, (u64)world->entity_count * sizeof(entity));
+	offset += snapshot_align((u64)world->entity_count * sizeof(entity));
+
+	for (u32 i = 0; i < world->pool_count; i++) {
+		struct pool* pool = world->pools[i];
+
+		const u32 name_length = (u32)strlen(pool->type.name);
+		const u32 page_count = pool_used_pages(pool);
+
+		*(struct snapshot_pool_header*)(data + offset) = (struct snapshot_pool_header) {
+			.name_length = name_length,
+			.size = pool->type.size,
+			.field_count = pool->field_count,
+			.page_bytes = pool->page_bytes,
+			.count = pool->count,
+			.page_count = page_count
+		};
+		offset += snapshot_align(sizeof(struct snapshot_pool_header));
+
+		memcpy(data + offset, pool->type.name, name_length);
+		offset += snapshot_align(name_length);
+
+		memcpy(data + offset, pool->dense, (u64)pool->count * sizeof(entity));
+		offset += snapshot_align((u64)pool->count * sizeof(entity));
+
+		for (u32 ii = 0; ii < page_count; ii++) {
+			u8* page = data + offset;
+			memcpy(page, pool->pages[ii], pool->page_bytes);
+
+			if (pool->on_save) {
+				const u32 begin = ii << pool->page_shift;
+				const u32 end = minimum(begin + pool->page_mask + 1, pool->count);
+
+				for (u32 idx = begin; idx < end; idx++) {
+					pool->on_save(world, pool->dense[idx], page + (idx - begin) * pool->type.size);
+				}
+			}
+
+			offset += snapshot_align(pool->page_bytes);
+		}
+	}
+
+	for (u32 i = 0; i < world->scene_count; i++) {
+		struct scene* scene = world->scenes[i];
+
+		const u32 name_length = (u32)strlen(scene->name);
+
+		*(struct snapshot_scene_header*)(data + offset) = (struct snapshot_scene_header) {
+			.name_length = name_length,
+			.count = scene->count
+		};
+		offset += snapshot_align(sizeof(struct snapshot_scene_header));
+
+		memcpy(data + offset, scene->name, name_length);
+		offset += snapshot_align(name_length);
+
+		memcpy(data + offset, scene->entities, (u64)scene->count * sizeof(entity));
+		offset += snapshot_align((u64)scene->count * sizeof(entity));
+	}
+
+	*size = total;
+	return data;
+}
+
+/* Every component in the world is thrown away, and every scene emptied. */
+static void world_clear_for_snapshot(struct world* world) {
+	for (u32 i = 0; i < world->scene_count; i++) {
+		struct scene* scene = world->scenes[i];
+
+		for (u32 ii = 0; ii < scene->count; ii++) {
+			world->scene_slots[get_entity_id(scene->entities[ii])].scene = null;
+		}
+
+		scene->count = 0;
+	}
+
+	for (u32 i = 0; i < world->pool_count; i++) {
+		struct pool* pool = world->pools[i];
+
+		if (pool->on_destroy) {
+			for (u32 ii = 0; ii < pool->count; ii++) {
+				pool_call(pool, pool->on_destroy, ii);
+			}
+		}
+
+		for (u32 ii = 0; ii < pool->count; ii++) {
+			*pool_sparse_slot(pool, get_entity_id(pool->dense[ii])) = -1;
+		}
+
+		pool->count = 0;
+	}
+}
+
+/* Sorts every group from scratch, smallest first, like `new_group' would
+ * if the groups were created again. */
+static void world_rebuild_groups(struct world* world) {
+	for (u32 i = 0; i < world->group_count; i++) {
+		struct group* group = world->groups[i];
+		struct pool* first = group->pools[0];
+
+		group->count = 0;
+		group->pending_count = 0;
+
+		for (u32 ii = 0; ii < first->count; ii++) {
+			const entity e = first->dense[ii];
+			if (group_matches(group, e)) {
+				group_insert(group, e);
+			}
+		}
+	}
+}
+
+static void snapshot_push_section(struct snapshot_section* sections, u32 max, u32* count, u32 key, u64 offset, u64 size) {
+	if (sections && *count < max) {
+		sections[*count] = (struct snapshot_section) { key, offset, size };
+	}
+
+	(*count)++;
+}
+
+/* The header and entities are keys 0 and 1. Each pool is two sections:
+ * Its header, name and dense array, and then its pages, so that the pages
+ * stay at the same place within their section as the pool grows. Scenes
+ * come last, keyed from `snapshot_scene_key'. */
+#define snapshot_scene_key 0x80000000
+
+u32 world_snapshot_sections(const void* snapshot, u64 size, struct snapshot_section* sections, u32 max) {
+	const u8* data = snapshot;
+	u32 count = 0;
+
+	struct snapshot_header header;
+	memcpy(&header, data, sizeof(header));
+
+	u64 offset = snapshot_align(sizeof(header));
+	snapshot_push_section(sections, max, &count, 0, 0, offset);
+
+	const u64 entities_size = snapshot_align((u64)header.entity_count * sizeof(entity));
+	snapshot_push_section(sections, max, &count, 1, offset, entities_size);
+	offset += entities_size;
+
+	for (u32 i = 0; i < header.pool_count; i++) {
+		struct snapshot_pool_header ph;
+		memcpy(&ph, data + offset, sizeof(ph));
+
+		const u64 head_size = snapshot_align(sizeof(ph)) + snapshot_align(ph.name_length) +
+			snapshot_align((u64)ph.count * sizeof(entity));
+		snapshot_push_section(sections, max, &count, 2 + i * 2, offset, head_size);
+		offset += head_size;
+
+		const u64 pages_size = (u64)ph.page_count * snapshot_align(ph.page_bytes);
+		snapshot_push_section(sections, max, &count, 3 + i * 2, offset, pages_size);
+		offset += pages_size;
+	}
+
+	for (u32 i = 0; i < header.scene_count; i++) {
+		struct snapshot_scene_header sh;
+		memcpy(&sh, data + offset, sizeof(sh));
+
+		const u64 scene_size = snapshot_align(sizeof(sh)) + snapshot_align(sh.name_length) +
+			snapshot_align((u64)sh.count * sizeof(entity));
+		snapshot_push_section(sections, max, &count, snapshot_scene_key + i, offset, scene_size);
+		offset += scene_size;
+	}
+
+	assert(offset == size);
+
+	return count;
+}
+
+static u64 hash_bytes(u64 hash, const void* data, u64 size) {
+	const u8* bytes = data;
+
+	for (u64 i = 0; i < size; i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+u64 world_hash(struct world* world, const struct type_info* types, u32 type_count) {
+	u64 hash = 0xcbf29ce484222325ULL;
+
+	hash = hash_bytes(hash, &world->alive_entity_count, sizeof(world->alive_entity_count));
+	hash = hash_bytes(hash, world->entities, world->entity_count * sizeof(entity));
+
+	u8 buffer[soa_max_component_size];
+
+	for (u32 i = 0; i < type_count; i++) {
+		struct pool* pool = get_pool_no_create(world, types[i]);
+		if (!pool) { continue; }
+
+		hash = hash_bytes(hash, &pool->count, sizeof(pool->count));
+		hash = hash_bytes(hash, pool->dense, pool->count * sizeof(entity));
+
+		for (u32 j = 0; j < pool->count; j++) {
+			if (pool->fields) {
+				pool_read(pool, j, buffer);
+				hash = hash_bytes(hash, buffer, pool->type.size);
+			} else {
+				hash = hash_bytes(hash, pool_get_by_idx(pool, (i32)j), pool->type.size);
+			}
+		}
+	}
+
+	return hash;
+}
+
+static bool snapshot_fits(u64 offset, u64 need, u64 size) {
+	return offset <= size && need <= size - offset;
+}
+
+/* Free entities are chained through their ids, starting at `avail_id'. The
+ * chain must stay within the entities, and hold exactly the ones that
+ * aren't alive, or creating entities later would run off the end. */
+static bool snapshot_free_list_valid(const entity* entities, u32 entity_count, u32 alive_count, entity_id avail_id) {
+	entity_id id = avail_id;
+
+	for (u32 i = 0; i < entity_count - alive_count; i++) {
+		if (id >= entity_count) { return false; }
+
+		entity e;
+		memcpy(&e, entities + id, sizeof(entity));
+		id = get_entity_id(e);
+	}
+
+	return id == null_entity_id;
+}
+
+/* Entities in pools and scenes must be alive in the snapshot, which means
+ * they are at their own id in the entity array. */
+static bool snapshot_claim(u32* claims, const entity* entities, u32 entity_count, entity e, u32 claim) {
+	const entity_id id = get_entity_id(e);
+	if (id >= entity_count) { return false; }
+
+	entity alive;
+	memcpy(&alive, entities + id, sizeof(entity));
+	if (alive != e || claims[id] == claim) { return false; }
+
+	claims[id] = claim;
+	return true;
+}
+
+bool world_snapshot_read(struct world* world, const void* snapshot, u64 size) {
+	assert_unlocked(world);
+
+	const u8* data = snapshot;
+
+	struct snapshot_header header;
+	if (!snapshot_fits(0, sizeof(header), size)) { goto corrupt; }
+	memcpy(&header, data, sizeof(header));
+
+	if (header.magic != snapshot_magic || header.version != snapshot_version) {
+		fprintf(stderr, "Not a world snapshot, or from an incompatible version.\n");
+		return false;
+	}
+
+	const u64 pools_offset = snapshot_align(sizeof(header)) + snapshot_align((u64)header.entity_count * sizeof(entity));
+	if (!snapshot_fits(0, pools_offset, size)) { goto corrupt; }
+
+	/* Check everything before touching the world, so that a bad snapshot
+	 * leaves it as it was. */
+	const entity* entities = (const entity*)(data + snapshot_align(sizeof(header)));
+	if (header.alive_entity_count > header.entity_count ||
+		!snapshot_free_list_valid(entities, header.entity_count, header.alive_entity_count, header.avail_id)) {
+		goto corrupt;
+	}
+
+	/* Which pool, or the scenes, last claimed each entity, so that no
+	 * entity is in a pool twice, or in more than one scene. */
+	u32* claims = core_calloc(header.entity_count > 0 ? header.entity_count : 1, sizeof(u32));
+	u64 seen_types[signature_words] = { 0 };
+
+	u64 offset = pools_offset;
+	for (u32 i = 0; i < header.pool_count; i++) {
+		struct snapshot_pool_header ph;
+		if (!snapshot_fits(offset, sizeof(ph), size)) { goto corrupt_claims; }
+		memcpy(&ph, data + offset, sizeof(ph));
+		offset += snapshot_align(sizeof(ph));
+
+		char name[256];
+		if (ph.name_length >= sizeof(name) || !snapshot_fits(offset, ph.name_length, size)) { goto corrupt_claims; }
+		memcpy(name, data + offset, ph.name_length);
+		name[ph.name_length] = '\0';
+		offset += snapshot_align(ph.name_length);
+
+		const u64 dense_size = snapshot_align((u64)ph.count * sizeof(entity));
+		const u64 block = dense_size + (u64)ph.page_count * snapshot_align(ph.page_bytes);
+		if (!snapshot_fits(offset, block, size)) { goto corrupt_claims; }
+
+		const u32 id = _type_index(name);
+		if (id >= max_component_types || signature_test(seen_types, id)) { goto corrupt_claims; }
+		signature_set(seen_types, id);
+
+		/* Pools that the world hasn't seen yet are only made once the
+		 * whole snapshot has been checked, so compare against what one
+		 * would look like. */
+		struct pool probe;
+		const struct pool* pool = get_pool_no_create(world, (struct type_info) { id, ph.size, name });
+		if (!pool) {
+			init_pool(&probe, world, (struct type_info) { id, ph.size, name });
+			pool = &probe;
+		}
+
+		if (pool->type.size != ph.size || pool->field_count != ph.field_count || pool->page_bytes != ph.page_bytes ||
+			ph.page_count != (ph.count + pool->page_mask) >> pool->page_shift) {
+			fprintf(stderr, "Snapshot pool `%s' doesn't match the world's.\n", name);
+			core_free(claims);
 			return false;
 		}
+
+		for (u32 ii = 0; ii < ph.count; ii++) {
+			entity e;
+			memcpy(&e, data + offset + ii * sizeof(entity), sizeof(entity));
+
+			if (!snapshot_claim(claims, entities, header.entity_count, e, i + 1)) { goto corrupt_claims; }
+		}
+
+		offset += block;
+	}
+
+	const u64 scenes_offset = offset;
+	for (u32 i = 0; i < header.scene_count; i++) {
+		struct snapshot_scene_header sh;
+		if (!snapshot_fits(offset, sizeof(sh), size)) { goto corrupt_claims; }
+		memcpy(&sh, data + offset, sizeof(sh));
+		offset += snapshot_align(sizeof(sh));
+
+		const u64 block = snapshot_align(sh.name_length) + snapshot_align((u64)sh.count * sizeof(entity));
+		if (!snapshot_fits(offset, block, size)) { goto corrupt_claims; }
+
+		const u8* members = data + offset + snapshot_align(sh.name_length);
+		for (u32 ii = 0; ii < sh.count; ii++) {
+			entity e;
+			memcpy(&e, members + ii * sizeof(entity), sizeof(entity));
+
+			if (!snapshot_claim(claims, entities, header.entity_count, e, header.pool_count + 1)) { goto corrupt_claims; }
+		}
+
+		offset += block;
+	}
+
+	core_free(claims);
+
+	world_clear_for_snapshot(world);
+
+	world_reserve_entities(world, header.entity_count);
+	memcpy(world->entities, data + snapshot_align(sizeof(struct snapshot_header)),
+		(u64)header.entity_count * sizeof(entity));
+	memset(world->signatures, 0, (u64)header.entity_count * signature_words * sizeof(u64));
+
+	world->entity_count = header.entity_count;
+	world->alive_entity_count = header.alive_entity_count;
+	world->avail_id = header.avail_id;
+
+	offset = pools_offset;
+	for (u32 i = 0; i < header.pool_count; i++) {
+		struct snapshot_pool_header ph;
+		memcpy(&ph, data + offset, sizeof(ph));
+		offset += snapshot_align(sizeof(ph));
+
+		char name[256];
+		memcpy(name, data + offset, ph.name_length);
+		name[ph.name_length] = '\0';
+		offset += snapshot_align(ph.name_length);
+
+		const u32 id = _type_index(name);
+		struct pool* pool = get_pool(world, (struct type_info) { id, ph.size, get_type_name(id) });
+
+		pool_reserve(pool, ph.count);
+
+		memcpy(pool->dense, data + offset, (u64)ph.count * sizeof(entity));
+		offset += snapshot_align((u64)ph.count * sizeof(entity));
+
+		for (u32 ii = 0; ii < ph.page_count; ii++) {
+			memcpy(pool->pages[ii], data + offset, ph.page_bytes);
+			offset += snapshot_align(ph.page_bytes);
+		}
+
+		pool->count = ph.count;
+
+		for (u32 ii = 0; ii < ph.count; ii++) {
+			const entity e = pool->dense[ii];
+
+			pool_reserve_sparse(pool, get_entity_id(e));
+			*pool_sparse_slot(pool, get_entity_id(e)) = (i32)ii;
+
+			signature_set(entity_signature(world, e), id);
+
+			pool_touch(pool, ii);
+		}
+	}
+
+	world_rebuild_groups(world);
+
+	/* Scenes are matched by name; Members of scenes that the world doesn't
+	 * have are left out of any scene. */
+	offset = scenes_offset;
+	for (u32 i = 0; i < header.scene_count; i++) {
+		struct snapshot_scene_header sh;
+		memcpy(&sh, data + offset, sizeof(sh));
+		offset += snapshot_align(sizeof(sh));
+
+		const char* name = (const char*)data + offset;
+		offset += snapshot_align(sh.name_length);
+
+		struct scene* scene = null;
+		for (u32 ii = 0; ii < world->scene_count && !scene; ii++) {
+			struct scene* s = world->scenes[ii];
+			if (strlen(s->name) == sh.name_length && memcmp(s->name, name, sh.name_length) == 0) {
+				scene = s;
+			}
+		}
+
+		for (u32 ii = 0; scene && ii < sh.count; ii++) {
+			entity e;
+			memcpy(&e, data + offset + ii * sizeof(entity), sizeof(entity));
+			scene_add(scene, e);
+		}
+
+		offset += snapshot_align((u64)sh.count * sizeof(entity));
+	}
+
+	for (u32 i = 0; i < world->pool_count; i++) {
+		struct pool* pool = world->pools[i];
+
+		if (pool->on_load) {
+			for (u32 ii = 0; ii < pool->count; ii++) {
+				pool->on_load(world, pool->dense[ii], pool_get_by_idx(pool, (i32)ii));
+			}
+		}
 	}
 
 	return true;
+
+corrupt_claims:
+	core_free(claims);
+corrupt:
+	fprintf(stderr, "World snapshot is truncated or corrupt.\n");
+	return false;
+}
+
+u32 get_component_pool_count(struct world* world) {
+	return world->pool_count;
+}
+
+u32 get_alive_entity_count(struct world* world) {
+	return world->alive_entity_count;
+}
+
+void lock_world(struct world* world) {
+	assert_unlocked(world);
+	world->locked = true;
+}
+
+void unlock_world(struct world* world) {
+	world->locked = false;
+}
+
+static bool view_contains(struct view* view, entity e) {
+	return signature_contains(entity_signature(view->world, e), view->mask);
 }
 
-static u32 view_get_idx(struct view* view, struct type_info type) {
+/* For `view_changed': Whether any of the tracked components has changed
+ * since the view's tick. */
+static bool view_accepts(struct view* view, entity e) {
+	if (!view_contains(view, e)) { return false; }
+	if (!view->changed_only) { return true; }
+
 	for (u32 i = 0; i < view->pool_count; i++) {
-		if (view->to_pool[i] == type.id) {
+		struct pool* pool = view->pools[i];
+		if (pool->changed && pool->changed[pool_sparse_idx(pool, e)] >= view->since) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* The name is usually the very same literal that the view was made with,
+ * so the pointers are compared before the strings. */
+static u32 view_get_idx(struct view* view, const char* name) {
+	for (u32 i = 0; i < view->pool_count; i++) {
+		if (view->names[i] == name) {
+			return i;
+		}
+	}
+
+	for (u32 i = 0; i < view->pool_count; i++) {
+		if (strcmp(view->names[i], name) == 0) {
 			return i;
 		}
 	}
 
+	assert(false && "The view wasn't made with this type.");
 	return 0;
 }
 
-struct view new_view(struct world* world, u32 type_count, struct type_info* types) {
+static struct view init_view(struct world* world, u32 type_count, struct type_info* types, bool changed_only, u32 since) {
 	struct view v = { 0 };
 	v.world = world;
 	v.pool_count = type_count;
-
-	world->iteration_scope++;
+	v.changed_only = changed_only;
+	v.since = since;
 
 	for (u32 i = 0; i < type_count; i++) {
 		v.pools[i] = get_pool_no_create(world, types[i]);
@@ -502,13 +1727,14 @@ struct view new_view(struct world* world, u32 type_count, struct type_info* type
 				v.pool = v.pools[i];
 			}
 		}
-		v.to_pool[i] = types[i].id;
+		v.names[i] = types[i].name;
+		signature_set(v.mask, types[i].id);
 	}
 
 	if (v.pool && ((struct pool*)v.pool)->count != 0) {
 		v.idx = ((struct pool*)v.pool)->count - 1;
 		v.e = ((struct pool*)v.pool)->dense[v.idx];
-		if (!view_contains(&v, v.e)) {
+		if (!view_accepts(&v, v.e)) {
 			view_next(&v);
 		}
 	} else {
@@ -519,25 +1745,35 @@ struct view new_view(struct world* world, u32 type_count, struct type_info* type
 	return v;
 }
 
-bool view_valid(struct view* view) {
-	bool valid = view->e != null_entity;
+struct view new_view(struct world* world, u32 type_count, struct type_info* types) {
+	return init_view(world, type_count, types, false, 0);
+}
 
-	if (!valid) {
-		view->world->iteration_scope--;
-		
-		if (view->world->iteration_scope <= 0) {
-			world_clear_free_queue(view->world);
-		}
-	}
+struct view new_view_changed(struct world* world, u32 since, u32 type_count, struct type_info* types) {
+	return init_view(world, type_count, types, true, since);
+}
 
-	return valid;
+bool view_valid(struct view* view) {
+	return view->e != null_entity;
 }
 
-void* _view_get(struct view* view, struct type_info type) {
-	return pool_get(view->pools[view_get_idx(view, type)], view->e);
+void* _view_get(struct view* view, const char* name) {
+	return pool_get(view->pools[view_get_idx(view, name)], view->e);
+}
+
+void* _view_get_mut(struct view* view, const char* name) {
+	struct pool* pool = view->pools[view_get_idx(view, name)];
+	pool_touch(pool, (u32)pool_sparse_idx(pool, view->e));
+	return pool_get(pool, view->e);
 }
 
 void view_next(struct view* view) {
+	/* Entities that were already visited may have been destroyed,
+	 * shrinking the pool from the end. */
+	if (view->idx > ((struct pool*)view->pool)->count) {
+		view->idx = ((struct pool*)view->pool)->count;
+	}
+
 	do {
 		if (view->idx) {
 			view->idx--;
@@ -545,7 +1781,407 @@ void view_next(struct view* view) {
 		} else {
 			view->e = null_entity;
 		}
-	} while ((view->e != null_entity) && !view_contains(view, view->e));
+	} while ((view->e != null_entity) && !view_accepts(view, view->e));
+}
+
+struct view_parallel {
+	struct view view;
+	view_func func;
+	void* udata;
+};
+
+static void view_parallel_job(u32 begin, u32 end, void* udata) {
+	struct view_parallel* vp = udata;
+
+	struct view view = vp->view;
+	struct pool* pool = view.pool;
+
+	for (u32 i = begin; i < end; i++) {
+		view.idx = i;
+		view.e = pool->dense[i];
+
+		if (view_contains(&view, view.e)) {
+			vp->func(&view, vp->udata);
+		}
+	}
+}
+
+void _view_for_each_parallel(struct world* world, u32 type_count, struct type_info* types,
+	view_func func, void* udata, u32 grain) {
+	assert_unlocked(world);
+
+	struct view_parallel vp = {
+		.view = new_view(world, type_count, types),
+		.func = func,
+		.udata = udata
+	};
+
+	if (!view_valid(&vp.view)) { return; }
+
+	lock_world(world);
+	run_jobs(((struct pool*)vp.view.pool)->count, grain, view_parallel_job, &vp);
+	unlock_world(world);
+}
+
+struct group* _get_group(struct world* world, u32 type_count, struct type_info* types) {
+	for (u32 i = 0; i < world->group_count; i++) {
+		struct group* group = world->groups[i];
+		if (group->pool_count != type_count) { continue; }
+
+		bool same = true;
+		for (u32 ii = 0; ii < type_count && same; ii++) {
+			struct pool* pool = get_pool_no_create(world, types[ii]);
+			same = pool && group_owns(group, pool);
+		}
+
+		if (same) {
+			return group;
+		}
+	}
+
+	return new_group(world, type_count, types);
+}
+
+u32 get_group_size(struct group* group) {
+	world_flush_groups(group->world);
+	return group->count;
+}
+
+struct group_view new_group_view(struct group* group) {
+	struct world* world = group->world;
+
+	struct group_view v = { 0 };
+	v.world = world;
+	v.group = group;
+	v.pool_count = group->pool_count;
+
+	world_flush_groups(world);
+
+	for (u32 i = 0; i < group->pool_count; i++) {
+		v.pools[i] = group->pools[i];
+		v.to_pool[i] = group->types[i];
+	}
+
+	v.idx = group->count;
+	group_view_next(&v);
+
+	return v;
+}
+
+bool group_view_valid(struct group_view* view) {
+	return view->e != null_entity;
+}
+
+void* _group_view_get(struct group_view* view, struct type_info type) {
+	for (u32 i = 0; i < view->pool_count; i++) {
+		if (view->to_pool[i] == type.id) {
+			struct pool* pool = view->pools[i];
+			assert(!pool->fields && "Components in a structure of arrays pool can't be pointed to.");
+
+			return pool_get_by_idx(pool, (i32)view->idx);
+		}
+	}
+
+	return null;
+}
+
+void group_view_next(struct group_view* view) {
+	/* Destroying entities while iterating shrinks the group. Since
+	 * the group is walked backwards, everything past the current
+	 * position has already been visited. */
+	if (view->idx > view->group->count) {
+		view->idx = view->group->count;
+	}
+
+	if (view->idx) {
+		view->idx--;
+		view->e = ((struct pool*)view->pools[0])->dense[view->idx];
+	} else {
+		view->e = null_entity;
+	}
+}
+
+/* Commands are stored back to back in a single buffer, each one a header
+ * followed by the component data for adds, padded to eight bytes. */
+enum {
+	ecs_command_add = 0,
+	ecs_command_remove,
+	ecs_command_destroy
+};
+
+struct ecs_command {
+	entity e;
+	struct type_info type;
+	u32 op;
+	u32 next;
+};
+
+struct ecs_commands {
+	u8* buffer;
+	u32 size;
+	u32 capacity;
+
+	u32 command_count;
+	u32 create_count;
+
+	/* Scratch space for `apply_ecs_commands', kept between calls. */
+	u32* order;
+	u32 order_capacity;
+	entity* created;
+	u32 created_capacity;
+};
+
+/* Entities made by `cmd_new_entity' don't exist until the commands are
+ * applied, so they are handed out as placeholders with this version and the
+ * index of the create as their ID. */
+#define ecs_command_placeholder_version UINT32_MAX
+
+struct ecs_commands* new_ecs_commands() {
+	return core_calloc(1, sizeof(struct ecs_commands));
+}
+
+void free_ecs_commands(struct ecs_commands* cmds) {
+	if (cmds->buffer)  { core_free(cmds->buffer); }
+	if (cmds->order)   { core_free(cmds->order); }
+	if (cmds->created) { core_free(cmds->created); }
+
+	core_free(cmds);
+}
+
+static struct ecs_command* ecs_commands_push(struct ecs_commands* cmds, u32 op, entity e, struct type_info type, u32 data_size) {
+	const u32 size = (u32)((sizeof(struct ecs_command) + data_size + 7) & ~(u64)7);
+
+	if (cmds->size + size > cmds->capacity) {
+		u32 capacity = cmds->capacity < 256 ? 256 : cmds->capacity * 2;
+		while (capacity < cmds->size + size) { capacity *= 2; }
+
+		cmds->buffer = core_realloc(cmds->buffer, capacity);
+		cmds->capacity = capacity;
+	}
+
+	struct ecs_command* cmd = (struct ecs_command*)(cmds->buffer + cmds->size);
+	cmd->e = e;
+	cmd->type = type;
+	cmd->op = op;
+	cmd->next = cmds->size + size;
+
+	cmds->size += size;
+	cmds->command_count++;
+
+	return cmd;
+}
+
+entity cmd_new_entity(struct ecs_commands* cmds) {
+	return make_handle(cmds->create_count++, ecs_command_placeholder_version);
+}
+
+void cmd_destroy_entity(struct ecs_commands* cmds, entity e) {
+	ecs_commands_push(cmds, ecs_command_destroy, e, (struct type_info) { 0 }, 0);
+}
+
+void _cmd_add_component(struct ecs_commands* cmds, entity e, struct type_info type, void* init) {
+	struct ecs_command* cmd = ecs_commands_push(cmds, ecs_command_add, e, type, type.size);
+	memcpy(cmd + 1, init, type.size);
+}
+
+void _cmd_remove_component(struct ecs_commands* cmds, entity e, struct type_info type) {
+	ecs_commands_push(cmds, ecs_command_remove, e, type, 0);
+}
+
+static entity ecs_commands_resolve(struct ecs_commands* cmds, entity e) {
+	if (e != null_entity && get_entity_version(e) == ecs_command_placeholder_version) {
+		return cmds->created[get_entity_id(e)];
+	}
+
+	return e;
+}
+
+void apply_ecs_commands(struct ecs_commands* cmds, struct world* world) {
+	if (cmds->create_count > cmds->created_capacity) {
+		cmds->created_capacity = cmds->create_count;
+		cmds->created = core_realloc(cmds->created, cmds->created_capacity * sizeof(entity));
+	}
+
+	for (u32 i = 0; i < cmds->create_count; i++) {
+		cmds->created[i] = new_entity(world);
+	}
+
+	if (cmds->command_count > cmds->order_capacity) {
+		cmds->order_capacity = cmds->command_count;
+		cmds->order = core_realloc(cmds->order, cmds->order_capacity * sizeof(u32));
+	}
+
+	/* Counting sort of the component commands by type, keeping the order
+	 * they were recorded in, so that each pool is only visited once. */
+	u32 starts[max_component_types + 1] = { 0 };
+	u32 component_command_count = 0;
+
+	for (u32 off = 0; off < cmds->size; off = ((struct ecs_command*)(cmds->buffer + off))->next) {
+		struct ecs_command* cmd = (struct ecs_command*)(cmds->buffer + off);
+		if (cmd->op != ecs_command_destroy) {
+			assert(cmd->type.id < max_component_types);
+			starts[cmd->type.id + 1]++;
+			component_command_count++;
+		}
+	}
+
+	for (u32 i = 0; i < max_component_types; i++) {
+		starts[i + 1] += starts[i];
+	}
+
+	u32 cursors[max_component_types];
+	memcpy(cursors, starts, sizeof(cursors));
+
+	for (u32 off = 0; off < cmds->size; off = ((struct ecs_command*)(cmds->buffer + off))->next) {
+		struct ecs_command* cmd = (struct ecs_command*)(cmds->buffer + off);
+		if (cmd->op != ecs_command_destroy) {
+			cmds->order[cursors[cmd->type.id]++] = off;
+		}
+	}
+
+	for (u32 type = 0; type < max_component_types; type++) {
+		const u32 begin = starts[type];
+		const u32 end = starts[type + 1];
+		if (begin == end) { continue; }
+
+		struct pool* pool = get_pool(world, ((struct ecs_command*)(cmds->buffer + cmds->order[begin]))->type);
+		pool_reserve(pool, pool->count + (end - begin));
+
+		for (u32 i = begin; i < end; i++) {
+			struct ecs_command* cmd = (struct ecs_command*)(cmds->buffer + cmds->order[i]);
+			const entity e = ecs_commands_resolve(cmds, cmd->e);
+
+			if (!entity_valid(world, e)) { continue; }
+
+			const bool has = signature_test(entity_signature(world, e), type);
+
+			if (cmd->op == ecs_command_add) {
+				if (has) {
+					pool_write(pool, (u32)pool_sparse_idx(pool, e), cmd + 1);
+				} else {
+					world_add_component(world, pool, e, cmd + 1);
+				}
+			} else if (has) {
+				world_remove_component(world, pool, e);
+			}
+		}
+	}
+
+	for (u32 off = 0; off < cmds->size; off = ((struct ecs_command*)(cmds->buffer + off))->next) {
+		struct ecs_command* cmd = (struct ecs_command*)(cmds->buffer + off);
+		if (cmd->op == ecs_command_destroy) {
+			const entity e = ecs_commands_resolve(cmds, cmd->e);
+
+			if (entity_valid(world, e)) {
+				destroy_entity(world, e);
+			}
+		}
+	}
+
+	cmds->size = 0;
+	cmds->command_count = 0;
+	cmds->create_count = 0;
+}
+
+struct scene* new_scene(struct world* world, const char* name) {
+	struct scene* scene = core_calloc(1, sizeof(struct scene));
+
+	scene->name = copy_string(name);
+	scene->world = world;
+
+	if (world->scene_count >= world->scene_capacity) {
+		world->scene_capacity = world->scene_capacity < 8 ? 8 : world->scene_capacity * 2;
+		world->scenes = core_realloc(world->scenes, world->scene_capacity * sizeof(struct scene*));
+	}
+
+	world->scenes[world->scene_count++] = scene;
+
+	return scene;
+}
+
+void free_scene(struct scene* scene) {
+	struct world* world = scene->world;
+
+	clear_scene(scene);
+
+	for (u32 i = 0; i < world->scene_count; i++) {
+		if (world->scenes[i] == scene) {
+			world->scenes[i] = world->scenes[--world->scene_count];
+			break;
+		}
+	}
+
+	if (scene->entities) {
+		core_free(scene->entities);
+	}
+
+	core_free(scene->name);
+	core_free(scene);
+}
+
+/* Members are popped off the end one at a time rather than walked, since a
+ * destroy function may destroy other members, or add new ones. */
+void clear_scene(struct scene* scene) {
+	struct world* world = scene->world;
+
+	assert_unlocked(world);
+
+	while (scene->count > 0) {
+		const entity e = scene->entities[--scene->count];
+		world->scene_slots[get_entity_id(e)].scene = null;
+
+		world_destroy_entity(world, e);
+	}
+}
+
+void scene_add(struct scene* scene, entity e) {
+	struct world* world = scene->world;
+
+	const entity_id id = get_entity_id(e);
+
+	if (id >= world->scene_slot_capacity) {
+		const u32 old_capacity = world->scene_slot_capacity;
+
+		world->scene_slot_capacity = world->entity_capacity > id ? world->entity_capacity : id + 1;
+		world->scene_slots = core_realloc(world->scene_slots, world->scene_slot_capacity * sizeof(struct scene_slot));
+
+		memset(world->scene_slots + old_capacity, 0,
+			(world->scene_slot_capacity - old_capacity) * sizeof(struct scene_slot));
+	}
+
+	assert(!entity_scene_slot(world, e) && "Entities can only be in one scene at a time.");
+
+	if (scene->count >= scene->capacity) {
+		scene->capacity = scene->capacity < 8 ? 8 : scene->capacity * 2;
+		scene->entities = core_realloc(scene->entities, scene->capacity * sizeof(entity));
+	}
+
+	world->scene_slots[id] = (struct scene_slot) { scene, scene->count };
+	scene->entities[scene->count++] = e;
+}
+
+void scene_remove(struct scene* scene, entity e) {
+	struct scene_slot* slot = entity_scene_slot(scene->world, e);
+	if (slot && slot->scene == scene) {
+		scene_erase(scene->world, slot);
+	}
+}
+
+struct scene* get_entity_scene(struct world* world, entity e) {
+	struct scene_slot* slot = entity_scene_slot(world, e);
+	return slot ? slot->scene : null;
+}
+
+const char* get_scene_name(struct scene* scene) {
+	return scene->name;
+}
+
+u32 get_scene_size(struct scene* scene) {
+	return scene->count;
+}
+
+entity* get_scene_entities(struct scene* scene) {
+	return scene->entities;
 }
 
 struct entity_buffer* new_entity_buffer() {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+
 #include "common.h"
 #include "core.h"
 
@@ -11,7 +13,14 @@
  *
  * ECS was used more as a structural choice, because I like working with it, rather
  * than one specifically for performance. As such, this is not the fastest ECS in the
- * world. */
+ * world.
+ *
+ * Components are stored in fixed-size pages, so a pointer returned by
+ * `get_component' stays valid while components are added to the world. It
+ * is invalidated when a component of the same type is removed, since the last
+ * component in the pool is moved into the hole, or when the entity's group
+ * membership changes. Entities may be created and destroyed freely while a
+ * view is being iterated. */
 
 #define add_componentv(w_, e_, t_, ...) \
 	do { \
@@ -39,8 +48,28 @@
 	view_valid(&(v_)); \
 	view_next(&(v_))
 
+/* Types are found by name among the view's own types, which were resolved
+ * when the view was made, so these never touch the type registry; See
+ * `view_for_each_parallel'. */
 #define view_get(v_, t_) \
-	((t_*)_view_get((v_), type_info(t_)))
+	((t_*)_view_get((v_), (#t_)))
+
+#define view_get_mut(v_, t_) \
+	((t_*)_view_get_mut((v_), (#t_)))
+
+#define view_changed(w_, v_, s_, ...) \
+	struct view v_ = new_view_changed((w_), (s_), (sizeof((struct type_info[]){__VA_ARGS__})/sizeof(struct type_info)), (struct type_info[]) { __VA_ARGS__ }); \
+	view_valid(&(v_)); \
+	view_next(&(v_))
+
+#define get_component_mut(w_, e_, t_) \
+	((t_*)_get_component_mut((w_), (e_), type_info(t_)))
+
+#define set_component_tracking(w_, t_) \
+	_set_component_tracking((w_), type_info(t_))
+
+#define component_changed(w_, e_, t_, s_) \
+	_component_changed((w_), (e_), type_info(t_), (s_))
 
 #define set_component_create_func(w_, t_, f_) \
 	_set_component_create_func((w_), type_info(t_), (f_))
@@ -48,6 +77,31 @@
 #define set_component_destroy_func(w_, t_, f_) \
 	_set_component_destroy_func((w_), type_info(t_), (f_))
 
+#define set_component_snapshot_funcs(w_, t_, s_, l_) \
+	_set_component_snapshot_funcs((w_), type_info(t_), (s_), (l_))
+
+#define set_component_soa(w_, t_, ...) \
+	_set_component_soa((w_), type_info(t_), (sizeof((struct component_field[]){__VA_ARGS__})/sizeof(struct component_field)), \
+		(struct component_field[]) { __VA_ARGS__ })
+
+#define component_field(t_, f_) \
+	{ offsetof(t_, f_), sizeof(((t_*)0)->f_) }
+
+#define read_component(w_, e_, t_, o_) \
+	_read_component((w_), (e_), type_info(t_), (o_))
+
+#define write_component(w_, e_, t_, i_) \
+	do { \
+		t_ in = i_; \
+		_write_component((w_), (e_), type_info(t_), &in); \
+	} while (0)
+
+#define get_component_array(w_, t_, b_, c_) \
+	((t_*)_get_component_array((w_), type_info(t_), (b_), (c_)))
+
+#define get_component_field_array(w_, t_, f_, b_, c_) \
+	_get_component_field_array((w_), type_info(t_), (f_), (b_), (c_))
+
 typedef u64 entity;
 typedef u32 entity_version;
 typedef u32 entity_id;
@@ -63,6 +117,7 @@ struct world;
 
 typedef void (*component_create_func)(struct world* world, entity e, void* component);
 typedef void (*component_destroy_func)(struct world* world, entity e, void* component);
+typedef void (*component_snapshot_func)(struct world* world, entity e, void* component);
 
 API struct world* new_world();
 API void free_world(struct world* world);
@@ -75,6 +130,12 @@ API u32 get_entity_component_types(struct world* world, entity e, struct type_in
 API u32 get_component_pool_count(struct world* world);
 API u32 get_alive_entity_count(struct world* world);
 
+/* While a world is locked, creating or destroying entities and adding or
+ * removing components assert in debug builds. Used while the world is
+ * shared between threads; See `view_for_each_parallel' and scheduler.h. */
+API void lock_world(struct world* world);
+API void unlock_world(struct world* world);
+
 API void _set_component_create_func(struct world* world, struct type_info type, component_create_func f);
 API void _set_component_destroy_func(struct world* world, struct type_info type, component_create_func f);
 
@@ -83,24 +144,315 @@ API void* _add_component(struct world* world,    entity e, struct type_info type
 API void  _remove_component(struct world* world, entity e, struct type_info type);
 API bool  _has_component(struct world* world,    entity e, struct type_info type);
 API void* _get_component(struct world* world,    entity e, struct type_info type);
+API void* _get_component_mut(struct world* world, entity e, struct type_info type);
+API void  _read_component(struct world* world,   entity e, struct type_info type, void* out);
+API void  _write_component(struct world* world,  entity e, struct type_info type, const void* in);
+
+/* Change tracking.
+ *
+ * A pool can be set to record the tick on which each of its components was
+ * last changed, so that systems can skip entities whose components haven't.
+ * The world's tick is advanced by `world_tick', which the game calls once a
+ * frame.
+ *
+ * Adding a component counts as changing it, as do `write_component' and
+ * the `_mut' getters, `get_component_mut' and `view_get_mut'. Writes through
+ * plain `get_component' and `view_get' pointers aren't seen, so anything that
+ * writes to a tracked type should use the `_mut' getters.
+ *
+ * `view_changed' is a view that only visits the entities where at least one
+ * of the tracked components in the view was changed on or after tick `s_'.
+ * Passing the tick from the previous visit may visit some entities again,
+ * but never misses a change:
+ *
+ *     for (view_changed(world, view, cache->tick, type_info(struct transform))) {
+ *         ...
+ *     }
+ *     cache->tick = get_world_tick(world);
+ *
+ * Untracked types in the view only filter, like in a normal view. For a
+ * pool that isn't tracked, `component_changed' is always true. */
+API void _set_component_tracking(struct world* world, struct type_info type);
+API bool _component_changed(struct world* world, entity e, struct type_info type, u32 since);
+API u32 get_world_tick(struct world* world);
+API u32 world_tick(struct world* world);
+
+/* Structure of arrays pools.
+ *
+ * By default, a pool stores whole components one after the other. A pool can
+ * instead be declared to store each of a list of fields in its own array, so
+ * that a loop over just a few fields of many components touches only the
+ * memory it needs, and can be vectorised. This has to be declared before any
+ * components of the type are added, for example:
+ *
+ *     set_component_soa(world, struct fall,
+ *         component_field(struct fall, mul),
+ *         component_field(struct fall, velocity.x),
+ *         component_field(struct fall, velocity.y));
+ *
+ * Anything that isn't covered by a field isn't stored, and reads back as
+ * zero. Since the fields of a component aren't next to each other, there is
+ * nothing to point to: `get_component', `view_get' and `group_view_get'
+ * assert on these pools, and `add_component' returns null. Use
+ * `read_component' and `write_component' for single components, and
+ * `get_component_field_array' for loops.
+ *
+ * The array getters return the components, or the field of the components,
+ * starting at index `b_' in the pool, and write to `c_' how many of them are
+ * contiguous from there. Run them over an owning group, whose members sit at
+ * the same indices [0, `get_group_size') in every pool it owns:
+ *
+ *     for (u32 i = 0, n = get_group_size(group); i < n;) {
+ *         u32 c0, c1;
+ *         f32* y = get_component_field_array(world, struct fall, 2, i, &c0);
+ *         f32* py = get_component_field_array(world, struct transform, 1, i, &c1);
+ *         const u32 c = minimum(c0, c1);
+ *
+ *         for (u32 ii = 0; ii < c; ii++) { py[ii] += y[ii] * ts; }
+ *
+ *         i += c;
+ *     }
+ *
+ * Each field's array is aligned to 16 bytes at the start of a page. */
+struct component_field {
+	u32 offset;
+	u32 size;
+};
+
+API void  _set_component_soa(struct world* world, struct type_info type, u32 field_count, struct component_field* fields);
+API void* _get_component_array(struct world* world, struct type_info type, u32 begin, u32* count);
+API void* _get_component_field_array(struct world* world, struct type_info type, u32 field, u32 begin, u32* count);
+
+/* Creates `count' entities that all have the same set of component types.
+ * `init' holds, for each of `types', an array of `count' components to copy
+ * in, or null to zero them; `init' itself may be null to zero everything.
+ * The new handles are written to `out'.
+ *
+ * Every pool involved is grown once and filled a page at a time, so this
+ * is much cheaper than the equivalent `new_entity' and `add_component'
+ * calls when spawning many entities at once. Create functions are called
+ * after all of the components have been added. */
+API void spawn_batch(struct world* world, u32 count, u32 type_count, struct type_info* types, void** init, entity* out);
+
+/* World snapshots.
+ *
+ * `world_snapshot_write' copies every entity and component in the world into
+ * one allocation, to be freed with `core_free', and `world_snapshot_read'
+ * replaces the contents of a world with one. Pools are copied a page at a
+ * time, so both are little more than a `memcpy' of the world's memory.
+ *
+ * Components are copied as they are, so any pointers in them are only
+ * meaningful to the same process, and only while what they point to lives.
+ * Types that hold pointers that need to survive longer, such as to a room
+ * or a name that will be freed, can be given snapshot functions: `s_' is
+ * called on each copy in the snapshot as it is written, and may replace
+ * pointers with something that lasts, like an ID; `l_' is called on each
+ * component in the world after it is read, to turn them back. Structure of
+ * arrays pools can't have snapshot functions.
+ *
+ * Reading calls the destroy functions of the components that are thrown
+ * away, but not the create functions of the ones read in. Groups are sorted
+ * again, and tracked components count as changed. Pools are matched by type
+ * name, and must have been set up in the same way, structure of arrays or
+ * not, as in the world that was written. Scenes are matched by name too;
+ * Members of a scene that the world doesn't have aren't put in any scene.
+ * Returns false, leaving the world as it was, if the snapshot can't be
+ * read. */
+API void _set_component_snapshot_funcs(struct world* world, struct type_info type,
+	component_snapshot_func save, component_snapshot_func load);
+API void* world_snapshot_write(struct world* world, u64* size);
+API bool world_snapshot_read(struct world* world, const void* snapshot, u64 size);
+
+/* Splits a snapshot into the parts that it is made of, for tools that
+ * compare snapshots of the same world, like rewind.h. A part is identified
+ * by its key in every snapshot of the world that has it, and keys only
+ * increase through a snapshot. Writes up to `max' sections and returns how
+ * many there are; `sections' may be null to count them. */
+struct snapshot_section {
+	u32 key;
+	u64 offset;
+	u64 size;
+};
+
+API u32 world_snapshot_sections(const void* snapshot, u64 size, struct snapshot_section* sections, u32 max);
+
+/* A hash of which entities are alive and of their components of the given
+ * types, for telling whether two runs of the same thing ended up in the
+ * same state. Components are hashed as they are stored, so only types that
+ * hold no pointers, and whose padding is always zeroed, should be given. */
+API u64 world_hash(struct world* world, const struct type_info* types, u32 type_count);
+
+/* Every entity has a signature; A bitset of the component types that it
+ * has, indexed by the type's registry index. Views and groups test entities
+ * against a mask of their types, and destroying an entity only visits the
+ * pools that its signature names. */
+#define max_component_types 128
+#define signature_words (max_component_types / 64)
 
 #define view_max 16
 struct view {
-	u32 to_pool[view_max];
+	u64 mask[signature_words];
+	const char* names[view_max];
 	void* pools[view_max];
 	u32 pool_count;
 	void* pool;
 	u32 idx;
 	entity e;
 
+	bool changed_only;
+	u32 since;
+
 	struct world* world;
 };
 
 API struct view new_view(struct world* world, u32 type_count, struct type_info* types);
+API struct view new_view_changed(struct world* world, u32 since, u32 type_count, struct type_info* types);
 API bool view_valid(struct view* view);
-API void* _view_get(struct view* view, struct type_info type);
+API void* _view_get(struct view* view, const char* name);
+API void* _view_get_mut(struct view* view, const char* name);
 API void view_next(struct view* view);
 
+/* Calls `f_' for every entity that the view over the given types would visit,
+ * spreading the work over the job threads (see jobs.h) in chunks of `g_'
+ * entities. The view passed to `f_' is positioned on the entity, so that
+ * `view_get' and `view.e' work as they normally would. Entities are visited in
+ * no particular order.
+ *
+ * The world can't be changed structurally until it returns: No creating or
+ * destroying entities and no adding or removing components, which is
+ * asserted on in debug builds. Writing to the components of the entity being
+ * visited is fine; Anything else that's shared is up to the caller.
+ *
+ * The types are resolved on the calling thread, before any job starts.
+ * `view_get' and `view_get_mut' go through the view rather than the type
+ * registry, so they are safe to call from `f_'; Anything else that takes a
+ * `type_info', such as `get_component', is not (see `type_index').
+ *
+ * Views with fewer than `g_' entities are run on the calling thread without
+ * waking any threads at all. */
+#define view_for_each_parallel(w_, f_, u_, g_, ...) \
+	_view_for_each_parallel((w_), (sizeof((struct type_info[]){__VA_ARGS__})/sizeof(struct type_info)), \
+		(struct type_info[]) { __VA_ARGS__ }, (f_), (u_), (g_))
+
+typedef void (*view_func)(struct view* view, void* udata);
+
+API void _view_for_each_parallel(struct world* world, u32 type_count, struct type_info* types,
+	view_func func, void* udata, u32 grain);
+
+/* Owning groups.
+ *
+ * A group takes ownership of the pools of the components that it is created
+ * with, and keeps them sorted so that the entities that have every one of
+ * those components are packed together at the front of each pool, at the
+ * same index. Iterating a group is then a linear walk over the pools, with
+ * no need to check whether each entity has the other components.
+ *
+ * A pool may only be owned by more than one group if the groups nest; That
+ * is, if the components of one group are a subset of the components of the
+ * other. Groups should be created up-front, straight after the world, and
+ * not while iterating.
+ *
+ * Entities that gain the components of a group are queued and only sorted in
+ * when the group is next iterated, so adding components never moves the
+ * components of other entities. Removing a component from an entity that is
+ * in a group, however, moves the last member of the group into its place. */
+#define get_group(w_, ...) \
+	_get_group((w_), (sizeof((struct type_info[]){__VA_ARGS__})/sizeof(struct type_info)), (struct type_info[]) { __VA_ARGS__ })
+
+#define group_view(g_, v_) \
+	struct group_view v_ = new_group_view((g_)); \
+	group_view_valid(&(v_)); \
+	group_view_next(&(v_))
+
+#define group_view_get(v_, t_) \
+	((t_*)_group_view_get((v_), type_info(t_)))
+
+struct group;
+
+struct group_view {
+	u32 to_pool[view_max];
+	void* pools[view_max];
+	u32 pool_count;
+	u32 idx;
+	entity e;
+
+	struct group* group;
+	struct world* world;
+};
+
+API struct group* _get_group(struct world* world, u32 type_count, struct type_info* types);
+API u32 get_group_size(struct group* group);
+
+API struct group_view new_group_view(struct group* group);
+API bool group_view_valid(struct group_view* view);
+API void* _group_view_get(struct group_view* view, struct type_info type);
+API void group_view_next(struct group_view* view);
+
+/* Command buffers.
+ *
+ * Records structural changes to be made to a world later, at a point where
+ * nothing is iterating it. Recording never touches a world, so each thread
+ * can record into its own buffer while systems run in parallel.
+ *
+ * `cmd_new_entity' returns a placeholder handle that is only meaningful to
+ * the buffer that made it; It can be passed to the other commands in the same
+ * buffer, and becomes a real entity once the buffer is applied.
+ *
+ * `apply_ecs_commands' creates the new entities first, then adds and removes
+ * components grouped by type, so that each pool is touched once, and finally
+ * destroys entities. Commands of the same type run in the order they were
+ * recorded. Commands on entities that are no longer valid are skipped, and
+ * adding a component an entity already has overwrites it. The buffer is
+ * emptied, but keeps its memory, so it can be reused every frame. */
+#define cmd_add_componentv(c_, e_, t_, ...) \
+	do { \
+		t_ init = (t_) { __VA_ARGS__ }; \
+		_cmd_add_component((c_), (e_), type_info(t_), &init); \
+	} while (0)
+
+#define cmd_add_component(c_, e_, t_, i_) \
+	do { \
+		t_ init = i_; \
+		_cmd_add_component((c_), (e_), type_info(t_), &init); \
+	} while (0)
+
+#define cmd_remove_component(c_, e_, t_) \
+	_cmd_remove_component((c_), (e_), type_info(t_))
+
+struct ecs_commands;
+
+API struct ecs_commands* new_ecs_commands();
+API void free_ecs_commands(struct ecs_commands* cmds);
+API entity cmd_new_entity(struct ecs_commands* cmds);
+API void cmd_destroy_entity(struct ecs_commands* cmds, entity e);
+API void _cmd_add_component(struct ecs_commands* cmds, entity e, struct type_info type, void* init);
+API void _cmd_remove_component(struct ecs_commands* cmds, entity e, struct type_info type);
+API void apply_ecs_commands(struct ecs_commands* cmds, struct world* world);
+
+/* Scenes.
+ *
+ * A scene owns a set of entities so that they can all be destroyed at once,
+ * such as everything that a level spawned when the level is unloaded.
+ * Members are kept in a dense list, and each entity remembers which scene it
+ * is in, so destroying a member on its own takes it out of the scene, and
+ * destroying a scene costs time proportional to its own members rather than
+ * to the size of the world. An entity can be in at most one scene.
+ *
+ * The name is only for debugging. `clear_scene' destroys every member and
+ * leaves the scene empty to be reused; `free_scene' does the same and then
+ * frees it. */
+struct scene;
+
+API struct scene* new_scene(struct world* world, const char* name);
+API void free_scene(struct scene* scene);
+API void clear_scene(struct scene* scene);
+API void scene_add(struct scene* scene, entity e);
+API void scene_remove(struct scene* scene, entity e);
+API struct scene* get_entity_scene(struct world* world, entity e);
+API const char* get_scene_name(struct scene* scene);
+API u32 get_scene_size(struct scene* scene);
+API entity* get_scene_entities(struct scene* scene);
+
 #define entity_buffer_default_alloc 8
 
 /* The purpose of this entity buffer was for when the ECS used
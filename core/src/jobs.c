@@ -0,0 +1,197 @@
+#include <assert.h>
+
+#include "core.h"
+#include "jobs.h"
+#include "platform.h"
+#include "rng.h"
+
+#define max_job_threads 64
+
+struct job_batch {
+	job_func func;
+	void* udata;
+
+	u32 count;
+	u32 grain;
+
+	/* The start of the next chunk to hand out, guarded by `jobs.mutex'. */
+	u32 next;
+};
+
+/* The workers are started the first time they are needed, and then park on
+ * `wake' between calls. A call bumps `generation', and the first
+ * `active_count' workers take part in it; `busy' counts down as they finish,
+ * so that the caller knows when nobody is looking at the batch any more. */
+static struct {
+	struct thread* threads[max_job_threads];
+	u32 seen[max_job_threads];
+	u32 thread_count;
+
+	struct mutex* mutex;
+	struct cond* wake;
+	struct cond* done;
+
+	struct job_batch* batch;
+	u32 generation;
+	u32 active_count;
+	u32 busy;
+	bool quit;
+
+	bool running;
+} jobs;
+
+static void job_batch_work(struct job_batch* batch) {
+	for (;;) {
+		lock_mutex(jobs.mutex);
+		const u32 begin = batch->next;
+		if (begin < batch->count) {
+			batch->next = batch->count - begin > batch->grain ? begin + batch->grain : batch->count;
+		}
+		const u32 end = batch->next;
+		unlock_mutex(jobs.mutex);
+
+		if (begin >= batch->count) { break; }
+
+		batch->func(begin, end, batch->udata);
+	}
+}
+
+static void job_thread_worker(struct thread* thread) {
+	const u32 index = (u32)(uintptr_t)get_thread_uptr(thread);
+
+	/* The calling thread is stream zero. */
+	set_thread_rng_stream(index + 1);
+
+	lock_mutex(jobs.mutex);
+
+	for (;;) {
+		while (!jobs.quit && jobs.seen[index] == jobs.generation) {
+			cond_wait(jobs.wake, jobs.mutex);
+		}
+
+		if (jobs.quit) { break; }
+
+		jobs.seen[index] = jobs.generation;
+
+		if (index >= jobs.active_count) { continue; }
+
+		struct job_batch* batch = jobs.batch;
+
+		unlock_mutex(jobs.mutex);
+		job_batch_work(batch);
+		lock_mutex(jobs.mutex);
+
+		if (--jobs.busy == 0) {
+			cond_signal(jobs.done);
+		}
+	}
+
+	unlock_mutex(jobs.mutex);
+}
+
+void set_job_thread_count(u32 count) {
+	assert(!jobs.running);
+
+	jobs.thread_count = count < 1 ? 1 : (count > max_job_threads ? max_job_threads : count);
+}
+
+u32 get_job_thread_count() {
+	if (jobs.thread_count == 0) {
+		set_job_thread_count(get_processor_count());
+	}
+
+	return jobs.thread_count;
+}
+
+void run_jobs(u32 count, u32 grain, job_func func, void* udata) {
+	assert(!jobs.running && "`run_jobs' can't be called from inside of a job.");
+
+	if (count == 0) { return; }
+
+	if (grain == 0) { grain = 1; }
+
+	const u32 chunk_count = (count + grain - 1) / grain;
+
+	u32 thread_count = get_job_thread_count();
+	if (thread_count > chunk_count) {
+		thread_count = chunk_count;
+	}
+
+	/* Not worth waking any threads for. */
+	if (thread_count <= 1) {
+		func(0, count, udata);
+		return;
+	}
+
+	if (!jobs.mutex) {
+		jobs.mutex = new_mutex(0);
+		jobs.wake = new_cond();
+		jobs.done = new_cond();
+	}
+
+	struct job_batch batch = {
+		.func = func,
+		.udata = udata,
+		.count = count,
+		.grain = grain
+	};
+
+	jobs.running = true;
+
+	lock_mutex(jobs.mutex);
+
+	/* New workers have already seen every call before this one. */
+	for (u32 i = 0; i < thread_count - 1; i++) {
+		if (!jobs.threads[i]) {
+			jobs.seen[i] = jobs.generation;
+			jobs.threads[i] = new_thread(job_thread_worker);
+			set_thread_uptr(jobs.threads[i], (void*)(uintptr_t)i);
+			thread_execute(jobs.threads[i]);
+		}
+	}
+
+	jobs.batch = &batch;
+	jobs.active_count = thread_count - 1;
+	jobs.busy = thread_count - 1;
+	jobs.generation++;
+
+	cond_broadcast(jobs.wake);
+	unlock_mutex(jobs.mutex);
+
+	job_batch_work(&batch);
+
+	lock_mutex(jobs.mutex);
+	while (jobs.busy > 0) {
+		cond_wait(jobs.done, jobs.mutex);
+	}
+
+	jobs.batch = null;
+	unlock_mutex(jobs.mutex);
+
+	jobs.running = false;
+}
+
+void deinit_jobs() {
+	if (jobs.mutex) {
+		lock_mutex(jobs.mutex);
+		jobs.quit = true;
+		cond_broadcast(jobs.wake);
+		unlock_mutex(jobs.mutex);
+	}
+
+	for (u32 i = 0; i < max_job_threads; i++) {
+		if (jobs.threads[i]) {
+			free_thread(jobs.threads[i]);
+			jobs.threads[i] = null;
+		}
+	}
+
+	if (jobs.mutex) {
+		free_mutex(jobs.mutex);
+		free_cond(jobs.wake);
+		free_cond(jobs.done);
+		jobs.mutex = null;
+	}
+
+	jobs.quit = false;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "common.h"
+
+/* A minimal job system for data-parallel loops.
+ *
+ * `run_jobs' splits the range [0, count) into chunks of `grain' items and
+ * hands them out to the job threads, with the calling thread taking chunks
+ * too, returning once every chunk is done. The threads are started the
+ * first time they are needed, and wait on a condition variable between
+ * calls, so a call costs a wake-up rather than starting threads. They are
+ * stopped by `deinit_jobs'.
+ *
+ * Jobs may not call `run_jobs' themselves. */
+
+typedef void (*job_func)(u32 begin, u32 end, void* udata);
+
+/* The number of threads that work on a call to `run_jobs', including the
+ * calling thread. Defaults to the number of processors. */
+API void set_job_thread_count(u32 count);
+API u32 get_job_thread_count();
+
+API void run_jobs(u32 count, u32 grain, job_func func, void* udata);
+
+API void deinit_jobs();
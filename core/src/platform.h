@@ -14,6 +14,11 @@ struct window;
 typedef void (*on_text_input_func)(struct window* window, const char* text, void* udata);
 
 API struct window* new_window(v2i size, const char* title, bool resizable);
+
+/* A window that isn't shown, with no OpenGL context, for running the game
+ * without a display (see `video_init_headless'). It never receives any
+ * input, and stays open until it is told to close. */
+API struct window* new_headless_window(v2i size);
 API void free_window(struct window* window);
 API void swap_window(struct window* window);
 API void update_events(struct window* window);
@@ -142,6 +147,26 @@ enum {
 	mouse_btn_count
 };
 
+/* Everything that a window knows about its input on a frame, so that it can
+ * be recorded and played back (see `replay.h'). Setting it replaces what
+ * `update_events' found, until the next call. Text input isn't included. */
+struct input_state {
+	bool held_keys[key_count];
+	bool pressed_keys[key_count];
+	bool released_keys[key_count];
+
+	bool held_btns[mouse_btn_count];
+	bool pressed_btns[mouse_btn_count];
+	bool released_btns[mouse_btn_count];
+
+	v2i mouse_pos;
+	v2i mouse_delta;
+	i32 scroll;
+};
+
+API void get_window_input(struct window* window, struct input_state* state);
+API void set_window_input(struct window* window, const struct input_state* state);
+
 enum {
 	cursor_pointer = 0,
 	cursor_hand,
@@ -169,6 +194,11 @@ API bool file_is_regular(const char* name);
 API bool file_is_dir(const char* name);
 API u64 file_mod_time(const char* name);
 
+/* Maps the whole of a file into memory, for reading only, and writes its
+ * size to `size'. Returns null if it can't be opened or is empty. */
+API const void* map_file(const char* name, u64* size);
+API void unmap_file(const void* data, u64 size);
+
 API const char* get_file_name(const char* path);
 API const char* get_file_extension(const char* name);
 API char* get_file_path(const char* name);
@@ -194,3 +224,18 @@ API void free_mutex(struct mutex* mutex);
 API void lock_mutex(struct mutex* mutex);
 API void unlock_mutex(struct mutex* mutex);
 API void* mutex_get_ptr(struct mutex* mutex);
+
+/* Condition variables, for threads that wait on each other.
+ *
+ * `cond_wait' must be called with the mutex locked, and returns with it
+ * locked again. It may return without being woken, so always wait in a loop
+ * that checks the condition. */
+struct cond;
+
+API struct cond* new_cond();
+API void free_cond(struct cond* cond);
+API void cond_wait(struct cond* cond, struct mutex* mutex);
+API void cond_signal(struct cond* cond);
+API void cond_broadcast(struct cond* cond);
+
+API u32 get_processor_count();
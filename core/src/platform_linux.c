@@ -3,9 +3,12 @@
 #include <string.h>
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <unistd.h>
 
 #include "core.h"
 #include "platform.h"
@@ -129,6 +132,38 @@ u64 file_mod_time(const char* name) {
 	return 0;
 }
 
+const void* map_file(const char* name, u64* size) {
+	*size = 0;
+
+	i32 fd = open(name, O_RDONLY);
+	if (fd == -1) {
+		return null;
+	}
+
+	struct stat s;
+	if (fstat(fd, &s) == -1 || s.st_size == 0) {
+		close(fd);
+		return null;
+	}
+
+	void* data = mmap(null, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	/* The mapping keeps the file open. */
+	close(fd);
+
+	if (data == MAP_FAILED) {
+		return null;
+	}
+
+	*size = (u64)s.st_size;
+
+	return data;
+}
+
+void unmap_file(const void* data, u64 size) {
+	munmap((void*)data, (size_t)size);
+}
+
 char* get_file_path(const char* name) {
 	char* r = core_alloc(256);
 
@@ -243,3 +278,37 @@ void unlock_mutex(struct mutex* mutex) {
 void* mutex_get_ptr(struct mutex* mutex) {
 	return mutex->data;
 }
+
+struct cond {
+	pthread_cond_t c;
+};
+
+struct cond* new_cond() {
+	struct cond* cond = core_calloc(1, sizeof(struct cond));
+
+	pthread_cond_init(&cond->c, null);
+
+	return cond;
+}
+
+void free_cond(struct cond* cond) {
+	pthread_cond_destroy(&cond->c);
+	core_free(cond);
+}
+
+void cond_wait(struct cond* cond, struct mutex* mutex) {
+	pthread_cond_wait(&cond->c, &mutex->m);
+}
+
+void cond_signal(struct cond* cond) {
+	pthread_cond_signal(&cond->c);
+}
+
+void cond_broadcast(struct cond* cond) {
+	pthread_cond_broadcast(&cond->c);
+}
+
+u32 get_processor_count() {
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (u32)count : 1;
+}
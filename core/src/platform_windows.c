@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <string.h>
 
 #include <windows.h>
 #include "util/glad.h"
@@ -45,6 +46,7 @@ struct window {
 	bool resizable;
 	bool repeat;
 	bool mouse_locked;
+	bool headless;
 
 	HWND hwnd;
 	HDC device_context;
@@ -337,7 +339,23 @@ struct window* new_window(v2i size, const char* title, bool resizable) {
 	return window;
 }
 
+struct window* new_headless_window(v2i size) {
+	struct window* window = core_calloc(1, sizeof(struct window));
+
+	window->headless = true;
+	window->open = true;
+	window->w = size.x;
+	window->h = size.y;
+
+	return window;
+}
+
 void free_window(struct window* window) {
+	if (window->headless) {
+		core_free(window);
+		return;
+	}
+
 	PostQuitMessage(0);
 	DestroyWindow(window->hwnd);
 	wglDeleteContext(window->render_context);
@@ -351,16 +369,22 @@ void swap_window(struct window* window) {
 	memset(window->pressed_btns, 0, mouse_btn_count * sizeof(bool));
 	memset(window->released_btns, 0, mouse_btn_count * sizeof(bool));
 
+	if (window->headless) { return; }
+
 	SwapBuffers(window->device_context);
 }
 
 void window_make_context_current(struct window* window) {
+	if (window->headless) { return; }
+
 	wglMakeCurrent(window->device_context, window->render_context);
 }
 
 void update_events(struct window* window) {
 	window->scroll = 0;
 
+	if (window->headless) { return; }
+
 	MSG msg;
 
 	while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE) > 0) {
@@ -423,6 +447,34 @@ v2i get_mouse_delta(struct window* window) {
 	return window->mouse_delta;
 }
 
+void get_window_input(struct window* window, struct input_state* state) {
+	memcpy(state->held_keys, window->held_keys, sizeof(state->held_keys));
+	memcpy(state->pressed_keys, window->pressed_keys, sizeof(state->pressed_keys));
+	memcpy(state->released_keys, window->released_keys, sizeof(state->released_keys));
+
+	memcpy(state->held_btns, window->held_btns, sizeof(state->held_btns));
+	memcpy(state->pressed_btns, window->pressed_btns, sizeof(state->pressed_btns));
+	memcpy(state->released_btns, window->released_btns, sizeof(state->released_btns));
+
+	state->mouse_pos = window->mouse_pos;
+	state->mouse_delta = window->mouse_delta;
+	state->scroll = window->scroll;
+}
+
+void set_window_input(struct window* window, const struct input_state* state) {
+	memcpy(window->held_keys, state->held_keys, sizeof(state->held_keys));
+	memcpy(window->pressed_keys, state->pressed_keys, sizeof(state->pressed_keys));
+	memcpy(window->released_keys, state->released_keys, sizeof(state->released_keys));
+
+	memcpy(window->held_btns, state->held_btns, sizeof(state->held_btns));
+	memcpy(window->pressed_btns, state->pressed_btns, sizeof(state->pressed_btns));
+	memcpy(window->released_btns, state->released_btns, sizeof(state->released_btns));
+
+	window->mouse_pos = state->mouse_pos;
+	window->mouse_delta = state->mouse_delta;
+	window->scroll = state->scroll;
+}
+
 void set_on_text_input(struct window* window, on_text_input_func func) {
 	window->on_text_input = func;
 }
@@ -440,10 +492,18 @@ void set_window_should_close(struct window* window, bool close) {
 }
 
 void set_window_size(struct window* window, v2i size) {
+	if (window->headless) {
+		window->w = size.x;
+		window->h = size.y;
+		return;
+	}
+
 	SetWindowPos(window->hwnd, 0, 0, 0, size.x, size.y, SWP_NOMOVE);
 }
 
 void set_window_fullscreen(struct window* window, bool fullscreen) {
+	if (window->headless) { return; }
+
 	if (fullscreen) {
 		POINT Point = { 0 };
 		HMONITOR Monitor = MonitorFromPoint(Point, MONITOR_DEFAULTTONEAREST);
@@ -565,6 +625,46 @@ bool file_is_dir(const char* name) {
 	return attribs & FILE_ATTRIBUTE_DIRECTORY;
 }
 
+const void* map_file(const char* name, u64* size) {
+	*size = 0;
+
+	HANDLE file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, null, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, null);
+	if (file == INVALID_HANDLE_VALUE) {
+		return null;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return null;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, null, PAGE_READONLY, 0, 0, null);
+
+	/* The view keeps both open. */
+	CloseHandle(file);
+
+	if (!mapping) {
+		return null;
+	}
+
+	const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	CloseHandle(mapping);
+
+	if (!data) {
+		return null;
+	}
+
+	*size = (u64)file_size.QuadPart;
+
+	return data;
+}
+
+void unmap_file(const void* data, u64 size) {
+	UnmapViewOfFile(data);
+}
+
 u64 file_mod_time(const char* name) {
 	HANDLE file = CreateFileA(name, GENERIC_READ, 0, null, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, null);
 
@@ -598,6 +698,8 @@ u32 get_window_cursor(struct window* window) {
 void set_window_cursor(struct window* window, u32 id) {
 	window->cursor = id;
 
+	if (window->headless) { return; }
+
 	HCURSOR c;
 
 	switch (id) {
@@ -625,11 +727,17 @@ void window_enable_repeat(struct window* window, bool enable) {
 
 void lock_mouse(struct window* window) {
 	window->mouse_locked = true;
+
+	if (window->headless) { return; }
+
 	ShowCursor(false);
 }
 
 void unlock_mouse(struct window* window) {
 	window->mouse_locked = false;
+
+	if (window->headless) { return; }
+
 	ShowCursor(true);
 }
 
@@ -718,8 +826,11 @@ void set_thread_uptr(struct thread* thread, void* ptr) {
 	thread->uptr = ptr;
 }
 
+/* A critical section rather than a mutex object, so that condition
+ * variables can wait on it. Both can be locked again by the thread that
+ * holds them. */
 struct mutex {
-	HANDLE handle;
+	CRITICAL_SECTION section;
 
 	void* data;
 };
@@ -727,7 +838,7 @@ struct mutex {
 struct mutex* new_mutex(u64 size) {
 	struct mutex* mutex = core_calloc(1, sizeof(struct mutex));
 
-	mutex->handle = CreateMutex(null, false, null);
+	InitializeCriticalSection(&mutex->section);
 
 	if (size > 0) {
 		mutex->data = core_calloc(1, size);
@@ -737,7 +848,7 @@ struct mutex* new_mutex(u64 size) {
 }
 
 void free_mutex(struct mutex* mutex) {
-	CloseHandle(mutex->handle);
+	DeleteCriticalSection(&mutex->section);
 
 	if (mutex->data) {
 		core_free(mutex->data);
@@ -747,13 +858,48 @@ void free_mutex(struct mutex* mutex) {
 }
 
 void lock_mutex(struct mutex* mutex) {
-	WaitForSingleObject(mutex->handle, INFINITE);
+	EnterCriticalSection(&mutex->section);
 }
 
 void unlock_mutex(struct mutex* mutex) {
-	ReleaseMutex(mutex->handle);
+	LeaveCriticalSection(&mutex->section);
 }
 
 void* mutex_get_ptr(struct mutex* mutex) {
 	return mutex->data;
+}
+
+struct cond {
+	CONDITION_VARIABLE c;
+};
+
+struct cond* new_cond() {
+	struct cond* cond = core_calloc(1, sizeof(struct cond));
+
+	InitializeConditionVariable(&cond->c);
+
+	return cond;
+}
+
+void free_cond(struct cond* cond) {
+	core_free(cond);
+}
+
+void cond_wait(struct cond* cond, struct mutex* mutex) {
+	SleepConditionVariableCS(&cond->c, &mutex->section, INFINITE);
+}
+
+void cond_signal(struct cond* cond) {
+	WakeConditionVariable(&cond->c);
+}
+
+void cond_broadcast(struct cond* cond) {
+	WakeAllConditionVariable(&cond->c);
+}
+
+u32 get_processor_count() {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	return info.dwNumberOfProcessors > 0 ? (u32)info.dwNumberOfProcessors : 1;
 }
\ No newline at end of file
@@ -51,6 +51,7 @@ struct window {
 
 	bool fullscreen;
 	bool repeat;
+	bool headless;
 
 	void* uptr;
 
@@ -262,7 +263,23 @@ struct window* new_window(v2i size, const char* title, bool resizable) {
 	return window;
 }
 
+struct window* new_headless_window(v2i size) {
+	struct window* window = core_calloc(1, sizeof(struct window));
+
+	window->headless = true;
+	window->open = true;
+	window->w = size.x;
+	window->h = size.y;
+
+	return window;
+}
+
 void free_window(struct window* window) {
+	if (window->headless) {
+		core_free(window);
+		return;
+	}
+
 	glXDestroyContext(window->display, window->context);
 
 	XFreeColormap(window->display, window->colormap);
@@ -283,10 +300,14 @@ void swap_window(struct window* window) {
 
 	window->scroll = 0;
 
+	if (window->headless) { return; }
+
 	glXSwapBuffers(window->display, window->window);
 }
 
 void window_make_context_current(struct window* window) {
+	if (window->headless) { return; }
+
 	glXMakeCurrent(window->display, window->window, window->context);
 }
 
@@ -297,6 +318,8 @@ i32 get_scroll(struct window* window) {
 void update_events(struct window* window) {
 	window->mouse_delta = make_v2i(0, 0);
 
+	if (window->headless) { return; }
+
 	KeySym sym;
 
 	while (XPending(window->display)) {
@@ -410,6 +433,12 @@ void update_events(struct window* window) {
 }
 
 void set_window_size(struct window* window, v2i size) {
+	if (window->headless) {
+		window->w = size.x;
+		window->h = size.y;
+		return;
+	}
+
 	if (!window->resizable) {
 		/* This works by setting the miniumum and maximum heights of the window
 		 * to the input width and height. I'm not sure if this is the correct
@@ -430,6 +459,8 @@ void set_window_size(struct window* window, v2i size) {
 }
 
 void set_window_fullscreen(struct window* window, bool fullscreen) {
+	if (window->headless) { return; }
+
 	Atom wm_state = XInternAtom(window->display, "_NET_WM_STATE", False);
 	Atom fs = XInternAtom(window->display, "_NET_WM_STATE_FULLSCREEN", False);
 	XEvent xev = { 0 };
@@ -497,6 +528,34 @@ v2i get_mouse_delta(struct window* window) {
 	return window->mouse_delta;
 }
 
+void get_window_input(struct window* window, struct input_state* state) {
+	memcpy(state->held_keys, window->held_keys, sizeof(state->held_keys));
+	memcpy(state->pressed_keys, window->pressed_keys, sizeof(state->pressed_keys));
+	memcpy(state->released_keys, window->released_keys, sizeof(state->released_keys));
+
+	memcpy(state->held_btns, window->held_btns, sizeof(state->held_btns));
+	memcpy(state->pressed_btns, window->pressed_btns, sizeof(state->pressed_btns));
+	memcpy(state->released_btns, window->released_btns, sizeof(state->released_btns));
+
+	state->mouse_pos = window->mouse_pos;
+	state->mouse_delta = window->mouse_delta;
+	state->scroll = window->scroll;
+}
+
+void set_window_input(struct window* window, const struct input_state* state) {
+	memcpy(window->held_keys, state->held_keys, sizeof(state->held_keys));
+	memcpy(window->pressed_keys, state->pressed_keys, sizeof(state->pressed_keys));
+	memcpy(window->released_keys, state->released_keys, sizeof(state->released_keys));
+
+	memcpy(window->held_btns, state->held_btns, sizeof(state->held_btns));
+	memcpy(window->pressed_btns, state->pressed_btns, sizeof(state->pressed_btns));
+	memcpy(window->released_btns, state->released_btns, sizeof(state->released_btns));
+
+	window->mouse_pos = state->mouse_pos;
+	window->mouse_delta = state->mouse_delta;
+	window->scroll = state->scroll;
+}
+
 void set_on_text_input(struct window* window, on_text_input_func func) {
 	window->on_text_input = func;
 }
@@ -512,6 +571,8 @@ void set_window_should_close(struct window* window, bool close) {
 void lock_mouse(struct window* window) {
 	window->mouse_locked = true;
 
+	if (window->headless) { return; }
+
 	XColor col;
 	char data[1] = {0X00};
 	Pixmap blank = XCreateBitmapFromData(window->display, window->window, data, 1, 1);
@@ -523,6 +584,8 @@ void lock_mouse(struct window* window) {
 void unlock_mouse(struct window* window) {
 	window->mouse_locked = false;
 
+	if (window->headless) { return; }
+
 	XUndefineCursor(window->display, window->window);
 }
 
@@ -537,6 +600,8 @@ u32 get_window_cursor(struct window* window) {
 void set_window_cursor(struct window* window, u32 id) {
 	window->cursor = id;
 
+	if (window->headless) { return; }
+
 	Cursor c;
 	
 	switch (id) {
@@ -11,11 +11,25 @@
 #include "util/stb_truetype.h"
 #include "video.h"
 
-#define batch_size 100
-#define els_per_vert 11
+#define els_per_vert 12
 #define verts_per_quad 4
 #define indices_per_quad 6
 
+/* Batches that are smaller than a full one are streamed one after the other,
+ * so the vertex buffer holds a few of them before it has to be orphaned. */
+#define ring_batches 2
+
+/* The last texture unit is kept for the texture array. */
+#define max_texture_slots 31
+#define texture_array_unit 31
+
+/* Matches `light_block' in the sprite shader, laid out with std140: The
+ * count is padded out to 16 bytes, and then each light is a vec2 and two
+ * floats, which is how `struct light' is laid out already. */
+#define light_block_binding 0
+#define light_block_lights_offset 16
+#define light_block_size (light_block_lights_offset + max_lights * sizeof(struct light))
+
 #define MAX_GLYPHSET 256
 
 struct color make_color(u32 rgb, u8 alpha) {
@@ -27,6 +41,10 @@ struct rect make_rect(i32 x, i32 y, i32 w, i32 h) {
 }
 
 struct renderer* new_renderer(struct shader shader, v2i dimentions) {
+	return new_renderer_ex(shader, dimentions, default_batch_size);
+}
+
+struct renderer* new_renderer_ex(struct shader shader, v2i dimentions, u32 batch_size) {
 	struct renderer* renderer = core_calloc(1, sizeof(struct renderer));
 
 	renderer->quad_count = 0;
@@ -34,26 +52,59 @@ struct renderer* new_renderer(struct shader shader, v2i dimentions) {
 
 	renderer->ambient_light = 1.0f;
 
+	renderer->batch_size = batch_size;
+	renderer->verts = core_alloc(batch_size * els_per_vert * verts_per_quad * sizeof(f32));
+
+	u32* indices = core_alloc(batch_size * indices_per_quad * sizeof(u32));
+	for (u32 i = 0; i < batch_size; i++) {
+		const u32 idx_off = i * verts_per_quad;
+		u32* quad = indices + i * indices_per_quad;
+
+		quad[0] = idx_off + 3; quad[1] = idx_off + 2; quad[2] = idx_off + 1;
+		quad[3] = idx_off + 3; quad[4] = idx_off + 1; quad[5] = idx_off + 0;
+	}
+
 	init_vb(&renderer->vb, vb_dynamic | vb_tris);
 	bind_vb_for_edit(&renderer->vb);
-	push_vertices(&renderer->vb, null, els_per_vert * verts_per_quad * batch_size);
-	push_indices(&renderer->vb, null, indices_per_quad * batch_size);
+	push_vertices(&renderer->vb, null, els_per_vert * verts_per_quad * batch_size * ring_batches);
+	push_indices(&renderer->vb, indices, indices_per_quad * batch_size);
 	configure_vb(&renderer->vb, 0, 2, els_per_vert, 0);  /* vec2 position */
 	configure_vb(&renderer->vb, 1, 2, els_per_vert, 2);  /* vec2 uv */
 	configure_vb(&renderer->vb, 2, 4, els_per_vert, 4);  /* vec4 color */
 	configure_vb(&renderer->vb, 3, 1, els_per_vert, 8);  /* f32 texture_id */
 	configure_vb(&renderer->vb, 4, 1, els_per_vert, 9);  /* f32 inverted */
 	configure_vb(&renderer->vb, 5, 1, els_per_vert, 10); /* f32 unlit */
+	configure_vb(&renderer->vb, 6, 1, els_per_vert, 11); /* f32 layer */
 	bind_vb_for_edit(null);
 
+	core_free(indices);
+
 	renderer->clip_enable = false;
 	renderer->camera_enable = false;
 
 	renderer->shader = shader;
 	bind_shader(&renderer->shader);
 
+	/* Each texture slot always uses the same texture unit. */
+	for (u32 i = 0; i < max_texture_slots; i++) {
+		char name[32];
+		sprintf(name, "textures[%u]", i);
+
+		shader_set_i(&renderer->shader, name, i);
+	}
+
+	shader_set_i(&renderer->shader, "texture_array", texture_array_unit);
+
+	shader_bind_block(&renderer->shader, "light_block", light_block_binding);
+	init_uniform_buffer(&renderer->light_buffer, light_block_size);
+	renderer->lights_dirty = true;
+
+	renderer->camera_location = shader_get_location(&renderer->shader, "camera");
+	renderer->view_location = shader_get_location(&renderer->shader, "view");
+	renderer->ambient_light_location = shader_get_location(&renderer->shader, "ambient_light");
+
 	renderer->camera = m4f_orth(0.0f, (f32)dimentions.x, (f32)dimentions.y, 0.0f, -1.0f, 1.0f);
-	shader_set_m4f(&renderer->shader, "camera", renderer->camera);
+	shader_set_m4f_at(&renderer->shader, renderer->camera_location, renderer->camera);
 	renderer->dimentions = dimentions;
 
 	bind_shader(null);
@@ -63,6 +114,9 @@ struct renderer* new_renderer(struct shader shader, v2i dimentions) {
 
 void free_renderer(struct renderer* renderer) {
 	deinit_vb(&renderer->vb);
+	deinit_uniform_buffer(&renderer->light_buffer);
+
+	core_free(renderer->verts);
 
 	core_free(renderer);
 }
@@ -70,6 +124,8 @@ void free_renderer(struct renderer* renderer) {
 void renderer_flush(struct renderer* renderer) {
 	if (renderer->quad_count == 0) { return; }
 
+	const u64 start = get_time();
+
 	if (renderer->clip_enable) {
 		video_enable(vt_clip);
 		video_clip((struct rect) { renderer->clip.x, renderer->dimentions.y - (renderer->clip.y + renderer->clip.h),
@@ -82,100 +138,150 @@ void renderer_flush(struct renderer* renderer) {
 
 	for (u32 i = 0; i < renderer->texture_count; i++) {
 		bind_texture(renderer->textures[i], i);
-
-		char name[32];
-		sprintf(name, "textures[%u]", i);
-
-		shader_set_i(&renderer->shader, name, i);
 	}
 
-	for (u32 i = 0; i < renderer->light_count; i++) {
-		char name[64];
-
-		sprintf(name, "lights[%u].position", i);
-		shader_set_v2f(&renderer->shader, name, renderer->lights[i].position);
+	if (renderer->texture_array) {
+		bind_texture_array(renderer->texture_array, texture_array_unit);
+	}
 
-		sprintf(name, "lights[%u].intensity", i);
-		shader_set_f(&renderer->shader, name, renderer->lights[i].intensity);
+	if (renderer->lights_dirty || renderer->light_count != renderer->uploaded_light_count) {
+		const i32 count = (i32)renderer->light_count;
+		update_uniform_buffer(&renderer->light_buffer, &count, 0, sizeof(count));
+		update_uniform_buffer(&renderer->light_buffer, renderer->lights, light_block_lights_offset,
+			renderer->light_count * sizeof(struct light));
 
-		sprintf(name, "lights[%u].range", i);
-		shader_set_f(&renderer->shader, name, renderer->lights[i].range);
+		renderer->uploaded_light_count = renderer->light_count;
+		renderer->lights_dirty = false;
+		renderer->stats.light_uploads++;
 	}
 
-	shader_set_i(&renderer->shader, "light_count", renderer->light_count);
+	bind_uniform_buffer(&renderer->light_buffer, light_block_binding);
 
-	shader_set_m4f(&renderer->shader, "camera", renderer->camera);
-	shader_set_f(&renderer->shader, "ambient_light", renderer->ambient_light);
+	shader_set_m4f_at(&renderer->shader, renderer->camera_location, renderer->camera);
+	shader_set_f_at(&renderer->shader, renderer->ambient_light_location, renderer->ambient_light);
 
 	if (renderer->camera_enable) {
 		m4f view = m4f_translate(m4f_identity(), make_v3f(
 			-((f32)renderer->camera_pos.x) + ((f32)renderer->dimentions.x / 2),
 			-((f32)renderer->camera_pos.y) + ((f32)renderer->dimentions.y / 2),
 			0.0f));
-		shader_set_m4f(&renderer->shader, "view", view);
+		shader_set_m4f_at(&renderer->shader, renderer->view_location, view);
 	} else {
-		shader_set_m4f(&renderer->shader, "view", m4f_identity());
+		shader_set_m4f_at(&renderer->shader, renderer->view_location, m4f_identity());
 	}
 
 	bind_vb_for_edit(&renderer->vb);
-	update_vertices(&renderer->vb, renderer->verts, 0, renderer->quad_count * els_per_vert * verts_per_quad);
-	update_indices(&renderer->vb, renderer->indices, 0, renderer->quad_count * indices_per_quad);
+	const u32 offset = stream_vertices(&renderer->vb, renderer->verts, renderer->quad_count * els_per_vert * verts_per_quad);
 	bind_vb_for_edit(null);
 
 	bind_vb_for_draw(&renderer->vb);
-	draw_vb_n(&renderer->vb, renderer->quad_count * indices_per_quad);
+	draw_vb_n_base(&renderer->vb, renderer->quad_count * indices_per_quad, offset / els_per_vert);
 	bind_vb_for_draw(null);
 	bind_shader(null);
 
+	renderer->stats.draw_calls++;
+	renderer->stats.quad_count += renderer->quad_count;
+
 	renderer->quad_count = 0;
 	renderer->texture_count = 0;
 
 	video_disable(vt_clip);
+
+	renderer->stats.flush_time += (f64)(get_time() - start) / (f64)get_frequency();
 }
 
 void renderer_end_frame(struct renderer* renderer) {
 	renderer_flush(renderer);
 	renderer->light_count = 0;
+
+	renderer->last_frame_stats = renderer->stats;
+	renderer->stats = (struct renderer_stats) { 0 };
+}
+
+struct renderer_stats get_renderer_stats(const struct renderer* renderer) {
+	return renderer->last_frame_stats;
 }
 
 void renderer_push_light(struct renderer* renderer, struct light light) {
-	if (renderer->light_count > max_lights) {
+	if (renderer->light_count >= max_lights) {
 		fprintf(stderr, "Too many lights! Max: %d\n", max_lights);
 		return;
 	}
 
-	renderer->lights[renderer->light_count++] = light;
+	struct light* slot = renderer->lights + renderer->light_count++;
+	if (memcmp(slot, &light, sizeof(light)) != 0) {
+		*slot = light;
+		renderer->lights_dirty = true;
+	}
 }
 
-void renderer_push(struct renderer* renderer, struct textured_quad* quad) {
+/* A texture's slot is kept on the texture, and checked against the slot
+ * before it's used, so finding it usually doesn't need a search. Textures
+ * that are shared between renderers have the slot of whichever used them
+ * last, so the slots are searched before a new one is taken. */
+static i32 renderer_texture_index(struct renderer* renderer, struct texture* texture) {
+	if (texture->slot < renderer->texture_count && renderer->textures[texture->slot] == texture) {
+		return (i32)texture->slot;
+	}
+
+	for (u32 i = 0; i < renderer->texture_count; i++) {
+		if (renderer->textures[i] == texture) {
+			texture->slot = i;
+			return (i32)i;
+		}
+	}
+
+	if (renderer->texture_count >= max_texture_slots) {
+		renderer_flush(renderer);
+	}
+
+	texture->slot = renderer->texture_count++;
+	renderer->textures[texture->slot] = texture;
+
+	return (i32)texture->slot;
+}
+
+/* Writes the quad's vertices straight into the batch.
+ *
+ * Quads are placed as though they went through the transform:
+ *
+ *     translate(position) * translate(origin) * rotate(rotation)
+ *         * scale(dimentions) * translate(-origin)
+ *
+ * where the origin only counts if both of its parts are non-zero, but
+ * without building it. The vertex positions also have one added to them,
+ * because that is what `m4f_transform' used to do when this was done with
+ * matrices, and everything has been placed to suit it since. */
+force_inline void write_quad(struct renderer* renderer, const struct textured_quad* quad) {
 	f32 tx = 0, ty = 0, tw = 0, th = 0;
 
 	i32 tidx = -1;
+	i32 layer = -1;
 	if (quad->texture) {
-		for (u32 i = 0; i < renderer->texture_count; i++) {
-			if (renderer->textures[i] == quad->texture) {
-				tidx = (i32)i;
-				break;
-			}
+		struct texture* texture = quad->texture;
+
+		/* Sheets that live on an atlas page are drawn from the page. */
+		i32 x = quad->rect.x, y = quad->rect.y;
+		if (texture->page) {
+			x += (i32)texture->page_x;
+			y += (i32)texture->page_y;
+			texture = texture->page;
 		}
 
-		if (tidx == -1) {
-			renderer->textures[renderer->texture_count] = quad->texture;
-			tidx = renderer->texture_count;
-
-			renderer->texture_count++;
+		u32 width = texture->width, height = texture->height;
 
-			if (renderer->texture_count >= 32) {
-				renderer_flush(renderer);
-				tidx = 0;
-				renderer->textures[0] = quad->texture;
-			}
+		if (texture->array && texture->array == renderer->texture_array) {
+			layer = (i32)texture->layer;
+			width = renderer->texture_array->width;
+			height = renderer->texture_array->height;
+		} else {
+			tidx = renderer_texture_index(renderer, texture);
 		}
 
-		tx = (f32)quad->rect.x/ (f32)quad->texture->width;
-		ty = (f32)quad->rect.y/ (f32)quad->texture->height;
-		tw = (f32)quad->rect.w/ (f32)quad->texture->width;
-		th = (f32)quad->rect.h/ (f32)quad->texture->height;
+		tx = (f32)x/ (f32)width;
+		ty = (f32)y/ (f32)height;
+		tw = (f32)quad->rect.w/ (f32)width;
+		th = (f32)quad->rect.h/ (f32)height;
 	}
 
 	const f32 r = (f32)quad->color.r / 255.0f;
@@ -185,48 +291,79 @@ void renderer_push(struct renderer* renderer, struct textured_quad* quad) {
 
 	const f32 w = (f32)quad->dimentions.x;
 	const f32 h = (f32)quad->dimentions.y;
-	const f32 x = (f32)quad->position.x;
-	const f32 y = (f32)quad->position.y;
 
 	const bool use_origin = quad->origin.x != 0.0f && quad->origin.y != 0.0f;
-
-	m4f transform = m4f_translate(m4f_identity(), (v3f) { (f32)quad->position.x, (f32)quad->position.y, 0.0f });
-
-	transform = use_origin ? m4f_translate(transform, (v3f) { quad->origin.x, quad->origin.y, 0.0f }) : transform;
-
-	if (quad->rotation != 0.0f) {
-		transform = m4f_rotate(transform, toradf(quad->rotation), (v3f) { 0.0f, 0.0f, 1.0f });
+	const f32 ox = use_origin ? quad->origin.x : 0.0f;
+	const f32 oy = use_origin ? quad->origin.y : 0.0f;
+
+	/* The centre of rotation, and the corners relative to it. */
+	const f32 cx = (f32)quad->position.x + ox + 1.0f;
+	const f32 cy = (f32)quad->position.y + oy + 1.0f;
+	const f32 x0 = -w * ox, x1 = x0 + w;
+	const f32 y0 = -h * oy, y1 = y0 + h;
+
+	f32 px[4], py[4];
+	if (quad->rotation == 0.0f) {
+		px[0] = cx + x0; py[0] = cy + y0;
+		px[1] = cx + x1; py[1] = cy + y0;
+		px[2] = cx + x1; py[2] = cy + y1;
+		px[3] = cx + x0; py[3] = cy + y1;
+	} else {
+		const f32 angle = toradf(quad->rotation);
+		const f32 c = (f32)cos((f64)angle);
+		const f32 s = (f32)sin((f64)angle);
+
+		px[0] = cx + c * x0 - s * y0; py[0] = cy + s * x0 + c * y0;
+		px[1] = cx + c * x1 - s * y0; py[1] = cy + s * x1 + c * y0;
+		px[2] = cx + c * x1 - s * y1; py[2] = cy + s * x1 + c * y1;
+		px[3] = cx + c * x0 - s * y1; py[3] = cy + s * x0 + c * y1;
 	}
 
-	transform = m4f_scale(transform, (v3f) { (f32)quad->dimentions.x, (f32)quad->dimentions.y, 0.0f });
-	transform = use_origin ? m4f_translate(transform, (v3f) {-quad->origin.x, -quad->origin.y, 0.0f }) : transform;
+	const f32 us[4] = { tx, tx + tw, tx + tw, tx };
+	const f32 vs[4] = { ty, ty, ty + th, ty + th };
+
+	f32* v = renderer->verts + (renderer->quad_count * els_per_vert * verts_per_quad);
+	for (u32 i = 0; i < verts_per_quad; i++, v += els_per_vert) {
+		v[0] = px[i];
+		v[1] = py[i];
+		v[2] = us[i];
+		v[3] = vs[i];
+		v[4] = r;
+		v[5] = g;
+		v[6] = b;
+		v[7] = a;
+		v[8] = (f32)tidx;
+		v[9] = (f32)quad->inverted;
+		v[10] = (f32)quad->unlit;
+		v[11] = (f32)layer;
+	}
 
-	const v4f p0 = m4f_transform(transform, make_v4f(0.0f, 0.0f, 0.0f, 1.0f));
-	const v4f p1 = m4f_transform(transform, make_v4f(1.0f, 0.0f, 0.0f, 1.0f));
-	const v4f p2 = m4f_transform(transform, make_v4f(1.0f, 1.0f, 0.0f, 1.0f));
-	const v4f p3 = m4f_transform(transform, make_v4f(0.0f, 1.0f, 0.0f, 1.0f));
+	renderer->quad_count++;
+}
 
-	f32 verts[] = {
-		p0.x, p0.y, tx, ty,           r, g, b, a, (f32)tidx, (f32)quad->inverted, (f32)quad->unlit,
-		p1.x, p1.y, tx + tw, ty,      r, g, b, a, (f32)tidx, (f32)quad->inverted, (f32)quad->unlit,
-		p2.x, p2.y, tx + tw, ty + th, r, g, b, a, (f32)tidx, (f32)quad->inverted, (f32)quad->unlit,
-		p3.x, p3.y, tx, ty + th,      r, g, b, a, (f32)tidx, (f32)quad->inverted, (f32)quad->unlit
-	};
+void renderer_push(struct renderer* renderer, struct textured_quad* quad) {
+	write_quad(renderer, quad);
 
-	const u32 idx_off = renderer->quad_count * verts_per_quad;
+	if (renderer->quad_count >= renderer->batch_size) {
+		renderer_flush(renderer);
+	}
+}
 
-	u32 indices[] = {
-		idx_off + 3, idx_off + 2, idx_off + 1,
-		idx_off + 3, idx_off + 1, idx_off + 0
-	};
+void renderer_push_n(struct renderer* renderer, const struct textured_quad* quads, u32 count) {
+	while (count > 0) {
+		const u32 room = renderer->batch_size - renderer->quad_count;
+		const u32 n = count < room ? count : room;
 
-	memcpy(renderer->verts + (renderer->quad_count * els_per_vert * verts_per_quad), verts, els_per_vert * verts_per_quad * sizeof(f32));
-	memcpy(renderer->indices + (renderer->quad_count * indices_per_quad), indices, indices_per_quad * sizeof(u32));
+		for (u32 i = 0; i < n; i++) {
+			write_quad(renderer, quads + i);
+		}
 
-	renderer->quad_count++;
+		quads += n;
+		count -= n;
 
-	if (renderer->quad_count >= batch_size) {
-		renderer_flush(renderer);
+		if (renderer->quad_count >= renderer->batch_size) {
+			renderer_flush(renderer);
+		}
 	}
 }
 
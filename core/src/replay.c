@@ -0,0 +1,196 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "core.h"
+#include "replay.h"
+
+#define recording_version 1
+
+struct recording_header {
+	char magic[4];
+	u32 version;
+	u64 seed;
+};
+
+/* The keys and buttons, one bit each, followed by the mouse. */
+#define recording_bit_count ((key_count + mouse_btn_count) * 3)
+#define recording_state_size (((recording_bit_count + 7) / 8) + sizeof(i32) * 5)
+
+struct input_recording {
+	FILE* file;
+	bool writing;
+
+	u64 seed;
+	u32 frame;
+
+	struct input_state last;
+};
+
+static void put_bits(u8* bits, u32* bit, const bool* src, u32 count) {
+	for (u32 i = 0; i < count; i++, (*bit)++) {
+		if (src[i]) {
+			bits[*bit / 8] |= 1 << (*bit % 8);
+		}
+	}
+}
+
+static void get_bits(const u8* bits, u32* bit, bool* dst, u32 count) {
+	for (u32 i = 0; i < count; i++, (*bit)++) {
+		dst[i] = (bits[*bit / 8] >> (*bit % 8)) & 1;
+	}
+}
+
+static void pack_state(const struct input_state* state, u8* out) {
+	memset(out, 0, recording_state_size);
+
+	u32 bit = 0;
+	put_bits(out, &bit, state->held_keys, key_count);
+	put_bits(out, &bit, state->pressed_keys, key_count);
+	put_bits(out, &bit, state->released_keys, key_count);
+	put_bits(out, &bit, state->held_btns, mouse_btn_count);
+	put_bits(out, &bit, state->pressed_btns, mouse_btn_count);
+	put_bits(out, &bit, state->released_btns, mouse_btn_count);
+
+	i32 mouse[5] = {
+		state->mouse_pos.x, state->mouse_pos.y,
+		state->mouse_delta.x, state->mouse_delta.y,
+		state->scroll
+	};
+
+	memcpy(out + (recording_bit_count + 7) / 8, mouse, sizeof(mouse));
+}
+
+static void unpack_state(const u8* in, struct input_state* state) {
+	u32 bit = 0;
+	get_bits(in, &bit, state->held_keys, key_count);
+	get_bits(in, &bit, state->pressed_keys, key_count);
+	get_bits(in, &bit, state->released_keys, key_count);
+	get_bits(in, &bit, state->held_btns, mouse_btn_count);
+	get_bits(in, &bit, state->pressed_btns, mouse_btn_count);
+	get_bits(in, &bit, state->released_btns, mouse_btn_count);
+
+	i32 mouse[5];
+	memcpy(mouse, in + (recording_bit_count + 7) / 8, sizeof(mouse));
+
+	state->mouse_pos = make_v2i(mouse[0], mouse[1]);
+	state->mouse_delta = make_v2i(mouse[2], mouse[3]);
+	state->scroll = mouse[4];
+}
+
+struct input_recording* new_input_recording(const char* path, u64 seed) {
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		fprintf(stderr, "Failed to open `%s' for write.\n", path);
+		return null;
+	}
+
+	struct recording_header header = {
+		.magic = { 'O', 'M', 'V', 'R' },
+		.version = recording_version,
+		.seed = seed
+	};
+
+	fwrite(&header, sizeof(header), 1, file);
+
+	struct input_recording* recording = core_calloc(1, sizeof(struct input_recording));
+
+	recording->file = file;
+	recording->writing = true;
+	recording->seed = seed;
+
+	return recording;
+}
+
+struct input_recording* open_input_recording(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		fprintf(stderr, "Failed to open `%s'.\n", path);
+		return null;
+	}
+
+	struct recording_header header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "OMVR", 4) != 0) {
+		fprintf(stderr, "`%s' isn't an input recording.\n", path);
+		fclose(file);
+		return null;
+	}
+
+	if (header.version != recording_version) {
+		fprintf(stderr, "`%s' is an input recording of version %u; Expected version %u.\n",
+			path, header.version, recording_version);
+		fclose(file);
+		return null;
+	}
+
+	struct input_recording* recording = core_calloc(1, sizeof(struct input_recording));
+
+	recording->file = file;
+	recording->writing = false;
+	recording->seed = header.seed;
+
+	return recording;
+}
+
+void free_input_recording(struct input_recording* recording) {
+	fclose(recording->file);
+	core_free(recording);
+}
+
+u64 get_input_recording_seed(struct input_recording* recording) {
+	return recording->seed;
+}
+
+u32 get_input_recording_frame(struct input_recording* recording) {
+	return recording->frame;
+}
+
+void record_input(struct input_recording* recording, struct window* window, f64 ts) {
+	assert(recording->writing);
+
+	struct input_state state;
+	memset(&state, 0, sizeof(state));
+	get_window_input(window, &state);
+
+	/* The first frame is always written, since there is nothing before it
+	 * to be the same as. */
+	const u8 changed = recording->frame == 0 || memcmp(&state, &recording->last, sizeof(state)) != 0;
+
+	fwrite(&ts, sizeof(ts), 1, recording->file);
+	fwrite(&changed, sizeof(changed), 1, recording->file);
+
+	if (changed) {
+		u8 packed[recording_state_size];
+		pack_state(&state, packed);
+		fwrite(packed, sizeof(packed), 1, recording->file);
+
+		recording->last = state;
+	}
+
+	recording->frame++;
+}
+
+bool replay_input(struct input_recording* recording, struct window* window, f64* ts) {
+	assert(!recording->writing);
+
+	u8 changed;
+	if (fread(ts, sizeof(*ts), 1, recording->file) != 1 ||
+		fread(&changed, sizeof(changed), 1, recording->file) != 1) {
+		return false;
+	}
+
+	if (changed) {
+		u8 packed[recording_state_size];
+		if (fread(packed, sizeof(packed), 1, recording->file) != 1) {
+			return false;
+		}
+
+		unpack_state(packed, &recording->last);
+	}
+
+	set_window_input(window, &recording->last);
+
+	recording->frame++;
+
+	return true;
+}
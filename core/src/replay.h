@@ -0,0 +1,32 @@
+#pragma once
+
+#include "common.h"
+#include "platform.h"
+
+/* Input recording.
+ *
+ * Records a window's input and the timestep on every frame to a file, so
+ * that a session can be played again exactly. Together with seeding the
+ * random number generator (see `seed_random') with the seed that the
+ * recording was made with, and running the frames with the timesteps that
+ * were recorded, the game does the same thing every time it is replayed.
+ *
+ * `record_input' is called once a frame, after `update_events'.
+ * `replay_input' is called in the same place instead, and replaces the
+ * window's input with what was recorded; It returns false once every frame
+ * has been played.
+ *
+ * Input only takes space on the frames where it changed; Other frames are
+ * nine bytes, for the timestep and a flag. */
+
+struct input_recording;
+
+API struct input_recording* new_input_recording(const char* path, u64 seed);
+API struct input_recording* open_input_recording(const char* path);
+API void free_input_recording(struct input_recording* recording);
+
+API u64 get_input_recording_seed(struct input_recording* recording);
+API u32 get_input_recording_frame(struct input_recording* recording);
+
+API void record_input(struct input_recording* recording, struct window* window, f64 ts);
+API bool replay_input(struct input_recording* recording, struct window* window, f64* ts);
@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "core.h"
+#include "platform.h"
 #include "res.h"
 #include "table.h"
 
@@ -41,130 +42,251 @@ bool read_raw_no_pck(const char* path, u8** buf, u64* size, bool term) {
 	return true;
 }
 
-#if DEBUG
-bool read_raw(const char* path, u8** buf, u64* size, bool term) {
-	return read_raw_no_pck(path, buf, size, term);
+/* The package starts with the size of its header, in bytes and counting the
+ * size itself, followed by an entry for each file, and then the files. */
+struct package_entry {
+	u64 hash;
+	u64 offset;
+	u64 size;
+};
+
+struct package {
+	const u8* data;
+	u64 size;
+
+	/* Sorted by hash. Points into the mapping, unless the package was made
+	 * before the packer sorted them, in which case it is a sorted copy. */
+	const struct package_entry* entries;
+	struct package_entry* sorted;
+	u64 entry_count;
+};
+
+static i32 package_entry_cmp(const void* a, const void* b) {
+	const u64 x = ((const struct package_entry*)a)->hash;
+	const u64 y = ((const struct package_entry*)b)->hash;
+	return (x > y) - (x < y);
 }
 
-struct file file_open(const char* path) {
-	FILE* handle = fopen(path, "rb");
-	if (!handle) {
-		return (struct file) { 0 };
+struct package* open_package(const char* path) {
+	u64 size;
+	const u8* data = map_file(path, &size);
+	if (!data) {
+		fprintf(stderr, "Failed to open `%s'\n", path);
+		return null;
 	}
 
-	fseek(handle, 0, SEEK_END);
-	u64 size = ftell(handle);
-	fseek(handle, 0, SEEK_SET);
+	u64 header_size;
+	if (size < sizeof(header_size)) { goto corrupt; }
 
-	return (struct file) { handle, 0, 0, size };
-}
+	memcpy(&header_size, data, sizeof(header_size));
+	if (header_size < sizeof(header_size) || header_size > size) { goto corrupt; }
 
-bool file_good(struct file* file) {
-	return file->handle != null;
-}
+	struct package* package = core_calloc(1, sizeof(struct package));
 
-void file_close(struct file* file) {
-	fclose(file->handle);
-	file->handle = null;
-}
+	package->data = data;
+	package->size = size;
+	package->entry_count = (header_size - sizeof(header_size)) / sizeof(struct package_entry);
+	package->entries = (const struct package_entry*)(data + sizeof(header_size));
 
-u64 file_seek(struct file* file, u64 offset) {
-	file->cursor = offset;
-	return file->cursor;
-}
+	for (u64 i = 1; i < package->entry_count; i++) {
+		if (package->entries[i - 1].hash > package->entries[i].hash) {
+			const u64 bytes = package->entry_count * sizeof(struct package_entry);
 
-u64 file_read(void* buf, u64 size, u64 count, struct file* file) {
-	fseek(file->handle, (i32)(file->pk_offset + file->cursor), SEEK_SET);
+			package->sorted = core_alloc(bytes);
+			memcpy(package->sorted, package->entries, bytes);
+			qsort(package->sorted, package->entry_count, sizeof(struct package_entry), package_entry_cmp);
 
-	file->cursor += size * count;
+			package->entries = package->sorted;
+			break;
+		}
+	}
+
+	return package;
 
-	return fread(buf, size, count, file->handle);
+corrupt:
+	fprintf(stderr, "`%s' isn't a valid package.\n", path);
+	unmap_file(data, size);
+	return null;
 }
-#else
-bool read_raw(const char* path, u8** buf, u64* size, bool term) {
-	FILE* file = fopen(package_path, "rb");
-	if (!file) {
-		fprintf(stderr, "Failed to open `%s'\n", package_path);
-		return false;
+
+void close_package(struct package* package) {
+	if (package->sorted) {
+		core_free(package->sorted);
 	}
 
-	fseek(file, 0, SEEK_SET);
+	unmap_file(package->data, package->size);
+	core_free(package);
+}
 
-	u64 header_el_size = sizeof(u64) * 3;
-	u64 header_size;
-	fread(&header_size, sizeof(header_size), 1, file);
-	u64 header_count = header_size / header_el_size;
+bool package_find(struct package* package, const char* path, const u8** data, u64* size) {
+	const u64 hash = elf_hash((const u8*)path, (u32)strlen(path));
 
-	u64 name_hash = elf_hash((const u8*)path, strlen(path));
+	u64 lo = 0, hi = package->entry_count;
+	while (lo < hi) {
+		const u64 mid = lo + (hi - lo) / 2;
 
-	for (u64 i = 0; i < header_count; i++) {
-		u64 hash, offset, f_size;
+		if (package->entries[mid].hash < hash) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
 
-		fread(&hash, sizeof(hash), 1, file);
-		fread(&offset, sizeof(offset), 1, file);
-		fread(&f_size, sizeof(f_size), 1, file);
+	if (lo >= package->entry_count || package->entries[lo].hash != hash) {
+		return false;
+	}
 
-		if (hash == name_hash) {
-			if (size) {
-				*size = f_size;
-			}
-			*buf = core_alloc(f_size + (term ? 1 : 0));
+	const struct package_entry* entry = package->entries + lo;
+	if (entry->offset > package->size || entry->size > package->size - entry->offset) {
+		return false;
+	}
+
+	*data = package->data + entry->offset;
+	*size = entry->size;
 
-			fseek(file, offset, SEEK_SET);
-			fread(*buf, 1, f_size, file);
+	return true;
+}
 
-			if (term) {
-					*((*buf) + f_size) = '\0';
-			}
+/* Loaded from the package by `res_init'; Always empty in debug, where
+ * sprite sheets are loaded as they are. */
+static struct atlas_entry* atlas_entries;
+static u32 atlas_entry_count;
 
-			fclose(file);
-			return true;
+static const struct atlas_entry* find_atlas_entry(const char* path) {
+	const u64 hash = elf_hash((const u8*)path, (u32)strlen(path));
+
+	u32 lo = 0, hi = atlas_entry_count;
+	while (lo < hi) {
+		const u32 mid = lo + (hi - lo) / 2;
+
+		if (atlas_entries[mid].hash < hash) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
 		}
 	}
-	
-	fprintf(stderr, "Failed to read file from package: %s\n", path);
 
-	fclose(file);
-	return false;
+	if (lo >= atlas_entry_count || atlas_entries[lo].hash != hash) {
+		return null;
+	}
+
+	return atlas_entries + lo;
+}
+
+#if DEBUG
+bool read_raw(const char* path, u8** buf, u64* size, bool term) {
+	return read_raw_no_pck(path, buf, size, term);
+}
+
+bool read_raw_view(const char* path, const u8** buf, u64* size) {
+	return read_raw_no_pck(path, (u8**)buf, size, false);
 }
 
+void free_raw_view(const u8* buf) {
+	core_free((void*)buf);
+}
+
+/* Loose files are mapped on their own. */
 struct file file_open(const char* path) {
-	FILE* handle = fopen(package_path, "rb");
-	if (!handle) {
+	u64 size;
+	const u8* data = map_file(path, &size);
+	if (!data) {
 		return (struct file) { 0 };
 	}
 
-	u64 header_el_size = sizeof(u64) * 3;
-	u64 header_size;
-	fread(&header_size, sizeof(header_size), 1, handle);
-	u64 header_count = header_size / header_el_size;
+	return (struct file) { data, 0, size };
+}
+
+void file_close(struct file* file) {
+	if (file->data) {
+		unmap_file(file->data, file->size);
+	}
+
+	file->data = null;
+}
+#else
+/* Opened by `res_init', and kept mapped until `res_deinit'. */
+static struct package* res_package;
 
-	u64 name_hash = elf_hash((const u8*)path, strlen(path));
+bool read_raw(const char* path, u8** buf, u64* size, bool term) {
+	const u8* data;
+	u64 data_size;
 
-	for (u64 i = 0; i < header_count; i++) {
-		u64 hash, offset, f_size;
+	if (!res_package || !package_find(res_package, path, &data, &data_size)) {
+		fprintf(stderr, "Failed to read file from package: %s\n", path);
+		return false;
+	}
 
-		fread(&hash, sizeof(hash), 1, handle);
-		fread(&offset, sizeof(offset), 1, handle);
-		fread(&f_size, sizeof(f_size), 1, handle);
+	*buf = core_alloc(data_size + (term ? 1 : 0));
+	memcpy(*buf, data, data_size);
 
-		if (hash == name_hash) {
-			return (struct file) { handle, offset, 0, f_size };
-		}
+	if (term) {
+		*((*buf) + data_size) = '\0';
 	}
 
-	fclose(handle);
+	if (size) {
+		*size = data_size + (term ? 1 : 0);
+	}
 
-	return (struct file) { 0 };
+	return true;
 }
 
-bool file_good(struct file* file) {
-	return file->handle != null;
+/* Copied out of the package, so that the entries are aligned. */
+static void load_atlas_map(struct package* package) {
+	const u8* data;
+	u64 size;
+	if (!package_find(package, atlas_map_path, &data, &size)) {
+		return;
+	}
+
+	u32 entry_count;
+	if (size < sizeof(u32) * 2) { goto corrupt; }
+
+	memcpy(&entry_count, data, sizeof(u32));
+	if (size < sizeof(u32) * 2 + (u64)entry_count * sizeof(struct atlas_entry)) { goto corrupt; }
+
+	atlas_entries = core_alloc(entry_count * sizeof(struct atlas_entry));
+	memcpy(atlas_entries, data + sizeof(u32) * 2, entry_count * sizeof(struct atlas_entry));
+	atlas_entry_count = entry_count;
+
+	return;
+
+corrupt:
+	fprintf(stderr, "`%s' is corrupt; Sprite sheets won't load.\n", atlas_map_path);
+}
+
+bool read_raw_view(const char* path, const u8** buf, u64* size) {
+	if (!res_package || !package_find(res_package, path, buf, size)) {
+		fprintf(stderr, "Failed to read file from package: %s\n", path);
+		return false;
+	}
+
+	return true;
+}
+
+void free_raw_view(const u8* buf) {
+	/* Points into the package. */
+}
+
+/* Files in the package are read straight out of the mapping. */
+struct file file_open(const char* path) {
+	const u8* data;
+	u64 size;
+
+	if (!res_package || !package_find(res_package, path, &data, &size)) {
+		return (struct file) { 0 };
+	}
+
+	return (struct file) { data, 0, size };
 }
 
 void file_close(struct file* file) {
-	fclose(file->handle);
-	file->handle = null;
+	file->data = null;
+}
+#endif
+
+bool file_good(struct file* file) {
+	return file->data != null;
 }
 
 u64 file_seek(struct file* file, u64 offset) {
@@ -173,17 +295,42 @@ u64 file_seek(struct file* file, u64 offset) {
 }
 
 u64 file_read(void* buf, u64 size, u64 count, struct file* file) {
-	fseek(file->handle, file->pk_offset + file->cursor, SEEK_SET);
+	if (size == 0 || file->cursor >= file->size) {
+		return 0;
+	}
+
+	const u64 available = (file->size - file->cursor) / size;
+	if (count > available) {
+		count = available;
+	}
+
+	memcpy(buf, file->data + file->cursor, size * count);
 
 	file->cursor += size * count;
 
-	return fread(buf, size, count, file->handle);
+	return count;
+}
+
+u64 file_read_array_i16(i16* buf, u64 count, struct file* file) {
+	return file_read(buf, sizeof(i16), count, file);
+}
+
+u64 file_read_array_i32(i32* buf, u64 count, struct file* file) {
+	return file_read(buf, sizeof(i32), count, file);
+}
+
+u64 file_read_array_u32(u32* buf, u64 count, struct file* file) {
+	return file_read(buf, sizeof(u32), count, file);
+}
+
+u64 file_read_array_f32(f32* buf, u64 count, struct file* file) {
+	return file_read(buf, sizeof(f32), count, file);
 }
-#endif
 
 enum {
 	res_shader,
 	res_texture,
+	res_atlas_texture,
 	res_font,
 	res_audio_clip
 };
@@ -214,7 +361,7 @@ static struct res _res_load(const char* path, u32 type, void* udata, u8* raw, u3
 		case res_texture:
 			new_res.as.texture = core_calloc(1, sizeof(struct texture));
 			init_texture(new_res.as.texture, raw, raw_size, *(u32*)udata);
-			core_free(raw);
+			free_raw_view(raw);
 			break;
 		case res_font:
 			new_res.as.font = load_font_from_memory(raw, raw_size, *(f32*)udata);
@@ -228,6 +375,48 @@ static struct res _res_load(const char* path, u32 type, void* udata, u8* raw, u3
 	return new_res;
 }
 
+/* The page is loaded as a texture of its own, and the sheet stands in for
+ * its rectangle of it. Sheets on the same page can be loaded with different
+ * flags, so pages are cached under their flags as well as their path. */
+static struct res load_atlas_texture(const struct atlas_entry* entry, u32 flags) {
+	char page_path[64];
+	sprintf(page_path, atlas_page_path, entry->page);
+
+	char cache_name[80];
+	sprintf(cache_name, "%s:%x", page_path, flags);
+
+	struct res* got = table_get(res_table, cache_name);
+	if (!got) {
+		u8* raw;
+		u64 raw_size;
+		read_raw_view(page_path, (const u8**)&raw, &raw_size);
+
+		struct res page_res = _res_load(page_path, res_texture, &flags, raw, raw_size);
+
+		table_set(res_table, cache_name, &page_res);
+
+		got = table_get(res_table, cache_name);
+	}
+
+	struct texture* page = got->as.texture;
+
+	struct res res = { 0 };
+
+	res.type = res_atlas_texture;
+	res.as.texture = core_calloc(1, sizeof(struct texture));
+
+	*res.as.texture = (struct texture) {
+		.id = page->id,
+		.width = entry->w,
+		.height = entry->h,
+		.page = page,
+		.page_x = entry->x,
+		.page_y = entry->y
+	};
+
+	return res;
+}
+
 static struct res* res_load(const char* path, u32 type, void* udata) {
 	char cache_name[256];
 
@@ -242,9 +431,26 @@ static struct res* res_load(const char* path, u32 type, void* udata) {
 		return got;
 	}
 
+	if (type == res_texture) {
+		const struct atlas_entry* entry = find_atlas_entry(path);
+		if (entry) {
+			struct res res = load_atlas_texture(entry, *(u32*)udata);
+
+			table_set(res_table, cache_name, &res);
+
+			return table_get(res_table, cache_name);
+		}
+	}
+
+	/* Textures are done with their data as soon as they are made, so
+	 * they can read it straight out of the package. */
 	u8* raw;
 	u64 raw_size;
-	read_raw(path, &raw, &raw_size, type == res_shader);
+	if (type == res_texture) {
+		read_raw_view(path, (const u8**)&raw, &raw_size);
+	} else {
+		read_raw(path, &raw, &raw_size, type == res_shader);
+	}
 
 	struct res res = _res_load(path, type, udata, raw, raw_size);
 
@@ -288,6 +494,9 @@ static void res_free(struct res* res) {
 			deinit_texture(res->as.texture);
 			core_free(res->as.texture);
 			break;
+		case res_atlas_texture:
+			core_free(res->as.texture);
+			break;
 		case res_font:
 			free_font(res->as.font);
 			break;
@@ -300,6 +509,13 @@ static void res_free(struct res* res) {
 
 void res_init() {
 	res_table = new_table(sizeof(struct res));
+
+#if !DEBUG
+	res_package = open_package(package_path);
+	if (res_package) {
+		load_atlas_map(res_package);
+	}
+#endif
 }
 
 void res_deinit() {
@@ -308,6 +524,19 @@ void res_deinit() {
 	}
 
 	free_table(res_table);
+
+#if !DEBUG
+	if (res_package) {
+		close_package(res_package);
+		res_package = null;
+	}
+
+	if (atlas_entries) {
+		core_free(atlas_entries);
+		atlas_entries = null;
+		atlas_entry_count = 0;
+	}
+#endif
 }
 
 void res_unload(const char* path) {
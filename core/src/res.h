@@ -11,6 +11,45 @@
 API bool read_raw(const char* path, u8** buf, u64* size, bool term);
 API bool read_raw_no_pck(const char* path, u8** buf, u64* size, bool term);
 
+/* Like `read_raw', but in release the buffer points straight into the
+ * package, rather than being a copy; It must not be written to, and must be
+ * given back with `free_raw_view' once it's no longer needed. */
+API bool read_raw_view(const char* path, const u8** buf, u64* size);
+API void free_raw_view(const u8* buf);
+
+/* A resource package, as made by the packer, mapped into memory.
+ *
+ * The header is searched with a binary search, so packages made by the
+ * packer have their entries sorted by hash. Older, unsorted packages still
+ * open, but a sorted copy of the header is made. */
+struct package;
+
+API struct package* open_package(const char* path);
+API void close_package(struct package* package);
+
+/* `data' points into the mapping, and is valid until the package is closed. */
+API bool package_find(struct package* package, const char* path, const u8** data, u64* size);
+
+/* The packer packs sprite sheets into atlas pages, stored in the package as
+ * `atlas_page_path', and leaves the sheets themselves out. The remap table
+ * starts with the number of entries and pages, as two u32s, followed by an
+ * entry for each sheet, sorted by the hash of the sheet's path.
+ *
+ * `load_texture' checks the table first, and gives back a texture that
+ * stands in for the sheet's rectangle of its page; See `struct texture'.
+ * A page is loaded once for each set of flags that sheets on it are loaded
+ * with. */
+#define atlas_map_path "res/atlas.map"
+#define atlas_page_path "res/atlas/%u.bmp"
+
+struct atlas_entry {
+	u64 hash;
+	u32 page;
+	u32 x, y;
+	u32 w, h;
+	u32 unused;
+};
+
 API void res_init();
 API void res_deinit();
 
@@ -28,12 +67,12 @@ API struct audio_clip* load_audio_clip_no_pck(const char* path);
 
 /* File API, for reading only.
  *
- * In debug, it wraps the default C stdio.
- * In release, it contains extra functionality to read from the
- * packed resource file. */
+ * Files are read from memory: In debug, the file is mapped when it's
+ * opened; In release, `data' points straight into the package. Reading a
+ * field is then just a copy, so there's no need to read things in big
+ * chunks for speed, but the array readers save a call per element. */
 struct file {
-	void* handle;
-	u64 pk_offset;
+	const u8* data;
 	u64 cursor;
 	u64 size;
 };
@@ -43,3 +82,10 @@ API bool file_good(struct file* file);
 API void file_close(struct file* file);
 API u64 file_seek(struct file* file, u64 offset);
 API u64 file_read(void* buf, u64 size, u64 count, struct file* file);
+
+/* Return the number of elements read, which is less than `count' if the
+ * end of the file was reached. */
+API u64 file_read_array_i16(i16* buf, u64 count, struct file* file);
+API u64 file_read_array_i32(i32* buf, u64 count, struct file* file);
+API u64 file_read_array_u32(u32* buf, u64 count, struct file* file);
+API u64 file_read_array_f32(f32* buf, u64 count, struct file* file);
@@ -0,0 +1,403 @@
+#include <string.h>
+
+#include "core.h"
+#include "platform.h"
+#include "rewind.h"
+
+/* A frame stored as a difference. In the ring it is laid out as this
+ * header, then the frame's sections, then each block that differs from the
+ * newer frame: A `rewind_block', followed by the block XORed with the same
+ * block of the newer frame, padded to eight bytes. */
+struct rewind_record {
+	u64 snapshot_size;
+	u32 section_count;
+	u32 block_count;
+};
+
+struct rewind_block {
+	u32 section;
+	u32 block;
+};
+
+/* Where a record is in the ring. */
+struct rewind_frame {
+	u64 offset;
+	u64 size;
+};
+
+struct rewind {
+	struct world* world;
+
+	u8* ring;
+	u64 budget;
+	u64 used;
+
+	/* Oldest first. A ring of its own, starting at `frame_first'. */
+	struct rewind_frame* frames;
+	u32 frame_first;
+	u32 frame_count;
+	u32 frame_capacity;
+
+	/* The newest frame, whole. */
+	u8* newest;
+	u64 newest_size;
+
+	/* The frame that was last sought to, unless it was the newest. */
+	u8* seek;
+	u64 seek_size;
+	u32 seek_back;
+
+	/* Records are built here before being copied into the ring, since
+	 * their size isn't known until they're done. */
+	u8* record;
+	u64 record_capacity;
+
+	struct snapshot_section* sections[2];
+	u32 section_capacity[2];
+
+	u32 interval;
+	u32 counter;
+
+	u64 last_delta_size;
+	f64 capture_time;
+};
+
+struct rewind* new_rewind(struct world* world, u64 budget, u32 interval) {
+	struct rewind* rewind = core_calloc(1, sizeof(struct rewind));
+
+	rewind->world = world;
+	rewind->budget = budget;
+	rewind->ring = core_alloc(budget);
+	rewind->interval = interval > 0 ? interval : 1;
+
+	return rewind;
+}
+
+void free_rewind(struct rewind* rewind) {
+	rewind_clear(rewind);
+
+	core_free(rewind->ring);
+
+	if (rewind->frames)      { core_free(rewind->frames); }
+	if (rewind->record)      { core_free(rewind->record); }
+	if (rewind->sections[0]) { core_free(rewind->sections[0]); }
+	if (rewind->sections[1]) { core_free(rewind->sections[1]); }
+
+	core_free(rewind);
+}
+
+void set_rewind_interval(struct rewind* rewind, u32 interval) {
+	rewind->interval = interval > 0 ? interval : 1;
+}
+
+static struct rewind_frame* rewind_frame(struct rewind* rewind, u32 i) {
+	return rewind->frames + (rewind->frame_first + i) % rewind->frame_capacity;
+}
+
+static void rewind_push_frame(struct rewind* rewind, u64 offset, u64 size) {
+	if (rewind->frame_count >= rewind->frame_capacity) {
+		const u32 old_capacity = rewind->frame_capacity;
+
+		rewind->frame_capacity = rewind->frame_capacity < 8 ? 8 : rewind->frame_capacity * 2;
+		rewind->frames = core_realloc(rewind->frames, rewind->frame_capacity * sizeof(struct rewind_frame));
+
+		/* The ring was full, so the frames before `frame_first' are the
+		 * newest ones; Move them after the rest. */
+		memcpy(rewind->frames + old_capacity, rewind->frames, rewind->frame_first * sizeof(struct rewind_frame));
+	}
+
+	*rewind_frame(rewind, rewind->frame_count++) = (struct rewind_frame) { offset, size };
+	rewind->used += size;
+}
+
+static void rewind_pop_oldest(struct rewind* rewind) {
+	rewind->used -= rewind_frame(rewind, 0)->size;
+	rewind->frame_first = (rewind->frame_first + 1) % rewind->frame_capacity;
+	rewind->frame_count--;
+}
+
+static void rewind_pop_newest(struct rewind* rewind) {
+	rewind->used -= rewind_frame(rewind, rewind->frame_count - 1)->size;
+	rewind->frame_count--;
+}
+
+/* Finds room for a record after the newest one, dropping the oldest
+ * frames until it fits. Records never wrap; If one doesn't fit before the
+ * end of the ring, it goes at the start. */
+static bool rewind_alloc(struct rewind* rewind, u64 size, u64* offset) {
+	if (size > rewind->budget) {
+		while (rewind->frame_count > 0) { rewind_pop_oldest(rewind); }
+		return false;
+	}
+
+	u64 at = 0;
+	if (rewind->frame_count > 0) {
+		struct rewind_frame* newest = rewind_frame(rewind, rewind->frame_count - 1);
+		at = newest->offset + newest->size;
+	}
+
+	if (at + size > rewind->budget) {
+		while (rewind->frame_count > 0 && rewind_frame(rewind, 0)->offset >= at) {
+			rewind_pop_oldest(rewind);
+		}
+
+		at = 0;
+	}
+
+	while (rewind->frame_count > 0) {
+		struct rewind_frame* oldest = rewind_frame(rewind, 0);
+		if (oldest->offset >= at + size || oldest->offset + oldest->size <= at) { break; }
+
+		rewind_pop_oldest(rewind);
+	}
+
+	*offset = at;
+	return true;
+}
+
+static u32 rewind_sections(struct rewind* rewind, u32 slot, const u8* snapshot, u64 size) {
+	const u32 count = world_snapshot_sections(snapshot, size, null, 0);
+
+	if (count > rewind->section_capacity[slot]) {
+		rewind->section_capacity[slot] = count;
+		rewind->sections[slot] = core_realloc(rewind->sections[slot], count * sizeof(struct snapshot_section));
+	}
+
+	world_snapshot_sections(snapshot, size, rewind->sections[slot], count);
+
+	return count;
+}
+
+static void* rewind_record_reserve(struct rewind* rewind, u64 at, u64 size) {
+	if (at + size > rewind->record_capacity) {
+		u64 capacity = rewind->record_capacity < 4096 ? 4096 : rewind->record_capacity;
+		while (capacity < at + size) { capacity *= 2; }
+
+		rewind->record = core_realloc(rewind->record, capacity);
+		rewind->record_capacity = capacity;
+	}
+
+	return rewind->record + at;
+}
+
+static u64 rewind_align(u64 size) {
+	return (size + 7) & ~(u64)7;
+}
+
+/* Stores `older' as its difference from `newer'. Sections are matched by
+ * key, and a section or part of one that `newer' doesn't have is compared
+ * against zeroes. */
+static void rewind_store(struct rewind* rewind, const u8* older, u64 older_size, const u8* newer, u64 newer_size) {
+	const u32 older_count = rewind_sections(rewind, 0, older, older_size);
+	const u32 newer_count = rewind_sections(rewind, 1, newer, newer_size);
+
+	struct snapshot_section* a = rewind->sections[0];
+	struct snapshot_section* b = rewind->sections[1];
+
+	u64 size = sizeof(struct rewind_record) + older_count * sizeof(struct snapshot_section);
+	memcpy(rewind_record_reserve(rewind, sizeof(struct rewind_record), older_count * sizeof(struct snapshot_section)),
+		a, older_count * sizeof(struct snapshot_section));
+
+	u32 block_count = 0;
+
+	for (u32 i = 0, j = 0; i < older_count; i++) {
+		while (j < newer_count && b[j].key < a[i].key) { j++; }
+
+		const u8* src = older + a[i].offset;
+		const u8* other = j < newer_count && b[j].key == a[i].key ? newer + b[j].offset : null;
+		const u64 other_size = other ? b[j].size : 0;
+
+		for (u64 begin = 0, block = 0; begin < a[i].size; begin += rewind_block_size, block++) {
+			const u64 len = minimum(rewind_block_size, a[i].size - begin);
+
+			if (begin + len <= other_size && memcmp(src + begin, other + begin, len) == 0) {
+				continue;
+			}
+
+			struct rewind_block* header = rewind_record_reserve(rewind, size, sizeof(struct rewind_block) + rewind_align(len));
+			*header = (struct rewind_block) { i, (u32)block };
+
+			u8* dst = (u8*)(header + 1);
+			for (u64 k = 0; k < len; k++) {
+				dst[k] = src[begin + k] ^ (begin + k < other_size ? other[begin + k] : 0);
+			}
+
+			size += sizeof(struct rewind_block) + rewind_align(len);
+			block_count++;
+		}
+	}
+
+	*(struct rewind_record*)rewind->record = (struct rewind_record) {
+		.snapshot_size = older_size,
+		.section_count = older_count,
+		.block_count = block_count
+	};
+
+	u64 offset;
+	if (rewind_alloc(rewind, size, &offset)) {
+		memcpy(rewind->ring + offset, rewind->record, size);
+		rewind_push_frame(rewind, offset, size);
+	}
+
+	rewind->last_delta_size = size;
+}
+
+/* The inverse of `rewind_store': Rebuilds the older frame from the newer one
+ * and the record. */
+static u8* rewind_apply(struct rewind* rewind, const u8* record, const u8* newer, u64 newer_size, u64* size) {
+	struct rewind_record header;
+	memcpy(&header, record, sizeof(header));
+
+	const struct snapshot_section* a = (const struct snapshot_section*)(record + sizeof(header));
+
+	const u32 newer_count = rewind_sections(rewind, 1, newer, newer_size);
+	struct snapshot_section* b = rewind->sections[1];
+
+	u8* older = core_alloc(header.snapshot_size);
+
+	for (u32 i = 0, j = 0; i < header.section_count; i++) {
+		while (j < newer_count && b[j].key < a[i].key) { j++; }
+
+		u64 same = 0;
+		if (j < newer_count && b[j].key == a[i].key) {
+			same = minimum(a[i].size, b[j].size);
+			memcpy(older + a[i].offset, newer + b[j].offset, same);
+		}
+
+		memset(older + a[i].offset + same, 0, a[i].size - same);
+	}
+
+	const u8* cur = record + sizeof(header) + header.section_count * sizeof(struct snapshot_section);
+
+	for (u32 i = 0; i < header.block_count; i++) {
+		struct rewind_block block;
+		memcpy(&block, cur, sizeof(block));
+		cur += sizeof(block);
+
+		const u64 begin = (u64)block.block * rewind_block_size;
+		const u64 len = minimum(rewind_block_size, a[block.section].size - begin);
+
+		u8* dst = older + a[block.section].offset + begin;
+		for (u64 k = 0; k < len; k++) {
+			dst[k] ^= cur[k];
+		}
+
+		cur += rewind_align(len);
+	}
+
+	*size = header.snapshot_size;
+	return older;
+}
+
+static void rewind_drop_seek(struct rewind* rewind) {
+	if (rewind->seek) {
+		core_free(rewind->seek);
+	}
+
+	rewind->seek = null;
+	rewind->seek_back = 0;
+}
+
+void rewind_capture(struct rewind* rewind) {
+	if (rewind->counter++ % rewind->interval != 0) { return; }
+
+	const u64 start = get_time();
+
+	u64 size;
+	u8* snapshot = world_snapshot_write(rewind->world, &size);
+
+	/* Carry on from the frame that was sought to. */
+	if (rewind->seek) {
+		for (u32 i = 0; i < rewind->seek_back; i++) {
+			rewind_pop_newest(rewind);
+		}
+
+		core_free(rewind->newest);
+		rewind->newest = rewind->seek;
+		rewind->newest_size = rewind->seek_size;
+		rewind->seek = null;
+		rewind->seek_back = 0;
+	}
+
+	if (rewind->newest) {
+		rewind_store(rewind, rewind->newest, rewind->newest_size, snapshot, size);
+		core_free(rewind->newest);
+	}
+
+	rewind->newest = snapshot;
+	rewind->newest_size = size;
+
+	rewind->capture_time = (f64)(get_time() - start) / (f64)get_frequency();
+}
+
+bool rewind_seek(struct rewind* rewind, u32 back) {
+	if (!rewind->newest || back > rewind->frame_count) { return false; }
+
+	if (back == 0) {
+		rewind_drop_seek(rewind);
+		return world_snapshot_read(rewind->world, rewind->newest, rewind->newest_size);
+	}
+
+	/* Start from the last frame that was sought to if it's newer than the
+	 * one wanted, so that scrubbing backwards doesn't start over each time. */
+	const u8* cur = rewind->newest;
+	u64 cur_size = rewind->newest_size;
+	u32 at = 0;
+
+	if (rewind->seek && rewind->seek_back <= back) {
+		cur = rewind->seek;
+		cur_size = rewind->seek_size;
+		at = rewind->seek_back;
+	}
+
+	u8* owned = null;
+
+	for (; at < back; at++) {
+		const u8* record = rewind->ring + rewind_frame(rewind, rewind->frame_count - 1 - at)->offset;
+
+		u64 older_size;
+		u8* older = rewind_apply(rewind, record, cur, cur_size, &older_size);
+
+		if (owned && owned != rewind->seek) { core_free(owned); }
+
+		owned = older;
+		cur = older;
+		cur_size = older_size;
+	}
+
+	if (owned) {
+		rewind_drop_seek(rewind);
+		rewind->seek = owned;
+		rewind->seek_size = cur_size;
+	}
+
+	rewind->seek_back = back;
+
+	return world_snapshot_read(rewind->world, rewind->seek, rewind->seek_size);
+}
+
+void rewind_clear(struct rewind* rewind) {
+	rewind_drop_seek(rewind);
+
+	if (rewind->newest) {
+		core_free(rewind->newest);
+	}
+
+	rewind->newest = null;
+	rewind->newest_size = 0;
+
+	rewind->frame_first = 0;
+	rewind->frame_count = 0;
+	rewind->used = 0;
+}
+
+struct rewind_stats get_rewind_stats(struct rewind* rewind) {
+	return (struct rewind_stats) {
+		.budget = rewind->budget,
+		.used = rewind->used,
+		.newest_size = rewind->newest_size,
+		.last_delta_size = rewind->last_delta_size,
+		.frame_count = rewind->frame_count + (rewind->newest ? 1 : 0),
+		.capture_time = rewind->capture_time
+	};
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "common.h"
+#include "entity.h"
+
+/* Keeps the last few seconds of a world's history, to step back through.
+ *
+ * `rewind_capture' is called once a frame, and takes a snapshot of the world
+ * (see `world_snapshot_write') every `interval' calls. Only the newest
+ * snapshot is kept whole. Each older frame is stored as the difference from
+ * the frame after it: For every block of `rewind_block_size' bytes of each
+ * part of the snapshot that changed, the block XORed with the same block of
+ * the newer frame. Pages of pools that didn't change cost nothing.
+ *
+ * The differences are kept in a ring buffer of a fixed size, the budget.
+ * When it fills up, the oldest frames are dropped to make room. Since each
+ * frame only depends on the ones after it, dropping the oldest never makes
+ * any other frame unreadable.
+ *
+ * `rewind_seek' puts the world back to how it was a number of captured
+ * frames ago. The history isn't changed by seeking, so it's fine to scrub
+ * back and forth while the game is paused; The frames after the one that was
+ * sought to are only thrown away once the next frame is captured, so that the
+ * history carries on from there. */
+
+#define rewind_block_size 4096
+
+struct rewind;
+
+struct rewind_stats {
+	u64 budget;
+	u64 used;
+
+	/* The size of the newest frame, which is kept whole, outside of the
+	 * budget. */
+	u64 newest_size;
+
+	/* Of the last frame that was stored as a difference. */
+	u64 last_delta_size;
+
+	u32 frame_count;
+
+	/* Seconds, for the last capture. */
+	f64 capture_time;
+};
+
+API struct rewind* new_rewind(struct world* world, u64 budget, u32 interval);
+API void free_rewind(struct rewind* rewind);
+
+API void set_rewind_interval(struct rewind* rewind, u32 interval);
+
+API void rewind_capture(struct rewind* rewind);
+
+/* `back' is how many captured frames to go back; Zero is the newest.
+ * Returns false if that frame isn't kept. */
+API bool rewind_seek(struct rewind* rewind, u32 back);
+
+/* Forgets every frame. */
+API void rewind_clear(struct rewind* rewind);
+
+API struct rewind_stats get_rewind_stats(struct rewind* rewind);
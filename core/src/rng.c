@@ -0,0 +1,173 @@
+#include "core.h"
+#include "rng.h"
+
+/* Core is always loaded along with the program, never opened on its own
+ * later, so its thread locals can use the quicker static TLS model. */
+#if defined(_MSC_VER)
+	#define thread_local_var __declspec(thread)
+#else
+	#define thread_local_var __thread __attribute__((tls_model("initial-exec")))
+#endif
+
+static u64 splitmix64(u64* x) {
+	u64 z = (*x += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static inline u64 rotl(u64 x, i32 k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+void rng_seed(struct rng* rng, u64 seed) {
+	/* SplitMix64 spreads the seed over the state, so that similar seeds
+	 * don't give similar sequences, and the state is never all zero. */
+	for (u32 i = 0; i < 4; i++) {
+		rng->s[i] = splitmix64(&seed);
+	}
+}
+
+u64 rng_u64(struct rng* rng) {
+	u64* s = rng->s;
+
+	const u64 r = rotl(s[1] * 5, 7) * 9;
+	const u64 t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+
+	return r;
+}
+
+u32 rng_u32(struct rng* rng) {
+	return (u32)(rng_u64(rng) >> 32);
+}
+
+i32 rng_int(struct rng* rng, i32 min, i32 max) {
+	const u32 range = (u32)max - (u32)min + 1;
+
+	/* The whole range of an i32. */
+	if (range == 0) {
+		return (i32)rng_u32(rng);
+	}
+
+	/* Lemire's method; Multiplying instead of taking the remainder, and
+	 * throwing away the few results that would make some numbers more
+	 * likely than others. */
+	u64 m = (u64)rng_u32(rng) * range;
+	u32 l = (u32)m;
+	if (l < range) {
+		const u32 t = -range % range;
+		while (l < t) {
+			m = (u64)rng_u32(rng) * range;
+			l = (u32)m;
+		}
+	}
+
+	return (i32)((u32)min + (u32)(m >> 32));
+}
+
+f64 rng_f64(struct rng* rng, f64 min, f64 max) {
+	const f64 unit = (f64)(rng_u64(rng) >> 11) * (1.0 / 9007199254740992.0);
+	return min + unit * (max - min);
+}
+
+f32 rng_f32(struct rng* rng, f32 min, f32 max) {
+	const f32 unit = (f32)(rng_u64(rng) >> 40) * (1.0f / 16777216.0f);
+	return min + unit * (max - min);
+}
+
+bool rng_chance(struct rng* rng, f64 chance) {
+	return rng_f64(rng, 0.0, 100.0) < chance;
+}
+
+void rng_fill_f32(struct rng* rng, f32* out, u32 count, f32 min, f32 max) {
+	const u32 key = rng_u32(rng);
+	const f32 scale = (max - min) * (1.0f / 16777216.0f);
+
+	for (u32 i = 0; i < count; i++) {
+		/* A 32-bit integer hash, of the index mixed with the key. */
+		u32 x = key + i * 0x9e3779b9u;
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+
+		out[i] = min + (f32)(x >> 8) * scale;
+	}
+}
+
+void rng_jump(struct rng* rng) {
+	static const u64 jump[] = {
+		0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+		0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+	};
+
+	u64 s[4] = { 0 };
+
+	for (u32 i = 0; i < 4; i++) {
+		for (u32 b = 0; b < 64; b++) {
+			if (jump[i] & (1ULL << b)) {
+				s[0] ^= rng->s[0];
+				s[1] ^= rng->s[1];
+				s[2] ^= rng->s[2];
+				s[3] ^= rng->s[3];
+			}
+
+			rng_u64(rng);
+		}
+	}
+
+	rng->s[0] = s[0];
+	rng->s[1] = s[1];
+	rng->s[2] = s[2];
+	rng->s[3] = s[3];
+}
+
+void rng_seed_stream(struct rng* rng, u64 seed, u32 stream) {
+	rng_seed(rng, seed);
+
+	for (u32 i = 0; i < stream; i++) {
+		rng_jump(rng);
+	}
+}
+
+/* Bumped by `seed_random', so that each thread notices and seeds its own
+ * generator again. */
+static u64 base_seed = 0x853c49e6748fea9bULL;
+static u32 seed_generation = 1;
+
+static thread_local_var struct {
+	struct rng rng;
+	u32 generation;
+	u32 stream;
+} thread_state;
+
+struct rng* thread_rng() {
+	if (thread_state.generation != seed_generation) {
+		rng_seed_stream(&thread_state.rng, base_seed, thread_state.stream);
+		thread_state.generation = seed_generation;
+	}
+
+	return &thread_state.rng;
+}
+
+void set_thread_rng_stream(u32 stream) {
+	thread_state.stream = stream;
+	thread_state.generation = 0;
+}
+
+void seed_random(u64 seed) {
+	base_seed = seed;
+	seed_generation++;
+
+	rng_seed_stream(&thread_state.rng, seed, thread_state.stream);
+	thread_state.generation = seed_generation;
+}
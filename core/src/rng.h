@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common.h"
+
+/* Random number generation.
+ *
+ * Each generator is a `struct rng', xoshiro256**, which is small, quick and
+ * good enough for anything but cryptography. Generators are independent of
+ * each other, so a system that wants its own sequence, one that isn't
+ * changed by whatever else happens to draw random numbers, can keep its own.
+ * The same seed always gives the same sequence, on every platform.
+ *
+ * `thread_rng' is a generator for the calling thread, which `random_int',
+ * `random_f64' and `random_chance' in core.h draw from. Each thread draws
+ * from its own stream of the sequence that the seed given to `seed_random'
+ * gives: The main thread is stream zero, which is that sequence itself, and
+ * job thread `i' is stream `i + 1'. Which thread a job ends up on is still up
+ * to the scheduler, so a job that needs the same numbers on every run should
+ * seed its own generator from its index, with `rng_seed_stream'.
+ *
+ * Ranges are from `min' inclusive to `max' exclusive for reals, and to `max'
+ * inclusive for integers. Integers are drawn without modulo bias. */
+
+struct rng {
+	u64 s[4];
+};
+
+API void rng_seed(struct rng* rng, u64 seed);
+
+API u64 rng_u64(struct rng* rng);
+API u32 rng_u32(struct rng* rng);
+API i32 rng_int(struct rng* rng, i32 min, i32 max);
+API f64 rng_f64(struct rng* rng, f64 min, f64 max);
+API f32 rng_f32(struct rng* rng, f32 min, f32 max);
+
+/* True `chance' percent of the time. */
+API bool rng_chance(struct rng* rng, f64 chance);
+
+/* Fills `out' with `count' numbers from `min' to `max'. Faster than
+ * drawing them one by one: The generator is only stepped once, and the
+ * numbers are made by hashing their index with what it gave, which has no
+ * dependency from one number to the next, and so vectorises. */
+API void rng_fill_f32(struct rng* rng, f32* out, u32 count, f32 min, f32 max);
+
+/* Skips 2^128 numbers ahead, which gives 2^128 sequences that never
+ * overlap, one after the other. `rng_seed_stream' seeds with `seed' and then
+ * jumps `stream' times. */
+API void rng_jump(struct rng* rng);
+API void rng_seed_stream(struct rng* rng, u64 seed, u32 stream);
+
+API struct rng* thread_rng();
+
+/* Set by the job system for its threads; Any other thread that draws from
+ * `thread_rng' should pick a stream of its own. */
+API void set_thread_rng_stream(u32 stream);
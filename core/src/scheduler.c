@@ -0,0 +1,268 @@
+#include <string.h>
+
+#include "core.h"
+#include "jobs.h"
+#include "platform.h"
+#include "scheduler.h"
+
+struct system {
+	char* name;
+	system_func func;
+	void* udata;
+	u32 flags;
+
+	u64 reads[signature_words];
+	u64 writes[signature_words];
+
+	u32 wave;
+
+	/* Timings from the last run; Written by whichever thread ran it. */
+	u64 start;
+	u64 end;
+
+	/* The dependency that finished last in the last run, or the system's
+	 * own index if it has none. Used to walk back along the critical path. */
+	u32 critical_dep;
+	bool critical;
+};
+
+struct scheduler {
+	struct world* world;
+
+	struct system* systems;
+	u32 system_count;
+	u32 system_capacity;
+
+	/* System indices sorted by wave, then by the order they were added.
+	 * Rebuilt whenever a system is added or changed. */
+	u32* order;
+	u32 wave_count;
+	bool dirty;
+
+	u64 run_start;
+	u64 run_end;
+	f64 critical_path_time;
+};
+
+struct scheduler* new_scheduler(struct world* world) {
+	struct scheduler* scheduler = core_calloc(1, sizeof(struct scheduler));
+
+	scheduler->world = world;
+
+	return scheduler;
+}
+
+void free_scheduler(struct scheduler* scheduler) {
+	for (u32 i = 0; i < scheduler->system_count; i++) {
+		core_free(scheduler->systems[i].name);
+	}
+
+	if (scheduler->systems) { core_free(scheduler->systems); }
+	if (scheduler->order)   { core_free(scheduler->order); }
+
+	core_free(scheduler);
+}
+
+u32 scheduler_add(struct scheduler* scheduler, const char* name, system_func func, void* udata, u32 flags) {
+	if (scheduler->system_count >= scheduler->system_capacity) {
+		scheduler->system_capacity = scheduler->system_capacity < 8 ? 8 : scheduler->system_capacity * 2;
+		scheduler->systems = core_realloc(scheduler->systems, scheduler->system_capacity * sizeof(struct system));
+	}
+
+	const u32 idx = scheduler->system_count++;
+
+	scheduler->systems[idx] = (struct system) {
+		.name = copy_string(name),
+		.func = func,
+		.udata = udata,
+		.flags = flags,
+		.critical_dep = idx
+	};
+
+	scheduler->dirty = true;
+
+	return idx;
+}
+
+void _system_access(struct scheduler* scheduler, u32 system, bool write, u32 type_count, struct type_info* types) {
+	struct system* s = scheduler->systems + system;
+
+	u64* mask = write ? s->writes : s->reads;
+
+	for (u32 i = 0; i < type_count; i++) {
+		mask[types[i].id >> 6] |= (u64)1 << (types[i].id & 63);
+	}
+
+	scheduler->dirty = true;
+}
+
+static bool masks_overlap(const u64* a, const u64* b) {
+	for (u32 i = 0; i < signature_words; i++) {
+		if (a[i] & b[i]) { return true; }
+	}
+
+	return false;
+}
+
+static bool systems_conflict(struct system* a, struct system* b) {
+	return (a->flags & system_exclusive) || (b->flags & system_exclusive) ||
+		masks_overlap(a->writes, b->writes) ||
+		masks_overlap(a->writes, b->reads) ||
+		masks_overlap(a->reads, b->writes);
+}
+
+/* Each system goes in the wave after the last of its dependencies. Since
+ * dependencies only ever point to systems that were added earlier, one pass
+ * in the order they were added is enough. */
+static void scheduler_build(struct scheduler* scheduler) {
+	scheduler->order = core_realloc(scheduler->order, scheduler->system_count * sizeof(u32));
+	scheduler->wave_count = 0;
+
+	for (u32 i = 0; i < scheduler->system_count; i++) {
+		struct system* s = scheduler->systems + i;
+		s->wave = 0;
+
+		for (u32 ii = 0; ii < i; ii++) {
+			struct system* dep = scheduler->systems + ii;
+			if (dep->wave + 1 > s->wave && systems_conflict(s, dep)) {
+				s->wave = dep->wave + 1;
+			}
+		}
+
+		if (s->wave + 1 > scheduler->wave_count) {
+			scheduler->wave_count = s->wave + 1;
+		}
+	}
+
+	u32 count = 0;
+	for (u32 wave = 0; wave < scheduler->wave_count; wave++) {
+		for (u32 i = 0; i < scheduler->system_count; i++) {
+			if (scheduler->systems[i].wave == wave) {
+				scheduler->order[count++] = i;
+			}
+		}
+	}
+
+	scheduler->dirty = false;
+}
+
+static void run_system(struct scheduler* scheduler, struct system* s) {
+	s->start = get_time();
+	s->func(scheduler->world, s->udata);
+	s->end = get_time();
+}
+
+struct scheduler_wave {
+	struct scheduler* scheduler;
+	u32* systems;
+};
+
+static void scheduler_wave_job(u32 begin, u32 end, void* udata) {
+	struct scheduler_wave* wave = udata;
+
+	for (u32 i = begin; i < end; i++) {
+		run_system(wave->scheduler, wave->scheduler->systems + wave->systems[i]);
+	}
+}
+
+/* The longest chain of dependent systems, by how long each one took. */
+static void scheduler_find_critical_path(struct scheduler* scheduler) {
+	f64* finish = core_alloc(scheduler->system_count * sizeof(f64));
+
+	const f64 freq = (f64)get_frequency();
+
+	u32 last = 0;
+
+	for (u32 i = 0; i < scheduler->system_count; i++) {
+		struct system* s = scheduler->systems + i;
+
+		s->critical = false;
+		s->critical_dep = i;
+
+		f64 before = 0.0;
+		for (u32 ii = 0; ii < i; ii++) {
+			if (finish[ii] > before && systems_conflict(s, scheduler->systems + ii)) {
+				before = finish[ii];
+				s->critical_dep = ii;
+			}
+		}
+
+		finish[i] = before + (f64)(s->end - s->start) / freq;
+
+		if (finish[i] > finish[last]) {
+			last = i;
+		}
+	}
+
+	scheduler->critical_path_time = scheduler->system_count > 0 ? finish[last] : 0.0;
+
+	if (scheduler->system_count > 0) {
+		u32 i = last;
+		for (;;) {
+			scheduler->systems[i].critical = true;
+			if (scheduler->systems[i].critical_dep == i) { break; }
+			i = scheduler->systems[i].critical_dep;
+		}
+	}
+
+	core_free(finish);
+}
+
+void run_scheduler(struct scheduler* scheduler) {
+	if (scheduler->dirty) {
+		scheduler_build(scheduler);
+	}
+
+	scheduler->run_start = get_time();
+
+	for (u32 begin = 0; begin < scheduler->system_count;) {
+		const u32 wave = scheduler->systems[scheduler->order[begin]].wave;
+
+		u32 end = begin + 1;
+		while (end < scheduler->system_count && scheduler->systems[scheduler->order[end]].wave == wave) {
+			end++;
+		}
+
+		if (end - begin == 1) {
+			run_system(scheduler, scheduler->systems + scheduler->order[begin]);
+		} else {
+			struct scheduler_wave w = { scheduler, scheduler->order + begin };
+
+			lock_world(scheduler->world);
+			run_jobs(end - begin, 1, scheduler_wave_job, &w);
+			unlock_world(scheduler->world);
+		}
+
+		begin = end;
+	}
+
+	scheduler->run_end = get_time();
+
+	scheduler_find_critical_path(scheduler);
+}
+
+u32 get_scheduler_system_count(struct scheduler* scheduler) {
+	return scheduler->system_count;
+}
+
+struct system_timing get_system_timing(struct scheduler* scheduler, u32 system) {
+	struct system* s = scheduler->systems + system;
+
+	const f64 freq = (f64)get_frequency();
+
+	return (struct system_timing) {
+		.name = s->name,
+		.start = s->start >= scheduler->run_start ? (f64)(s->start - scheduler->run_start) / freq : 0.0,
+		.duration = (f64)(s->end - s->start) / freq,
+		.wave = s->wave,
+		.critical = s->critical
+	};
+}
+
+f64 get_scheduler_critical_path_time(struct scheduler* scheduler) {
+	return scheduler->critical_path_time;
+}
+
+f64 get_scheduler_run_time(struct scheduler* scheduler) {
+	return (f64)(scheduler->run_end - scheduler->run_start) / (f64)get_frequency();
+}
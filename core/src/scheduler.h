@@ -0,0 +1,70 @@
+#pragma once
+
+#include "common.h"
+#include "entity.h"
+
+/* Runs a world's systems, concurrently where it's safe to do so.
+ *
+ * Each system is added with the component types that it reads and writes.
+ * Two systems conflict if one of them writes a type that the other reads or
+ * writes; A system depends on every system added before it that it conflicts
+ * with. The first run sorts the systems into waves, so that every system in
+ * a wave has had its dependencies run in an earlier one and no two systems in
+ * a wave conflict. The systems in a wave are run concurrently on the job
+ * threads (see jobs.h). Conflicting systems always run in the order that they
+ * were added, so the outcome doesn't depend on the thread count.
+ *
+ * Systems that change the world structurally, or that touch anything outside
+ * of the ECS that isn't safe to share between threads (the renderer, for
+ * one), must be added with `system_exclusive'. An exclusive system conflicts
+ * with every other system, and so runs alone, on the calling thread.
+ *
+ * The world is locked while a wave of more than one system runs, in the same
+ * way that it is during `view_for_each_parallel'. So a system that isn't
+ * exclusive may make views and resolve types with `type_info', which are safe
+ * from any thread (see core.h), but it may not call anything that can add a
+ * pool, such as `get_component' on a type that the world has never seen;
+ * Structural changes are best recorded with `struct ecs_commands', one for
+ * each system, and applied by an exclusive system that comes after. */
+
+#define system_reads(s_, i_, ...) \
+	_system_access((s_), (i_), false, (sizeof((struct type_info[]){__VA_ARGS__})/sizeof(struct type_info)), \
+		(struct type_info[]) { __VA_ARGS__ })
+
+#define system_writes(s_, i_, ...) \
+	_system_access((s_), (i_), true, (sizeof((struct type_info[]){__VA_ARGS__})/sizeof(struct type_info)), \
+		(struct type_info[]) { __VA_ARGS__ })
+
+struct scheduler;
+
+typedef void (*system_func)(struct world* world, void* udata);
+
+enum {
+	system_exclusive = 1 << 0
+};
+
+API struct scheduler* new_scheduler(struct world* world);
+API void free_scheduler(struct scheduler* scheduler);
+
+/* Returns the index of the system, to pass to `system_reads' and
+ * `system_writes'. */
+API u32 scheduler_add(struct scheduler* scheduler, const char* name, system_func func, void* udata, u32 flags);
+API void _system_access(struct scheduler* scheduler, u32 system, bool write, u32 type_count, struct type_info* types);
+
+API void run_scheduler(struct scheduler* scheduler);
+
+/* Timings from the last run, in seconds. `start' is relative to the start
+ * of the run. The critical path is the chain of dependent systems that took
+ * the longest; Making anything else faster won't shorten the frame. */
+struct system_timing {
+	const char* name;
+	f64 start;
+	f64 duration;
+	u32 wave;
+	bool critical;
+};
+
+API u32 get_scheduler_system_count(struct scheduler* scheduler);
+API struct system_timing get_system_timing(struct scheduler* scheduler, u32 system);
+API f64 get_scheduler_critical_path_time(struct scheduler* scheduler);
+API f64 get_scheduler_run_time(struct scheduler* scheduler);
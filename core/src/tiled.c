@@ -25,12 +25,6 @@ static i32 read_i32(struct file* file) {
 	return i;
 }
 
-static i16 read_i16(struct file* file) {
-	i16 i;
-	file_read(&i, sizeof(i), 1, file);
-	return i;
-}
-
 static f32 read_f32(struct file* file) {	
 	f32 f;
 	file_read(&f, sizeof(f), 1, file);
@@ -156,14 +150,10 @@ struct tiled_map* load_map(const char* filename) {
 
 				layer->as.tile_layer.tiles = core_calloc(layer->as.tile_layer.w * layer->as.tile_layer.h, sizeof(struct tile));
 
-				for (u64 y = 0; y < layer->as.tile_layer.h; y++) {
-					for (u64 x = 0; x < layer->as.tile_layer.w; x++) {
-						layer->as.tile_layer.tiles[x + y * layer->as.tile_layer.w] = (struct tile) {
-							.id = read_i16(&file),
-							.tileset_id = read_i16(&file)
-						};
-					}
-				}
+				/* Tiles are stored as they are laid out in memory; An ID
+				 * followed by a tileset ID. */
+				file_read_array_i16((i16*)layer->as.tile_layer.tiles,
+					(u64)layer->as.tile_layer.w * layer->as.tile_layer.h * 2, &file);
 			} break;
 			case layer_objects: {
 				layer->as.object_layer.object_count = read_u32(&file);
@@ -188,10 +178,8 @@ struct tiled_map* load_map(const char* filename) {
 							object->as.polygon.count = read_u32(&file);
 							object->as.polygon.points = core_calloc(object->as.polygon.count, sizeof(v2f));
 
-							for (u32 iii = 0; iii < object->as.polygon.count; iii++) {
-								object->as.polygon.points[iii].x = read_f32(&file);
-								object->as.polygon.points[iii].y = read_f32(&file);
-							}
+							file_read_array_f32((f32*)object->as.polygon.points,
+								(u64)object->as.polygon.count * 2, &file);
 						} break;
 						case object_shape_rect:
 							object->as.rect.x = read_f32(&file);
@@ -209,6 +197,8 @@ struct tiled_map* load_map(const char* filename) {
 		};
 	}
 
+	file_close(&file);
+
 	return map;
 }
 
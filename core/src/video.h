@@ -16,6 +16,13 @@ API struct rect make_rect(i32 x, i32 y, i32 w, i32 h);
 API void video_init();
 API void video_clear();
 
+/* Instead of `video_init', for running without a window or an OpenGL
+ * context. Everything here then does nothing, besides keeping track of the
+ * sizes of textures and render targets; Fonts and sprites still load, and
+ * text is still measured. */
+API void video_init_headless();
+API bool video_is_headless();
+
 enum {
 	vt_clip = 0,
 	vt_depth_test
@@ -25,10 +32,23 @@ API void video_enable(u32 thing);
 API void video_disable(u32 thing);
 API void video_clip(struct rect rect);
 
+struct shader_uniform {
+	u64 hash;
+	char* name;
+	i32 location;
+};
+
 struct shader {
 	bool panic;
 
 	u32 id;
+
+	/* Every uniform's location, looked up once when the program is
+	 * linked, and sorted by the hash of its name. Elements of arrays get
+	 * an entry each, like "textures[3]". Names are compared on a match, as
+	 * different names can have the same hash. */
+	struct shader_uniform* uniforms;
+	u32 uniform_count;
 };
 
 API void init_shader(struct shader* shader, const char* source, const char* name);
@@ -43,6 +63,35 @@ API void shader_set_v3f(const struct shader* shader, const char* name, const v3f
 API void shader_set_v4f(const struct shader* shader, const char* name, const v4f v);
 API void shader_set_m4f(const struct shader* shader, const char* name, const m4f v);
 
+/* -1 if the program doesn't have a uniform called `name'. */
+API i32 shader_get_location(const struct shader* shader, const char* name);
+
+/* Set a uniform by a location from `shader_get_location', for code that sets
+ * the same uniforms often enough that it's worth looking them up once,
+ * rather than hashing and searching for the name each time. */
+API void shader_set_f_at(const struct shader* shader, i32 location, const f32 v);
+API void shader_set_i_at(const struct shader* shader, i32 location, const i32 v);
+API void shader_set_u_at(const struct shader* shader, i32 location, const u32 v);
+API void shader_set_b_at(const struct shader* shader, i32 location, const bool v);
+API void shader_set_v2f_at(const struct shader* shader, i32 location, const v2f v);
+API void shader_set_v3f_at(const struct shader* shader, i32 location, const v3f v);
+API void shader_set_v4f_at(const struct shader* shader, i32 location, const v4f v);
+API void shader_set_m4f_at(const struct shader* shader, i32 location, const m4f v);
+
+/* Points the uniform block called `name' at a binding point, for
+ * `bind_uniform_buffer'. */
+API void shader_bind_block(const struct shader* shader, const char* name, u32 binding);
+
+struct uniform_buffer {
+	u32 id;
+	u32 size;
+};
+
+API void init_uniform_buffer(struct uniform_buffer* ub, u32 size);
+API void deinit_uniform_buffer(struct uniform_buffer* ub);
+API void update_uniform_buffer(struct uniform_buffer* ub, const void* data, u32 offset, u32 size);
+API void bind_uniform_buffer(const struct uniform_buffer* ub, u32 binding);
+
 enum {
 	vb_static     = 1 << 0,
 	vb_dynamic    = 1 << 1,
@@ -57,6 +106,10 @@ struct vertex_buffer {
 	u32 ib_id;
 	u32 index_count;
 
+	/* In floats; Set by `push_vertices', and used by `stream_vertices'. */
+	u32 vertex_capacity;
+	u32 vertex_cursor;
+
 	i32 flags;
 };
 
@@ -64,7 +117,7 @@ API void init_vb(struct vertex_buffer* vb, const i32 flags);
 API void deinit_vb(struct vertex_buffer* vb);
 API void bind_vb_for_draw(const struct vertex_buffer* vb);
 API void bind_vb_for_edit(const struct vertex_buffer* vb);
-API void push_vertices(const struct vertex_buffer* vb, f32* vertices, u32 count);
+API void push_vertices(struct vertex_buffer* vb, f32* vertices, u32 count);
 API void push_indices(struct vertex_buffer* vb, u32* indices, u32 count);
 API void update_vertices(const struct vertex_buffer* vb, f32* vertices, u32 offset, u32 count);
 API void update_indices(struct vertex_buffer* vb, u32* indices, u32 offset, u32 count);
@@ -73,6 +126,18 @@ API void configure_vb(const struct vertex_buffer* vb, u32 index, u32 component_c
 API void draw_vb(const struct vertex_buffer* vb);
 API void draw_vb_n(const struct vertex_buffer* vb, u32 count);
 
+/* Treats the vertex buffer as a ring, appending `count' floats after
+ * whatever was streamed last. When the ring is full, the buffer's storage is
+ * orphaned and writing starts again from the beginning, so the GPU never has
+ * to be waited on for draws that are still reading the old data. Returns
+ * where the vertices were written, in floats, for `draw_vb_n_base'.
+ *
+ * The buffer must be bound for editing. */
+API u32 stream_vertices(struct vertex_buffer* vb, const f32* vertices, u32 count);
+
+/* Like `draw_vb_n', but `base_vertex' is added to every index. */
+API void draw_vb_n_base(const struct vertex_buffer* vb, u32 count, u32 base_vertex);
+
 enum {
 	texture_filter_nearest = 1 << 0,
 	texture_filter_linear  = 1 << 2,
@@ -86,9 +151,27 @@ enum {
 
 #define sprite_texture (texture_filter_nearest | texture_clamp)
 
+struct texture_array;
+
 struct texture {
 	u32 id;
 	u32 width, height;
+
+	/* Set once the texture has been copied into a layer of a texture
+	 * array, by `texture_array_add'. */
+	struct texture_array* array;
+	u32 layer;
+
+	/* The slot that a renderer last put the texture in; Only to be trusted
+	 * if the renderer's slot still holds this texture. */
+	u32 slot;
+
+	/* Set if the texture is a sprite sheet that the packer put into an
+	 * atlas page, in which case `id' is the page's, `width' and `height'
+	 * are the sheet's, and the sheet starts at `page_x', `page_y' on the
+	 * page. Such textures can't be updated, and aren't deinitialised. */
+	struct texture* page;
+	u32 page_x, page_y;
 };
 
 API void init_texture(struct texture* texture, u8* src, u64 size, u32 flags);
@@ -98,6 +181,30 @@ API void update_texture_no_bmp(struct texture* texture, u8* src, u32 w, u32 h, u
 API void deinit_texture(struct texture* texture);
 API void bind_texture(const struct texture* texture, u32 unit);
 
+/* Layers of the same size, sampled with a `sampler2DArray'.
+ *
+ * Textures that are added are copied into a layer of their own, at its top
+ * left corner, so textures smaller than the layers can be added too, as long
+ * as UVs are worked out against the size of the layers. The renderer does
+ * this for any texture that has been added to its array, so that every such
+ * texture can be drawn in the same batch. */
+struct texture_array {
+	u32 id;
+	u32 width, height;
+
+	u32 layer_count;
+	u32 layer_capacity;
+};
+
+API void init_texture_array(struct texture_array* array, u32 width, u32 height, u32 layer_capacity, u32 flags);
+API void deinit_texture_array(struct texture_array* array);
+
+/* Returns false if the texture is too big for the layers, or the array is
+ * full. Only for RGB and RGBA textures. Adding a texture that lives on an
+ * atlas page adds the page. */
+API bool texture_array_add(struct texture_array* array, struct texture* texture);
+API void bind_texture_array(const struct texture_array* array, u32 unit);
+
 struct render_target {
 	u32 id;
 	u32 width, height;
@@ -137,6 +244,15 @@ struct light {
 	f32 intensity;
 };
 
+struct renderer_stats {
+	u32 draw_calls;
+	u32 quad_count;
+	u32 light_uploads;
+
+	/* Seconds. */
+	f64 flush_time;
+};
+
 struct renderer {
 	struct shader shader;
 	struct vertex_buffer vb;
@@ -146,6 +262,10 @@ struct renderer {
 	struct texture* textures[32];
 	u32 texture_count;
 
+	/* Optional; Textures in it are drawn from it rather than taking up one
+	 * of `textures'. */
+	struct texture_array* texture_array;
+
 	bool clip_enable;
 	bool camera_enable;
 
@@ -159,23 +279,48 @@ struct renderer {
 
 	f32 ambient_light;
 
+	/* Looked up by `new_renderer', as they're set on every flush. */
+	i32 camera_location;
+	i32 view_location;
+	i32 ambient_light_location;
+
 	struct light lights[max_lights];
 	u32 light_count;
 
-	f32 verts[100 * 11 * 4];
-	u32 indices[100 * 6];
+	/* The lights are only uploaded when they differ from the last
+	 * frame's. */
+	struct uniform_buffer light_buffer;
+	u32 uploaded_light_count;
+	bool lights_dirty;
+
+	/* Quads are gathered here until the batch is full, or until something
+	 * forces a flush, and are then streamed into `vb' in one go. The index
+	 * buffer never changes, so it's only made once, by `new_renderer'. */
+	f32* verts;
+	u32 batch_size;
+
+	struct renderer_stats stats;
+	struct renderer_stats last_frame_stats;
 };
 
+/* The number of quads in a batch, for `new_renderer'. */
+#define default_batch_size 16384
+
 API struct renderer* new_renderer(struct shader shader, v2i dimentions);
+API struct renderer* new_renderer_ex(struct shader shader, v2i dimentions, u32 batch_size);
 API void free_renderer(struct renderer* renderer);
 API void renderer_flush(struct renderer* renderer);
 API void renderer_end_frame(struct renderer* renderer);
 API void renderer_push(struct renderer* renderer, struct textured_quad* quad);
+API void renderer_push_n(struct renderer* renderer, const struct textured_quad* quads, u32 count);
 API void renderer_push_light(struct renderer* renderer, struct light light);
 API void renderer_clip(struct renderer* renderer, struct rect clip);
 API void renderer_resize(struct renderer* renderer, v2i size);
 API void renderer_fit_to_main_window(struct renderer* renderer);
 
+/* For the last frame that was ended with `renderer_end_frame'. */
+API struct renderer_stats get_renderer_stats(const struct renderer* renderer);
+
 struct post_processor {
 	struct render_target target;
 
@@ -10,6 +10,20 @@
 
 bool depth_test_enabled = false;
 
+/* Set by `video_init_headless'; Every entry point that would talk to OpenGL
+ * returns before it does, only keeping the sizes of textures and render
+ * targets, which the game reads back. */
+static bool headless = false;
+
+void video_init_headless() {
+	headless = true;
+	depth_test_enabled = false;
+}
+
+bool video_is_headless() {
+	return headless;
+}
+
 void video_init() {
 	if (!gladLoadGL()) {
 		fprintf(stderr, "Failed to load OpenGL.\n");
@@ -24,6 +38,8 @@ void video_init() {
 }
 
 void video_clear() {
+	if (headless) { return; }
+
 	glDisable(GL_SCISSOR_TEST);
 	glClear(GL_COLOR_BUFFER_BIT);
 
@@ -48,6 +64,8 @@ void video_enable(u32 thing) {
 		depth_test_enabled = true;
 	}
 
+	if (headless) { return; }
+
 	glEnable(get_gl_thing(thing));
 }
 
@@ -56,10 +74,14 @@ void video_disable(u32 thing) {
 		depth_test_enabled = false;
 	}
 
+	if (headless) { return; }
+
 	glDisable(get_gl_thing(thing));
 }
 
 void video_clip(struct rect rect) {
+	if (headless) { return; }
+
 	glScissor(rect.x, rect.y, rect.w, rect.h);
 }
 
@@ -76,8 +98,69 @@ struct bmp_header {
 };
 #pragma pack(pop)
 
+static i32 shader_uniform_cmp(const void* a, const void* b) {
+	const u64 x = ((const struct shader_uniform*)a)->hash;
+	const u64 y = ((const struct shader_uniform*)b)->hash;
+	return (x > y) - (x < y);
+}
+
+static void add_uniform(struct shader* shader, u32* capacity, const char* uniform_name) {
+	const i32 location = glGetUniformLocation(shader->id, uniform_name);
+
+	/* Members of uniform blocks don't have a location. */
+	if (location == -1) { return; }
+
+	if (shader->uniform_count >= *capacity) {
+		*capacity = *capacity < 8 ? 8 : *capacity * 2;
+		shader->uniforms = core_realloc(shader->uniforms, *capacity * sizeof(struct shader_uniform));
+	}
+
+	shader->uniforms[shader->uniform_count++] = (struct shader_uniform) {
+		.hash = elf_hash((const u8*)uniform_name, (u32)strlen(uniform_name)),
+		.name = copy_string(uniform_name),
+		.location = location
+	};
+}
+
+static void find_uniforms(struct shader* shader) {
+	i32 count;
+	glGetProgramiv(shader->id, GL_ACTIVE_UNIFORMS, &count);
+
+	u32 capacity = 0;
+
+	for (i32 i = 0; i < count; i++) {
+		char uniform_name[256];
+		i32 len, size;
+		u32 type;
+		glGetActiveUniform(shader->id, (u32)i, sizeof(uniform_name), &len, &size, &type, uniform_name);
+
+		add_uniform(shader, &capacity, uniform_name);
+
+		/* Arrays are only listed once, as "name[0]". */
+		if (size > 1 && len > 3 && strcmp(uniform_name + len - 3, "[0]") == 0) {
+			uniform_name[len - 3] = '\0';
+			add_uniform(shader, &capacity, uniform_name);
+
+			for (i32 ii = 1; ii < size; ii++) {
+				char element_name[300];
+				sprintf(element_name, "%s[%d]", uniform_name, ii);
+				add_uniform(shader, &capacity, element_name);
+			}
+		}
+	}
+
+	qsort(shader->uniforms, shader->uniform_count, sizeof(struct shader_uniform), shader_uniform_cmp);
+}
+
 void init_shader(struct shader* shader, const char* source, const char* name) {
 	shader->panic = false;
+	shader->uniforms = null;
+	shader->uniform_count = 0;
+
+	if (headless) {
+		shader->id = 0;
+		return;
+	}
 
 	const u32 source_len = (u32)strlen(source);
 
@@ -211,73 +294,180 @@ void init_shader(struct shader* shader, const char* source, const char* name) {
 	core_free(geometry_source);
 
 	shader->id = id;
+
+	if (!shader->panic) {
+		find_uniforms(shader);
+	}
 }
 
 void deinit_shader(struct shader* shader) {
+	if (shader->uniforms) {
+		for (u32 i = 0; i < shader->uniform_count; i++) {
+			core_free(shader->uniforms[i].name);
+		}
+
+		core_free(shader->uniforms);
+		shader->uniforms = null;
+		shader->uniform_count = 0;
+	}
+
+	if (headless) { return; }
+
 	glDeleteProgram(shader->id);
 }
 
 void bind_shader(const struct shader* shader) {
+	if (headless) { return; }
+
 	glUseProgram(shader ? shader->id : 0);
 }
 
 void shader_set_f(const struct shader* shader, const char* name, const f32 v) {
-	if (shader->panic) { return; }
+	shader_set_f_at(shader, shader_get_location(shader, name), v);
+}
+
+void shader_set_i(const struct shader* shader, const char* name, const i32 v) {
+	shader_set_i_at(shader, shader_get_location(shader, name), v);
+}
+
+void shader_set_u(const struct shader* shader, const char* name, const u32 v) {
+	shader_set_u_at(shader, shader_get_location(shader, name), v);
+}
+
+void shader_set_b(const struct shader* shader, const char* name, const bool v) {
+	shader_set_b_at(shader, shader_get_location(shader, name), v);
+}
+
+void shader_set_v2f(const struct shader* shader, const char* name, const v2f v) {
+	shader_set_v2f_at(shader, shader_get_location(shader, name), v);
+}
+
+void shader_set_v3f(const struct shader* shader, const char* name, const v3f v) {
+	shader_set_v3f_at(shader, shader_get_location(shader, name), v);
+}
+
+void shader_set_v4f(const struct shader* shader, const char* name, const v4f v) {
+	shader_set_v4f_at(shader, shader_get_location(shader, name), v);
+}
+
+void shader_set_m4f(const struct shader* shader, const char* name, const m4f v) {
+	shader_set_m4f_at(shader, shader_get_location(shader, name), v);
+}
+
+void shader_set_f_at(const struct shader* shader, i32 location, const f32 v) {
+	if (headless || shader->panic) { return; }
 
-	u32 location = glGetUniformLocation(shader->id, name);
 	glUniform1f(location, v);
 }
 
-void shader_set_i(const struct shader* shader, const char* name, const i32 v) {
-	if (shader->panic) { return; }
+void shader_set_i_at(const struct shader* shader, i32 location, const i32 v) {
+	if (headless || shader->panic) { return; }
 
-	u32 location = glGetUniformLocation(shader->id, name);
 	glUniform1i(location, v);
 }
 
-void shader_set_u(const struct shader* shader, const char* name, const u32 v) {
-	if (shader->panic) { return; }
+void shader_set_u_at(const struct shader* shader, i32 location, const u32 v) {
+	if (headless || shader->panic) { return; }
 
-	u32 location = glGetUniformLocation(shader->id, name);
 	glUniform1ui(location, v);
 }
 
-void shader_set_b(const struct shader* shader, const char* name, const bool v) {
-	if (shader->panic) { return; }
+void shader_set_b_at(const struct shader* shader, i32 location, const bool v) {
+	if (headless || shader->panic) { return; }
 
-	u32 location = glGetUniformLocation(shader->id, name);
 	glUniform1i(location, v);
 }
 
-void shader_set_v2f(const struct shader* shader, const char* name, const v2f v) {
-	if (shader->panic) { return; }
+void shader_set_v2f_at(const struct shader* shader, i32 location, const v2f v) {
+	if (headless || shader->panic) { return; }
 
-	u32 location = glGetUniformLocation(shader->id, name);
 	glUniform2f(location, v.x, v.y);
 }
 
-void shader_set_v3f(const struct shader* shader, const char* name, const v3f v) {
-	if (shader->panic) { return; }
+void shader_set_v3f_at(const struct shader* shader, i32 location, const v3f v) {
+	if (headless || shader->panic) { return; }
 
-	u32 location = glGetUniformLocation(shader->id, name);
 	glUniform3f(location, v.x, v.y, v.z);
 }
 
-void shader_set_v4f(const struct shader* shader, const char* name, const v4f v) {
-	if (shader->panic) { return; }
+void shader_set_v4f_at(const struct shader* shader, i32 location, const v4f v) {
+	if (headless || shader->panic) { return; }
 
-	u32 location = glGetUniformLocation(shader->id, name);
 	glUniform4f(location, v.x, v.y, v.z, v.w);
 }
 
-void shader_set_m4f(const struct shader* shader, const char* name, const m4f v) {
-	if (shader->panic) { return; }
+void shader_set_m4f_at(const struct shader* shader, i32 location, const m4f v) {
+	if (headless || shader->panic) { return; }
 
-	u32 location = glGetUniformLocation(shader->id, name);
 	glUniformMatrix4fv(location, 1, GL_FALSE, (f32*)v.m);
 }
 
+i32 shader_get_location(const struct shader* shader, const char* name) {
+	const u64 hash = elf_hash((const u8*)name, (u32)strlen(name));
+
+	u32 lo = 0, hi = shader->uniform_count;
+	while (lo < hi) {
+		const u32 mid = lo + (hi - lo) / 2;
+
+		if (shader->uniforms[mid].hash < hash) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	for (; lo < shader->uniform_count && shader->uniforms[lo].hash == hash; lo++) {
+		if (strcmp(shader->uniforms[lo].name, name) == 0) {
+			return shader->uniforms[lo].location;
+		}
+	}
+
+	return -1;
+}
+
+void shader_bind_block(const struct shader* shader, const char* name, u32 binding) {
+	if (headless || shader->panic) { return; }
+
+	const u32 index = glGetUniformBlockIndex(shader->id, name);
+	if (index != GL_INVALID_INDEX) {
+		glUniformBlockBinding(shader->id, index, binding);
+	}
+}
+
+void init_uniform_buffer(struct uniform_buffer* ub, u32 size) {
+	ub->size = size;
+
+	if (headless) { return; }
+
+	glGenBuffers(1, &ub->id);
+	glBindBuffer(GL_UNIFORM_BUFFER, ub->id);
+	glBufferData(GL_UNIFORM_BUFFER, size, null, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void deinit_uniform_buffer(struct uniform_buffer* ub) {
+	if (headless) { return; }
+
+	glDeleteBuffers(1, &ub->id);
+}
+
+void update_uniform_buffer(struct uniform_buffer* ub, const void* data, u32 offset, u32 size) {
+	if (headless) { return; }
+
+	glBindBuffer(GL_UNIFORM_BUFFER, ub->id);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void bind_uniform_buffer(const struct uniform_buffer* ub, u32 binding) {
+	if (headless) { return; }
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, ub->id);
+}
+
 void init_vb(struct vertex_buffer* vb, const i32 flags) {
+	if (headless) { return; }
+
 	vb->flags = flags;
 
 	glGenVertexArrays(1, &vb->va_id);
@@ -286,16 +476,22 @@ void init_vb(struct vertex_buffer* vb, const i32 flags) {
 }
 
 void deinit_vb(struct vertex_buffer* vb) {
+	if (headless) { return; }
+
 	glDeleteVertexArrays(1, &vb->va_id);
 	glDeleteBuffers(1, &vb->vb_id);
 	glDeleteBuffers(1, &vb->ib_id);
 }
 
 void bind_vb_for_draw(const struct vertex_buffer* vb) {
+	if (headless) { return; }
+
 	glBindVertexArray(vb ? vb->va_id : 0);
 }
 
 void bind_vb_for_edit(const struct vertex_buffer* vb) {
+	if (headless) { return; }
+
 	if (!vb) {
 		glBindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -307,7 +503,12 @@ void bind_vb_for_edit(const struct vertex_buffer* vb) {
 	}
 }
 
-void push_vertices(const struct vertex_buffer* vb, f32* vertices, u32 count) {
+void push_vertices(struct vertex_buffer* vb, f32* vertices, u32 count) {
+	vb->vertex_capacity = count;
+	vb->vertex_cursor = 0;
+
+	if (headless) { return; }
+
 	const u32 mode = vb->flags & vb_static ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
 
 	glBufferData(GL_ARRAY_BUFFER, count * sizeof(f32), vertices, mode);
@@ -318,10 +519,14 @@ void push_indices(struct vertex_buffer* vb, u32* indices, u32 count) {
 
 	vb->index_count = count;
 
+	if (headless) { return; }
+
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(f32), indices, mode);
 }
 
 void update_vertices(const struct vertex_buffer* vb, f32* vertices, u32 offset, u32 count) {
+	if (headless) { return; }
+
 	glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(f32),
 		count * sizeof(f32), vertices);
 }
@@ -329,6 +534,8 @@ void update_vertices(const struct vertex_buffer* vb, f32* vertices, u32 offset,
 void update_indices(struct vertex_buffer* vb, u32* indices, u32 offset, u32 count) {
 	vb->index_count = count;
 
+	if (headless) { return; }
+
 	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset * sizeof(u32),
 		count * sizeof(u32), indices);
 }
@@ -336,12 +543,16 @@ void update_indices(struct vertex_buffer* vb, u32* indices, u32 offset, u32 coun
 void configure_vb(const struct vertex_buffer* vb, u32 index, u32 component_count, 
 	u32 stride, u32 offset) {
 	
+	if (headless) { return; }
+
 	glVertexAttribPointer(index, component_count, GL_FLOAT, GL_FALSE,
 		stride * sizeof(f32), (void*)(u64)(offset * sizeof(f32)));
 	glEnableVertexAttribArray(index);
 }
 
 void draw_vb(const struct vertex_buffer* vb) {
+	if (headless) { return; }
+
 	u32 draw_type = GL_TRIANGLES;
 	if (vb->flags & vb_lines) {
 		draw_type = GL_LINES;
@@ -353,6 +564,8 @@ void draw_vb(const struct vertex_buffer* vb) {
 }
 
 void draw_vb_n(const struct vertex_buffer* vb, u32 count) {
+	if (headless) { return; }
+
 	u32 draw_type = GL_TRIANGLES;
 	if (vb->flags & vb_lines) {
 		draw_type = GL_LINES;
@@ -363,6 +576,50 @@ void draw_vb_n(const struct vertex_buffer* vb, u32 count) {
 	glDrawElements(draw_type, count, GL_UNSIGNED_INT, 0);
 }
 
+u32 stream_vertices(struct vertex_buffer* vb, const f32* vertices, u32 count) {
+	assert(count <= vb->vertex_capacity);
+
+	if (vb->vertex_cursor + count > vb->vertex_capacity) {
+		vb->vertex_cursor = 0;
+
+		if (!headless) {
+			const u32 mode = vb->flags & vb_static ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW;
+			glBufferData(GL_ARRAY_BUFFER, vb->vertex_capacity * sizeof(f32), null, mode);
+		}
+	}
+
+	const u32 offset = vb->vertex_cursor;
+	vb->vertex_cursor += count;
+
+	if (headless) { return offset; }
+
+	/* Nothing that has been drawn reads from this range since the last
+	 * orphan, so there's no need to synchronise. */
+	void* dst = glMapBufferRange(GL_ARRAY_BUFFER, offset * sizeof(f32), count * sizeof(f32),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (dst) {
+		memcpy(dst, vertices, count * sizeof(f32));
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	} else {
+		glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(f32), count * sizeof(f32), vertices);
+	}
+
+	return offset;
+}
+
+void draw_vb_n_base(const struct vertex_buffer* vb, u32 count, u32 base_vertex) {
+	if (headless) { return; }
+
+	u32 draw_type = GL_TRIANGLES;
+	if (vb->flags & vb_lines) {
+		draw_type = GL_LINES;
+	} else if (vb->flags & vb_line_strip) {
+		draw_type = GL_LINE_STRIP;
+	}
+
+	glDrawElementsBaseVertex(draw_type, count, GL_UNSIGNED_INT, 0, (i32)base_vertex);
+}
+
 void init_texture(struct texture* texture, u8* data, u64 size, u32 flags) {
 	assert(size > sizeof(struct bmp_header));
 
@@ -385,6 +642,20 @@ void init_texture(struct texture* texture, u8* data, u64 size, u32 flags) {
 }
 
 void init_texture_no_bmp(struct texture* texture, u8* src, u32 w, u32 h, u32 flags) {
+	texture->array = null;
+	texture->layer = 0;
+	texture->slot = 0;
+	texture->page = null;
+	texture->page_x = 0;
+	texture->page_y = 0;
+
+	if (headless) {
+		texture->id = 0;
+		texture->width = w;
+		texture->height = h;
+		return;
+	}
+
 	glGenTextures(1, &texture->id);
 	glBindTexture(GL_TEXTURE_2D, texture->id);
 
@@ -478,6 +749,12 @@ void update_texture(struct texture* texture, u8* data, u64 size, u32 flags) {
 }
 
 void update_texture_no_bmp(struct texture* texture, u8* src, u32 w, u32 h, u32 flags) {
+	if (headless) {
+		texture->width = w;
+		texture->height = h;
+		return;
+	}
+
 	glBindTexture(GL_TEXTURE_2D, texture->id);
 
 	GLenum format = GL_RGB;
@@ -536,10 +813,14 @@ void update_texture_no_bmp(struct texture* texture, u8* src, u32 w, u32 h, u32 f
 }
 
 void deinit_texture(struct texture* texture) {
+	if (headless) { return; }
+
 	glDeleteTextures(1, &texture->id);
 }
 
 void bind_texture(const struct texture* texture, u32 unit) {
+	if (headless) { return; }
+
 	if (!texture) {
 		glBindTexture(GL_TEXTURE_2D, 0);
 		return;
@@ -549,7 +830,101 @@ void bind_texture(const struct texture* texture, u32 unit) {
 	glBindTexture(GL_TEXTURE_2D, texture->id);
 }
 
+void init_texture_array(struct texture_array* array, u32 width, u32 height, u32 layer_capacity, u32 flags) {
+	array->width = width;
+	array->height = height;
+	array->layer_count = 0;
+	array->layer_capacity = layer_capacity;
+
+	if (headless) {
+		array->id = 0;
+		return;
+	}
+
+	glGenTextures(1, &array->id);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, array->id);
+
+	GLenum wrap_mode = GL_REPEAT;
+	if (flags & texture_clamp) {
+		wrap_mode = GL_CLAMP_TO_EDGE;
+	}
+
+	GLenum filter_mode = GL_LINEAR;
+	if (flags & texture_filter_nearest) {
+		filter_mode = GL_NEAREST;
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap_mode);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap_mode);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter_mode);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter_mode);
+
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, layer_capacity, 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, null);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void deinit_texture_array(struct texture_array* array) {
+	if (headless) { return; }
+
+	glDeleteTextures(1, &array->id);
+}
+
+bool texture_array_add(struct texture_array* array, struct texture* texture) {
+	if (texture->page) {
+		return texture_array_add(array, texture->page);
+	}
+
+	if (texture->array == array) { return true; }
+
+	if (array->layer_count >= array->layer_capacity ||
+		texture->width > array->width || texture->height > array->height) {
+		return false;
+	}
+
+	const u32 layer = array->layer_count++;
+
+	if (!headless) {
+		u8* pixels = core_alloc(texture->width * texture->height * 4);
+
+		/* The pixels the texture was made from aren't kept around, so
+		 * they are read back. */
+		glBindTexture(GL_TEXTURE_2D, texture->id);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY, array->id);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, texture->width, texture->height, 1,
+			GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		core_free(pixels);
+	}
+
+	texture->array = array;
+	texture->layer = layer;
+
+	return true;
+}
+
+void bind_texture_array(const struct texture_array* array, u32 unit) {
+	if (headless) { return; }
+
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, array ? array->id : 0);
+}
+
 void init_render_target(struct render_target* target, u32 width, u32 height) {
+	if (headless) {
+		target->id = 0;
+		target->output = 0;
+		target->width = width;
+		target->height = height;
+		return;
+	}
+
 	glGenFramebuffers(1, &target->id);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, target->id);
@@ -580,6 +955,8 @@ void init_render_target(struct render_target* target, u32 width, u32 height) {
 }
 
 void deinit_render_target(struct render_target* target) {
+	if (headless) { return; }
+
 	glDeleteFramebuffers(1, &target->id);
 	glDeleteTextures(1, &target->output);
 }
@@ -590,12 +967,16 @@ void resize_render_target(struct render_target* target, u32 width, u32 height) {
 	target->width = width;
 	target->height = height;
 
+	if (headless) { return; }
+
 	glBindTexture(GL_TEXTURE_2D, target->output);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, null);
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void bind_render_target(struct render_target* target) {
+	if (headless) { return; }
+
 	if (!target) {
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 		glBindTexture(GL_TEXTURE_2D, 0);
@@ -606,6 +987,8 @@ void bind_render_target(struct render_target* target) {
 }
 
 void bind_render_target_output(struct render_target* target, u32 unit) {
+	if (headless) { return; }
+
 	if (!target) {
 		glBindTexture(GL_TEXTURE_2D, 0);
 		return;
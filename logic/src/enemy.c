@@ -30,7 +30,8 @@ entity new_bat(struct world* world, struct room* room, v2f position, char* path_
 		.position = position,
 		.dimentions = { sprite.frames[0].w * sprite_scale, sprite.frames[0].h * sprite_scale });
 	add_component(world, e, struct animated_sprite, sprite);
-	add_componentv(world, e, struct room_child, .parent = room);
+	scene_add(get_room_scene(room), e);
+	add_componentv(world, e, struct interpolated, 0);
 	add_componentv(world, e, struct bat, .path_name = path_name);
 	add_componentv(world, e, struct enemy,
 		.hp = 1, .damage = 1, .money_drop = 1);
@@ -55,7 +56,8 @@ entity new_spider(struct world* world, struct room* room, v2f position) {
 		.position = { position.x - sprite.rect.w * sprite_scale, position.y - sprite.rect.h * sprite_scale },
 		.dimentions = { sprite.rect.w * sprite_scale, sprite.rect.h * sprite_scale });
 	add_component(world, e, struct sprite, sprite);
-	add_componentv(world, e, struct room_child, .parent = room);
+	scene_add(get_room_scene(room), e);
+	add_componentv(world, e, struct interpolated, 0);
 	add_componentv(world, e, struct enemy,
 		.hp = 5, .damage = 1, .money_drop = 1);
 	add_componentv(world, e, struct spider, .room = room);
@@ -76,7 +78,8 @@ entity new_drill(struct world* world, struct room* room, v2f position) {
 		.position = { position.x - sprite.frames[0].w * sprite_scale, position.y - sprite.frames[0].h * sprite_scale },
 		.dimentions = { sprite.frames[0].w * sprite_scale, sprite.frames[0].h * sprite_scale });
 	add_component(world, e, struct animated_sprite, sprite);
-	add_componentv(world, e, struct room_child, .parent = room);
+	scene_add(get_room_scene(room), e);
+	add_componentv(world, e, struct interpolated, 0);
 	add_componentv(world, e, struct enemy,
 		.hp = 10, .damage = 1, .money_drop = 1);
 	add_componentv(world, e, struct collider, .rect = {
@@ -97,7 +100,8 @@ entity new_scav(struct world* world, struct room* room, v2f position) {
 		.position = { position.x - sprite.frames[0].w * sprite_scale, position.y - sprite.frames[0].h * sprite_scale },
 		.dimentions = { sprite.frames[0].w * sprite_scale, sprite.frames[0].h * sprite_scale });
 	add_component(world, e, struct animated_sprite, sprite);
-	add_componentv(world, e, struct room_child, .parent = room);
+	scene_add(get_room_scene(room), e);
+	add_componentv(world, e, struct interpolated, 0);
 	add_componentv(world, e, struct enemy,
 		.hp = 10, .damage = 1, .money_drop = 3);
 	add_componentv(world, e, struct collider, .rect = {
@@ -347,6 +351,7 @@ void enemy_system(struct world* world, struct room* room, f64 ts) {
 				get_component(world, projectile, struct transform)->position.x += face == player_face_left ?
 					-20 : 20;
 				add_component(world, projectile, struct sprite, sprite);
+				add_componentv(world, projectile, struct interpolated, 0);
 				add_componentv(world, projectile, struct projectile,
 					.face = face,
 					.up = false,
@@ -433,9 +438,7 @@ void enemy_system(struct world* world, struct room* room, f64 ts) {
 			} else {
 				struct rect coin_rect = get_sprite(sprid_coin).rect;
 
-				for (i32 i = 0; i < enemy->money_drop; i++) {
-					new_coin_pickup(world, room, transform->position);
-				}
+				new_coin_pickups(world, room, transform->position, (u32)enemy->money_drop);
 			}
 
 			new_impact_effect(world, transform->position, animsprid_poof);
@@ -16,7 +16,7 @@ entity new_jetpack_particle(struct world* world, v2f position) {
 	return e;
 }
 
-void fx_system(struct world* world, f64 ts) {
+void fx_system(struct world* world, struct ecs_commands* cmds, f64 ts) {
 	for (view(world, view,
 		type_info(struct jetpack_fx),
 		type_info(struct transform),
@@ -32,7 +32,7 @@ void fx_system(struct world* world, f64 ts) {
 		transform->dimentions.y = (8 * sprite_scale * (1.0 - fx->timer)) + 8 * sprite_scale;
 
 		if (fx->timer <= 0.0) {
-			destroy_entity(world, view.e);
+			cmd_destroy_entity(cmds, view.e);
 		}
 	}
 }
@@ -9,4 +9,6 @@ struct jetpack_fx {
 
 entity new_jetpack_particle(struct world* world, v2f position);
 
-void fx_system(struct world* world, f64 ts);
+/* Only touches the particles' own components, so it can run alongside other
+ * systems; Spent particles are destroyed through `cmds'. */
+void fx_system(struct world* world, struct ecs_commands* cmds, f64 ts);
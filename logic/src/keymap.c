@@ -94,3 +94,37 @@ i32 mapped_key(const char* name) {
 
 	return k ? *k : 0;
 }
+
+static const char* latched_action_names[] = { "jump", "fire", "dash", "interact" };
+#define latched_action_count (sizeof(latched_action_names) / sizeof(*latched_action_names))
+
+void latch_actions() {
+	if (logic_store->actions_latched) { return; }
+
+	for (u32 i = 0; i < latched_action_count; i++) {
+		if (key_just_pressed(main_window, mapped_key(latched_action_names[i]))) {
+			logic_store->latched_actions |= 1u << i;
+		}
+	}
+
+	logic_store->actions_latched = true;
+}
+
+void end_action_tick() {
+	logic_store->latched_actions = 0;
+}
+
+void end_action_frame() {
+	logic_store->actions_latched = false;
+}
+
+bool action_just_pressed(const char* name) {
+	for (u32 i = 0; i < latched_action_count; i++) {
+		if (strcmp(latched_action_names[i], name) == 0) {
+			return (logic_store->latched_actions & (1u << i)) != 0;
+		}
+	}
+
+	fprintf(stderr, "`%s' isn't a latched action.\n", name);
+	return false;
+}
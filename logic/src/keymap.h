@@ -7,3 +7,19 @@ void save_keymap();
 void load_keymap();
 
 i32 mapped_key(const char* name);
+
+/* The simulation steps in fixed ticks when a tick rate is set, and a frame
+ * may run no ticks, or several. Presses of the keys that the simulation
+ * acts on are latched as each frame's events come in, and are kept until a
+ * tick has run; Every tick after that, within the same frame, sees no
+ * press, and presses made over frames that run no tick are all seen by the
+ * next one.
+ *
+ * `latch_actions' only takes the frame's presses the first time it's
+ * called in a frame, and `end_action_frame' ends the frame. */
+void latch_actions();
+void end_action_tick();
+void end_action_frame();
+
+/* Only for "jump", "fire", "dash" and "interact". */
+bool action_just_pressed(const char* name);
@@ -16,6 +16,10 @@ struct logic_store {
 	struct renderer* renderer;
 	struct renderer* hud_renderer;
 	struct renderer* ui_renderer;
+
+	/* Every sprite sheet and tileset, so that the game renderers can draw
+	 * them all without switching textures. */
+	struct texture_array sprite_array;
 	struct ui_context* ui;
 	bool show_ui;
 	bool show_components;
@@ -28,6 +32,39 @@ struct logic_store {
 	struct world* world;
 	struct room* room;
 
+	struct group* lava_particles;
+
+	/* Structural changes recorded while iterating, applied by
+	 * whichever system recorded them once it has finished. */
+	struct ecs_commands* commands;
+
+	/* The effects systems' own, since they run alongside each other;
+	 * Applied by the `apply_fx' system. */
+	struct ecs_commands* fx_commands;
+	struct ecs_commands* anim_fx_commands;
+
+	/* `fixed_scheduler' runs the systems that simulate, in
+	 * `on_fixed_update' when there is a tick rate and in `on_update'
+	 * otherwise; `scheduler' runs the ones that draw, in `on_update'.
+	 * Rebuilt on every reload, since they hold pointers to functions in
+	 * this library. */
+	struct scheduler* fixed_scheduler;
+	struct scheduler* scheduler;
+
+	/* The last few seconds of the world, for stepping back through
+	 * while paused. `rewind_back' is how far back the debug UI has it.
+	 * Only made while `rewind_on' is set, by the `rewind' command or the
+	 * debug UI, since capturing costs a snapshot a frame. */
+	struct rewind* rewind;
+	f64 rewind_back;
+	bool rewind_on;
+	u64 rewind_budget;
+	u32 rewind_interval;
+
+	/* The tick's or frame's real and scaled timesteps, for the systems. */
+	f64 ts;
+	f64 timestep;
+
 	struct menu* pause_menu;
 	bool paused;
 	bool frozen;
@@ -35,6 +72,10 @@ struct logic_store {
 	void* keymap;
 	void* prompt_ctx;
 
+	/* See `latch_actions'. */
+	u32 latched_actions;
+	bool actions_latched;
+
 	v2f camera_position;
 
 	entity player;
@@ -1,6 +1,7 @@
 #include <math.h>
 #include <stdio.h>
 
+#include "clock.h"
 #include "consts.h"
 #include "core.h"
 #include "coresys.h"
@@ -14,7 +15,9 @@
 #include "menu.h"
 #include "player.h"
 #include "res.h"
+#include "rewind.h"
 #include "savegame.h"
+#include "scheduler.h"
 #include "shop.h"
 #include "sprites.h"
 #include "imui.h"
@@ -25,9 +28,16 @@ EXPORT_SYM u64 C_DECL get_storage_size() {
 	return sizeof(struct logic_store);
 }
 
+static void init_scheduler();
+static void rebuild_scheduler();
+
 EXPORT_SYM void C_DECL on_reload(void* instance) {
 	logic_store = instance;
 
+	if (logic_store->scheduler) {
+		rebuild_scheduler();
+	}
+
 	/* Sprites are also reloaded every time the code is.
 	 * This is because the sprite textures defined in `sprites.c'
 	 * are reset every reload, and so will become invalid.
@@ -37,6 +47,18 @@ EXPORT_SYM void C_DECL on_reload(void* instance) {
 	preload_sprites();
 }
 
+/* Printed by the bootstrapper every frame with `-hash', to tell whether two
+ * runs of a replay went the same way. Only the types that hold no pointers
+ * are hashed. */
+EXPORT_SYM u64 C_DECL get_state_hash() {
+	struct type_info types[] = {
+		type_info(struct transform),
+		type_info(struct collider)
+	};
+
+	return world_hash(logic_store->world, types, sizeof(types) / sizeof(*types));
+}
+
 EXPORT_SYM struct window* C_DECL create_window() {
 	return new_window(make_v2i(1366, 768), "OpenMV", true);
 }
@@ -120,6 +142,181 @@ static struct lsp_val command_fullscreen(struct lsp_state* ctx, u32 argc, struct
 	return lsp_make_nil();
 }
 
+static struct lsp_val command_tick_rate(struct lsp_state* ctx, u32 argc, struct lsp_val* args) {
+	lsp_arg_assert(ctx, args[0], lsp_val_num, "Argument 0 to `tick_rate' must be a number.");
+
+	set_tick_rate(&main_clock, args[0].as.num);
+
+	/* Which scheduler the simulation's systems are in depends on it; The
+	 * schedulers don't exist yet when this comes from `autoexec.lsp'. */
+	if (logic_store->scheduler) {
+		rebuild_scheduler();
+	}
+
+	return lsp_make_nil();
+}
+
+/* Makes the history again with the current settings, or frees it if
+ * rewinding is off; It can't be made until there's a world. */
+static void update_rewind() {
+	if (logic_store->rewind) {
+		free_rewind(logic_store->rewind);
+		logic_store->rewind = null;
+	}
+
+	logic_store->rewind_back = 0.0;
+
+	if (logic_store->rewind_on && logic_store->world) {
+		logic_store->rewind = new_rewind(logic_store->world, logic_store->rewind_budget, logic_store->rewind_interval);
+	}
+}
+
+/* (rewind on budget-mib interval) */
+static struct lsp_val command_rewind(struct lsp_state* ctx, u32 argc, struct lsp_val* args) {
+	lsp_arg_assert(ctx, args[0], lsp_val_bool, "Argument 0 to `rewind' must be a boolean.");
+	lsp_arg_assert(ctx, args[1], lsp_val_num, "Argument 1 to `rewind' must be a number.");
+	lsp_arg_assert(ctx, args[2], lsp_val_num, "Argument 2 to `rewind' must be a number.");
+
+	logic_store->rewind_on = lsp_as_bool(args[0]) && args[1].as.num > 0.0;
+	logic_store->rewind_budget = (u64)(args[1].as.num * 1024.0 * 1024.0);
+	logic_store->rewind_interval = (u32)args[2].as.num;
+
+	update_rewind();
+
+	return lsp_make_nil();
+}
+
+static void player_node(struct world* world, void* udata) {
+	if (!logic_store->frozen && !logic_store->paused) {
+		player_system(world, logic_store->renderer, &logic_store->room, logic_store->timestep);
+	}
+}
+
+static void lights_node(struct world* world, void* udata) {
+	apply_lights(world, logic_store->renderer);
+	update_room_light(logic_store->room, logic_store->renderer);
+	update_player_light(world, logic_store->renderer, logic_store->player);
+}
+
+static void camera_node(struct world* world, void* udata) {
+	camera_system(world, logic_store->renderer, logic_store->room, logic_store->ts);
+}
+
+static void enemy_node(struct world* world, void* udata) {
+	enemy_system(world, logic_store->room, logic_store->timestep);
+}
+
+static void projectile_node(struct world* world, void* udata) {
+	projectile_system(world, logic_store->room, logic_store->timestep);
+}
+
+static void fx_node(struct world* world, void* udata) {
+	fx_system(world, logic_store->fx_commands, logic_store->timestep);
+}
+
+static void anim_fx_node(struct world* world, void* udata) {
+	anim_fx_system(world, logic_store->anim_fx_commands, logic_store->timestep);
+}
+
+static void damage_fx_node(struct world* world, void* udata) {
+	damage_fx_system(world, logic_store->timestep);
+}
+
+static void apply_fx_node(struct world* world, void* udata) {
+	apply_ecs_commands(logic_store->fx_commands, world);
+	apply_ecs_commands(logic_store->anim_fx_commands, world);
+}
+
+static void room_node(struct world* world, void* udata) {
+	update_room(logic_store->room, logic_store->timestep, logic_store->ts);
+}
+
+static void draw_room_node(struct world* world, void* udata) {
+	draw_room(logic_store->room, logic_store->renderer, logic_store->timestep);
+}
+
+static void draw_damage_fx_node(struct world* world, void* udata) {
+	draw_damage_fx(world, logic_store->renderer, logic_store->timestep);
+}
+
+static void render_node(struct world* world, void* udata) {
+	render_system(world, logic_store->renderer, logic_store->timestep);
+	draw_room_forground(logic_store->room, logic_store->renderer, logic_store->ui_renderer);
+}
+
+static void hud_node(struct world* world, void* udata) {
+	hud_system(world, logic_store->hud_renderer);
+}
+
+/* Nearly every system either creates and destroys entities or draws through
+ * the renderer, so most of them are exclusive, and run in the order they are
+ * added here. The effects only touch their own components, and record their
+ * destroys for `apply_fx', so they declare what they use and run alongside
+ * each other where they don't conflict.
+ *
+ * With a tick rate set, the ones that move things that are drawn
+ * interpolated go in the fixed scheduler, so that they step by the same
+ * amount whatever the frame rate. Effects only live for a moment and aren't
+ * interpolated, so they are left to step with the frame. Without one,
+ * everything runs once a frame in the one scheduler, in the order it always
+ * has: The camera follows the player as it moves that frame. */
+static void init_scheduler() {
+	const bool fixed = main_clock.step > 0.0;
+
+	struct scheduler* f = new_scheduler(logic_store->world);
+	logic_store->fixed_scheduler = f;
+
+	if (fixed) {
+		scheduler_add(f, "player", player_node, null, system_exclusive);
+		scheduler_add(f, "enemy", enemy_node, null, system_exclusive);
+		scheduler_add(f, "projectile", projectile_node, null, system_exclusive);
+		scheduler_add(f, "room", room_node, null, system_exclusive);
+	}
+
+	struct scheduler* s = new_scheduler(logic_store->world);
+	logic_store->scheduler = s;
+
+	if (!fixed) {
+		scheduler_add(s, "player", player_node, null, system_exclusive);
+	}
+
+	scheduler_add(s, "lights", lights_node, null, system_exclusive);
+
+	/* Writes to the renderer's camera and the store. */
+	scheduler_add(s, "camera", camera_node, null, system_exclusive);
+
+	if (!fixed) {
+		scheduler_add(s, "enemy", enemy_node, null, system_exclusive);
+		scheduler_add(s, "projectile", projectile_node, null, system_exclusive);
+	}
+
+	const u32 fx = scheduler_add(s, "fx", fx_node, null, 0);
+	system_writes(s, fx, type_info(struct jetpack_fx), type_info(struct transform), type_info(struct sprite));
+
+	const u32 anim_fx = scheduler_add(s, "anim_fx", anim_fx_node, null, 0);
+	system_reads(s, anim_fx, type_info(struct anim_fx), type_info(struct animated_sprite));
+
+	const u32 damage_fx = scheduler_add(s, "damage_fx", damage_fx_node, null, 0);
+	system_writes(s, damage_fx, type_info(struct damage_num_fx), type_info(struct transform));
+
+	scheduler_add(s, "apply_fx", apply_fx_node, null, system_exclusive);
+
+	if (!fixed) {
+		scheduler_add(s, "room", room_node, null, system_exclusive);
+	}
+
+	scheduler_add(s, "draw_room", draw_room_node, null, system_exclusive);
+	scheduler_add(s, "draw_damage_fx", draw_damage_fx_node, null, system_exclusive);
+	scheduler_add(s, "render", render_node, null, system_exclusive);
+	scheduler_add(s, "hud", hud_node, null, system_exclusive);
+}
+
+static void rebuild_scheduler() {
+	free_scheduler(logic_store->fixed_scheduler);
+	free_scheduler(logic_store->scheduler);
+	init_scheduler();
+}
+
 EXPORT_SYM void C_DECL on_init() {
 	logic_store->lsp_out = fopen("command.log", "w");
 	if (!logic_store->lsp_out) {
@@ -130,6 +327,11 @@ EXPORT_SYM void C_DECL on_init() {
 	lsp_register_std(logic_store->lsp);
 	lsp_register(logic_store->lsp, "window_size", 2, command_window_size);
 	lsp_register(logic_store->lsp, "fullscreen", 1, command_fullscreen);
+	lsp_register(logic_store->lsp, "tick_rate", 1, command_tick_rate);
+	lsp_register(logic_store->lsp, "rewind", 3, command_rewind);
+
+	logic_store->rewind_budget = 16 * 1024 * 1024;
+	logic_store->rewind_interval = 1;
 
 	FILE* autoexec_file = fopen("autoexec.lsp", "rb");
 	if (autoexec_file) {
@@ -152,9 +354,20 @@ EXPORT_SYM void C_DECL on_init() {
 	struct shader sprite_shader = load_shader("res/shaders/sprite.glsl");
 	logic_store->renderer = new_renderer(sprite_shader, make_v2i(1366, 768));
 	logic_store->renderer->camera_enable = true;
-	logic_store->hud_renderer = new_renderer(sprite_shader, make_v2i(1366, 768));
+	/* The HUD is only ever a few dozen quads. */
+	logic_store->hud_renderer = new_renderer_ex(sprite_shader, make_v2i(1366, 768), 1024);
 	logic_store->ui_renderer = new_renderer(sprite_shader, make_v2i(1366, 768));
 
+	/* The biggest sheet is a tileset, at 300x428. */
+	init_texture_array(&logic_store->sprite_array, 512, 512, 16, sprite_texture);
+	for (u32 i = 0; i < texid_count; i++) {
+		texture_array_add(&logic_store->sprite_array, get_texture(i));
+	}
+
+	logic_store->renderer->texture_array = &logic_store->sprite_array;
+	logic_store->hud_renderer->texture_array = &logic_store->sprite_array;
+	logic_store->ui_renderer->texture_array = &logic_store->sprite_array;
+
 	logic_store->explosion_sound = load_audio_clip("res/aud/explosion.wav");
 
 	logic_store->paused = false;
@@ -173,6 +386,19 @@ EXPORT_SYM void C_DECL on_init() {
 
 	struct world* world = new_world();
 	logic_store->world = world;
+	logic_store->commands = new_ecs_commands();
+	logic_store->fx_commands = new_ecs_commands();
+	logic_store->anim_fx_commands = new_ecs_commands();
+	update_rewind();
+
+	init_scheduler();
+
+	/* The sprite group is the one that `render_system' iterates; Lava
+	 * particles are the most numerous sprites, so they get a group that
+	 * nests inside it. */
+	get_group(world, type_info(struct transform), type_info(struct sprite));
+	logic_store->lava_particles = get_group(world,
+		type_info(struct transform), type_info(struct sprite), type_info(struct lava_particle));
 
 	set_component_destroy_func(world, struct upgrade, on_upgrade_destroy);
 
@@ -187,10 +413,31 @@ EXPORT_SYM void C_DECL on_init() {
 	}
 }
 
+/* Only called when a tick rate has been set, with the `tick_rate' command. */
+EXPORT_SYM void C_DECL on_fixed_update(f64 ts) {
+	latch_actions();
+
+	store_previous_positions(logic_store->world);
+
+	logic_store->ts = ts;
+	logic_store->timestep = logic_store->frozen || logic_store->paused ? 0.0 : ts;
+
+	/* Each step's changes get their own tick, for anything tracking them. */
+	world_tick(logic_store->world);
+
+	run_scheduler(logic_store->fixed_scheduler);
+
+	/* Any press has now been acted on. */
+	end_action_tick();
+}
+
 EXPORT_SYM void C_DECL on_update(f64 ts) {
 	struct renderer* renderer = logic_store->renderer;
 	struct world* world = logic_store->world;
 
+	/* Frames that run no tick keep their presses for the next one. */
+	latch_actions();
+
 	logic_store->fps_timer += ts;
 	if (logic_store->fps_timer > 1.0) {
 		sprintf(logic_store->fps_buf, "FPS: %g    Timestep: %g", 1.0 / ts, ts);
@@ -229,10 +476,6 @@ EXPORT_SYM void C_DECL on_update(f64 ts) {
 
 	renderer_resize(logic_store->ui_renderer, make_v2i(win_w, win_h));
 
-	if (!logic_store->frozen && !logic_store->paused) {
-		player_system(world, renderer, &logic_store->room, timestep);
-	}
-
 	post_processor_fit_to_main_window(logic_store->crt);
 
 	if (!logic_store->show_ui) {
@@ -241,24 +484,31 @@ EXPORT_SYM void C_DECL on_update(f64 ts) {
 		use_post_processor(null);
 	}
 
-	apply_lights(world, renderer);
-	update_room_light(logic_store->room, renderer);
-	update_player_light(world, renderer, logic_store->player);
+	const bool fixed = main_clock.step > 0.0;
 
-	camera_system(world, renderer, logic_store->room, ts);
-	enemy_system(world, logic_store->room, timestep);
-	projectile_system(world, logic_store->room, timestep);
-	fx_system(world, timestep);
-	anim_fx_system(world, timestep);
-	update_room(logic_store->room, timestep, ts);
-	draw_room(logic_store->room, renderer, timestep);
-	damage_fx_system(world, renderer, timestep);
+	logic_store->ts = ts;
+	logic_store->timestep = timestep;
 
-	render_system(world, renderer, timestep);
+	if (fixed) {
+		begin_interpolation(world, main_clock.alpha);
+	} else {
+		/* Each frame's changes get their own tick, for anything tracking
+		 * them. */
+		world_tick(world);
+	}
 
-	draw_room_forground(logic_store->room, renderer, logic_store->ui_renderer);
+	run_scheduler(logic_store->scheduler);
 
-	hud_system(world, logic_store->hud_renderer);
+	if (fixed) {
+		end_interpolation(world);
+	} else {
+		end_action_tick();
+	}
+
+	if (logic_store->rewind && !logic_store->frozen && !logic_store->paused) {
+		rewind_capture(logic_store->rewind);
+		logic_store->rewind_back = 0.0;
+	}
 
 	if (!logic_store->show_ui) {
 		renderer_flush(renderer);
@@ -371,6 +621,55 @@ EXPORT_SYM void C_DECL on_update(f64 ts) {
 			sprintf(buf, "Pools: %u", get_component_pool_count(world));
 			ui_text(ui, buf);
 
+			struct renderer_stats render_stats = get_renderer_stats(renderer);
+			sprintf(buf, "Draw calls: %u, %u quads, %u light uploads, flush %.3f ms", render_stats.draw_calls,
+				render_stats.quad_count, render_stats.light_uploads, render_stats.flush_time * 1000.0);
+			ui_text(ui, buf);
+
+			if (main_clock.step > 0.0) {
+				sprintf(buf, "Ticks: %g Hz, %u this frame, %llu total, %llu dropped, alpha %.2f",
+					get_tick_rate(&main_clock), main_clock.frame_ticks,
+					(unsigned long long)main_clock.total_ticks, (unsigned long long)main_clock.dropped_ticks,
+					main_clock.alpha);
+			} else {
+				sprintf(buf, "Ticks: off, stepping with the frame");
+			}
+			ui_text(ui, buf);
+
+			struct scheduler* schedulers[] = { logic_store->fixed_scheduler, logic_store->scheduler };
+			for (u32 s = 0; s < 2; s++) {
+				sprintf(buf, "%s: %.3f ms (critical path %.3f ms)", s == 0 ? "Simulation" : "Systems",
+					get_scheduler_run_time(schedulers[s]) * 1000.0,
+					get_scheduler_critical_path_time(schedulers[s]) * 1000.0);
+				ui_text(ui, buf);
+
+				for (u32 i = 0; i < get_scheduler_system_count(schedulers[s]); i++) {
+					struct system_timing t = get_system_timing(schedulers[s], i);
+
+					sprintf(buf, "%c %s: %.3f ms", t.critical ? '*' : ' ', t.name, t.duration * 1000.0);
+					ui_text(ui, buf);
+				}
+			}
+
+			if (ui_button(ui, logic_store->rewind_on ? "Stop Rewind" : "Start Rewind")) {
+				logic_store->rewind_on = !logic_store->rewind_on;
+				update_rewind();
+			}
+
+			if (logic_store->rewind) {
+				struct rewind_stats rs = get_rewind_stats(logic_store->rewind);
+				sprintf(buf, "Rewind: %u frames, %.1f/%.1f MIB, every %u frames, capture %.3f ms, last delta %.1f KIB",
+					rs.frame_count, (f64)rs.used / (1024.0 * 1024.0), (f64)rs.budget / (1024.0 * 1024.0),
+					logic_store->rewind_interval, rs.capture_time * 1000.0, (f64)rs.last_delta_size / 1024.0);
+				ui_text(ui, buf);
+
+				/* Scrubbing only makes sense while nothing is moving. */
+				if (logic_store->paused && rs.frame_count > 1 &&
+					ui_slider(ui, &logic_store->rewind_back, 0.0, (f64)(rs.frame_count - 1))) {
+					rewind_seek(logic_store->rewind, (u32)logic_store->rewind_back);
+				}
+			}
+
 			if (ui_button(ui, "Give Coin")) {
 				struct player* player = get_component(world, logic_store->player, struct player);
 
@@ -436,6 +735,8 @@ EXPORT_SYM void C_DECL on_update(f64 ts) {
 	} else {
 		flush_post_processor(logic_store->crt, true);
 	}
+
+	end_action_frame();
 }
 
 EXPORT_SYM void C_DECL on_deinit() {
@@ -451,11 +752,20 @@ EXPORT_SYM void C_DECL on_deinit() {
 	free_renderer(logic_store->renderer);
 	free_renderer(logic_store->hud_renderer);
 	free_renderer(logic_store->ui_renderer);
+	deinit_texture_array(&logic_store->sprite_array);
 
 	if (logic_store->ui) {
 		free_ui_context(logic_store->ui);
 	}
 
+	free_scheduler(logic_store->fixed_scheduler);
+	free_scheduler(logic_store->scheduler);
+	free_ecs_commands(logic_store->commands);
+	free_ecs_commands(logic_store->fx_commands);
+	free_ecs_commands(logic_store->anim_fx_commands);
+	if (logic_store->rewind) {
+		free_rewind(logic_store->rewind);
+	}
 	free_world(logic_store->world);
 
 	savegame_deinit();
@@ -168,6 +168,7 @@ entity new_player_entity(struct world* world) {
 		.step_sound = load_audio_clip("res/aud/step.wav"));
 	add_component(world, e, struct animated_sprite, get_animated_sprite(animsprid_player_run_right));
 	add_componentv(world, e, struct collider, .rect = player_constants.left_collider);
+	add_componentv(world, e, struct interpolated, 0);
 	
 	return e;
 }
@@ -271,7 +272,7 @@ void player_system(struct world* world, struct renderer* renderer, struct room**
 			player->dash_cooldown_timer > player_constants.dash_cooldown &&
 			!player->dashing &&
 			player->dash_count < player_constants.max_air_dash &&
-			key_just_pressed(main_window, mapped_key("dash"))) {
+			action_just_pressed("dash")) {
 			player->dashing = true;
 			player->dash_time = 0.0;
 			player->dash_count++;
@@ -342,7 +343,7 @@ void player_system(struct world* world, struct renderer* renderer, struct room**
 			(i32)transform->position.y + collider->rect.y,
 			collider->rect.w, collider->rect.h
 		};
-		if (player->on_ground && key_just_pressed(main_window, mapped_key("interact"))) {
+		if (player->on_ground && action_just_pressed("interact")) {
 			for (view(world, up_view, type_info(struct transform), type_info(struct upgrade), type_info(struct collider))) {
 				struct transform* u_transform = view_get(&up_view, struct transform);
 				struct upgrade* upgrade = view_get(&up_view, struct upgrade);
@@ -386,7 +387,7 @@ void player_system(struct world* world, struct renderer* renderer, struct room**
 
 			if (rect_overlap(player_rect, up_rect, null)) {
 				if (upgrade->booster) {
-					if (player->on_ground && key_just_pressed(main_window, mapped_key("interact"))) {
+					if (player->on_ground && action_just_pressed("interact")) {
 						player->max_hp += player_constants.health_boost_value;
 						player->hp = player->max_hp;
 
@@ -500,7 +501,7 @@ void player_system(struct world* world, struct renderer* renderer, struct room**
 		sprite = view_get(&view, struct animated_sprite);
 		
 		player->shoot_timer -= ts;
-		if ((key_just_pressed(main_window, mapped_key("fire")) || (player->level == 3 && key_pressed(main_window, mapped_key("fire"))))
+		if ((action_just_pressed("fire") || (player->level == 3 && key_pressed(main_window, mapped_key("fire"))))
 			&& player->shoot_timer <= 0.0) {
 			player->shoot_timer = player->shoot_cooldown;
 
@@ -560,6 +561,7 @@ void player_system(struct world* world, struct renderer* renderer, struct room**
 			get_component(world, projectile, struct transform)->position.x += player->face == player_face_left ?
 				-20 : 20;
 			add_component(world, projectile, struct sprite, sprite);
+			add_componentv(world, projectile, struct interpolated, 0);
 			add_componentv(world, projectile, struct projectile,
 				.face = player->face,
 				.up = face_up,
@@ -602,7 +604,7 @@ void player_system(struct world* world, struct renderer* renderer, struct room**
 			}
 		}
 
-		if (key_just_pressed(main_window, mapped_key("jump")) && player->on_ground) {
+		if (action_just_pressed("jump") && player->on_ground) {
 			player->velocity.y = player_constants.jump_force;
 		}
 		
@@ -879,26 +881,32 @@ entity new_impact_effect(struct world* world, v2f position, u32 anim_id) {
 	return e;
 }
 
-void anim_fx_system(struct world* world, f64 ts) {
-	for (view(world, view, type_info(struct transform), type_info(struct anim_fx), type_info(struct animated_sprite))) {
-		struct transform* transform = view_get(&view, struct transform);
+void anim_fx_system(struct world* world, struct ecs_commands* cmds, f64 ts) {
+	for (view(world, view, type_info(struct anim_fx), type_info(struct animated_sprite))) {
 		struct animated_sprite* anim = view_get(&view, struct animated_sprite);
 
 		if (anim->current_frame >= anim->frame_count - 1) {
-			destroy_entity(world, view.e);
+			cmd_destroy_entity(cmds, view.e);
 		}
 	}
 }
 
-void damage_fx_system(struct world* world, struct renderer* renderer, f64 ts) {
-	struct texture* atlas = get_texture(texid_icon);
-
+void damage_fx_system(struct world* world, f64 ts) {
 	for (view(world, view, type_info(struct transform), type_info(struct damage_num_fx))) {
 		struct transform* transform = view_get(&view, struct transform);
 		struct damage_num_fx* d = view_get(&view, struct damage_num_fx);
 
 		d->velocity += 30.0 * ts;
 		transform->position.y -= d->velocity * ts;
+	}
+}
+
+void draw_damage_fx(struct world* world, struct renderer* renderer, f64 ts) {
+	struct texture* atlas = get_texture(texid_icon);
+
+	for (view(world, view, type_info(struct transform), type_info(struct damage_num_fx))) {
+		struct transform* transform = view_get(&view, struct transform);
+		struct damage_num_fx* d = view_get(&view, struct damage_num_fx);
 
 		f32 x = 0.0f;
 
@@ -952,7 +960,7 @@ entity new_coin_pickup(struct world* world, struct room* room, v2f position) {
 	add_componentv(world, e, struct transform, .position = position,
 		.dimentions = { rect.w * sprite_scale, rect.h * sprite_scale });
 	add_component(world, e, struct animated_sprite, sprite);
-	add_componentv(world, e, struct room_child, .parent = room);
+	scene_add(get_room_scene(room), e);
 	add_componentv(world, e, struct coin_pickup, .velocity.x = (f32)random_f64(-100, 100));
 	add_componentv(world, e, struct collider,
 		.rect = { 0, 0, rect.w * sprite_scale, rect.h * sprite_scale });
@@ -960,13 +968,52 @@ entity new_coin_pickup(struct world* world, struct room* room, v2f position) {
 	return e;
 }
 
+void new_coin_pickups(struct world* world, struct room* room, v2f position, u32 count) {
+	struct animated_sprite sprite = get_animated_sprite(animsprid_coin);
+
+	struct rect rect = sprite.frames[0];
+
+	struct transform transforms[8];
+	struct animated_sprite sprites[8];
+	struct coin_pickup pickups[8];
+	struct collider colliders[8];
+	entity entities[8];
+
+	for (u32 i = 0; i < 8; i++) {
+		transforms[i] = (struct transform) { .position = position,
+			.dimentions = { rect.w * sprite_scale, rect.h * sprite_scale } };
+		sprites[i] = sprite;
+		colliders[i] = (struct collider) { .rect = { 0, 0, rect.w * sprite_scale, rect.h * sprite_scale } };
+	}
+
+	while (count > 0) {
+		const u32 batch = minimum(count, 8);
+
+		for (u32 i = 0; i < batch; i++) {
+			pickups[i] = (struct coin_pickup) { .velocity.x = (f32)random_f64(-100, 100) };
+		}
+
+		spawn_batch(world, batch, 4,
+			(struct type_info[]) {
+				type_info(struct transform), type_info(struct animated_sprite),
+				type_info(struct coin_pickup), type_info(struct collider) },
+			(void*[]) { transforms, sprites, pickups, colliders }, entities);
+
+		for (u32 i = 0; i < batch; i++) {
+			scene_add(get_room_scene(room), entities[i]);
+		}
+
+		count -= batch;
+	}
+}
+
 entity new_heart(struct world* world, struct room* room, v2f position, i32 value) {
 	struct animated_sprite sprite = get_animated_sprite(animsprid_heart);
 
 	struct rect rect = sprite.frames[0];
 
 	entity pickup = new_entity(world);
-	add_componentv(world, pickup, struct room_child, .parent = room);
+	scene_add(get_room_scene(room), pickup);
 	add_componentv(world, pickup, struct transform, .position = position,
 		.dimentions = { rect.w * sprite_scale, rect.h * sprite_scale });
 	add_component(world, pickup, struct animated_sprite, sprite);
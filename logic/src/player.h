@@ -95,6 +95,7 @@ struct coin_pickup {
 };
 
 entity new_coin_pickup(struct world* world, struct room* room, v2f position);
+void new_coin_pickups(struct world* world, struct room* room, v2f position, u32 count);
 
 struct projectile {
 	i32 face;
@@ -115,7 +116,8 @@ struct anim_fx {
 	u32 d;
 };
 
-void anim_fx_system(struct world* world, f64 ts);
+/* Destroys finished effects through `cmds'. */
+void anim_fx_system(struct world* world, struct ecs_commands* cmds, f64 ts);
 
 entity new_impact_effect(struct world* world, v2f position, u32 anim_id);
 
@@ -125,6 +127,9 @@ struct damage_num_fx {
 	f64 timer;
 };
 
-void damage_fx_system(struct world* world, struct renderer* renderer, f64 ts);
+/* `damage_fx_system' moves the numbers, and touches nothing else;
+ * `draw_damage_fx' draws them, and destroys them once they've faded. */
+void damage_fx_system(struct world* world, f64 ts);
+void draw_damage_fx(struct world* world, struct renderer* renderer, f64 ts);
 
 entity new_damage_number(struct world* world, v2f position, i32 number);
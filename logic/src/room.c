@@ -15,6 +15,8 @@
 #include "physics.h"
 #include "player.h"
 #include "res.h"
+#include "rewind.h"
+#include "rng.h"
 #include "room.h"
 #include "savegame.h"
 #include "shop.h"
@@ -87,6 +89,9 @@ struct room {
 
 	struct world* world;
 
+	/* Everything the room spawned, destroyed along with it. */
+	struct scene* entities;
+
 	bool transitioning_out;
 	bool transitioning_in;
 
@@ -140,6 +145,7 @@ void skip_name(struct file* file) {
 struct room* load_room(struct world* world, const char* path) {
 	struct room* room = core_calloc(1, sizeof(struct room));
 	room->world = world;
+	room->entities = new_scene(world, path);
 
 	room->map = load_map(path);
 	struct tiled_map* map = room->map;
@@ -174,6 +180,12 @@ struct room* load_room(struct world* world, const char* path) {
 	room->tilesets = map->tilesets;
 	room->tileset_count = map->tileset_count;
 
+	for (u32 i = 0; i < room->tileset_count; i++) {
+		if (room->tilesets[i].image) {
+			texture_array_add(&logic_store->sprite_array, room->tilesets[i].image);
+		}
+	}
+
 	/* Load the tile layers */
 	for (u32 i = 0; i < map->layer_count; i++) {
 		struct layer* layer = map->layers + i;
@@ -444,7 +456,7 @@ struct room* load_room(struct world* world, const char* path) {
 								struct sprite sprite = get_sprite(sprite_id);
 
 								entity pickup = new_entity(world);
-								add_componentv(world, pickup, struct room_child, .parent = room);
+								scene_add(room->entities, pickup);
 								add_componentv(world, pickup, struct transform,
 									.position = { r.x * sprite_scale, r.y * sprite_scale },
 									.dimentions = { sprite.rect.w * sprite_scale, sprite.rect.h * sprite_scale });
@@ -457,7 +469,7 @@ struct room* load_room(struct world* world, const char* path) {
 								struct sprite sprite = get_sprite(sprite_id);
 
 								entity pickup = new_entity(world);
-								add_componentv(world, pickup, struct room_child, .parent = room);
+								scene_add(room->entities, pickup);
 								add_componentv(world, pickup, struct transform,
 									.position = { r.x * sprite_scale, r.y * sprite_scale },
 									.dimentions = { sprite.rect.w * sprite_scale, sprite.rect.h * sprite_scale });
@@ -532,7 +544,7 @@ struct room* load_room(struct world* world, const char* path) {
 							add_componentv(world, e, struct transform, .position = { r.x * sprite_scale, r.y * sprite_scale });
 							add_componentv(world, e, struct entity_spawner, .spawn_type = spawn_type,
 								.next_spawn = random_f64(min, max), .max_increment = (f64)max, .min_increment = (f64)min);
-							add_componentv(world, e, struct room_child, .parent = room);
+							scene_add(room->entities, e);
 						}
 					}
 				} else if (strcmp(layer->name, "lava") == 0) {
@@ -546,7 +558,7 @@ struct room* load_room(struct world* world, const char* path) {
 							add_componentv(world, e, struct lava, .collider = {
 								r.x * sprite_scale, r.y * sprite_scale,
 								r.w * sprite_scale, r.h * sprite_scale});
-							add_componentv(world, e, struct room_child, .parent = room);
+							scene_add(room->entities, e);
 						}
 					}
 				} else if (strcmp(layer->name, "shops") == 0) {	
@@ -564,7 +576,7 @@ struct room* load_room(struct world* world, const char* path) {
 							entity e = new_entity(world);
 							add_componentv(world, e, struct transform, .position = { r.x * sprite_scale, r.y * sprite_scale });
 							add_componentv(world, e, struct light, .intensity = intensity, .range = range);
-							add_componentv(world, e, struct room_child, .parent = room);
+							scene_add(room->entities, e);
 						}
 					}
 				} else {
@@ -579,17 +591,16 @@ struct room* load_room(struct world* world, const char* path) {
 }
 
 void free_room(struct room* room) {
+	/* The history is of this room's entities, which are about to go. */
+	if (logic_store->rewind) {
+		rewind_clear(logic_store->rewind);
+	}
+
 	free_map(room->map);
 
 	core_free(room->path);
 
-	for (view(room->world, view, type_info(struct room_child))) {
-		struct room_child* rc = view_get(&view, struct room_child);
-		
-		if (rc->parent == room) {
-			destroy_entity(room->world, view.e);
-		}
-	}
+	free_scene(room->entities);
 
 	if (room->box_colliders) {
 		core_free(room->box_colliders);
@@ -650,6 +661,10 @@ static void draw_tile_layer(struct room* room, struct renderer* renderer, struct
 		end_x = end_x > layer->w ? layer->w : end_x;
 		end_y = end_y > layer->h ? layer->h : end_y;
 
+		/* Tiles are gathered up and pushed a few at a time. */
+		struct textured_quad quads[64];
+		u32 quad_count = 0;
+
 		for (u32 y = start_y; y < end_y; y++) {
 			for (u32 x = start_x; x < end_x; x++) {
 				struct tile tile = layer->tiles[x + y * layer->w];
@@ -680,10 +695,16 @@ static void draw_tile_layer(struct room* room, struct renderer* renderer, struct
 						};
 					}
 
-					renderer_push(renderer, &quad);
+					quads[quad_count++] = quad;
+					if (quad_count == sizeof(quads) / sizeof(*quads)) {
+						renderer_push_n(renderer, quads, quad_count);
+						quad_count = 0;
+					}
 				}
 			}
 		}
+
+		renderer_push_n(renderer, quads, quad_count);
 	}
 }
 
@@ -713,6 +734,21 @@ void update_room_light(struct room* room, struct renderer* renderer) {
 	}
 }
 
+static void fall_system(struct view* view, void* udata) {
+	const f64 ts = *(f64*)udata;
+
+	struct transform* transform = view_get(view, struct transform);
+	struct fall* fall = view_get(view, struct fall);
+
+	fall->velocity.y += g_gravity * ts * fall->mul;
+
+	if (fall->velocity.y > g_max_gravity) {
+		fall->velocity.y = g_max_gravity;
+	}
+
+	transform->position = v2f_add(transform->position, v2f_mul(fall->velocity, make_v2f(ts, ts)));
+}
+
 void update_room(struct room* room, f64 ts, f64 actual_ts) {
 	/* Update tile animations */
 	for (u32 i = 0; i < room->tileset_count; i++) {
@@ -755,7 +791,7 @@ void update_room(struct room* room, f64 ts, f64 actual_ts) {
 							-(sprite.rect.h * sprite_scale) / 2,
 							sprite.rect.w * sprite_scale,
 							sprite.rect.h * sprite_scale });
-					add_componentv(room->world, e, struct room_child, .parent = room);
+					scene_add(room->entities, e);
 					add_componentv(room->world, e, struct fall, .mul = 1.0);
 				} break;
 				default: break;
@@ -763,21 +799,14 @@ void update_room(struct room* room, f64 ts, f64 actual_ts) {
 		}
 	}
 
-	/* TODO: Make a separate system function for this. */
-	for (view(room->world, view, type_info(struct transform), type_info(struct fall))) {
-		struct transform* transform = view_get(&view, struct transform);
-		struct fall* fall = view_get(&view, struct fall);
-
-		fall->velocity.y += g_gravity * ts * fall->mul;
-
-		if (fall->velocity.y > g_max_gravity) {
-			fall->velocity.y = g_max_gravity;
-		}
+	view_for_each_parallel(room->world, fall_system, &ts, 1024, type_info(struct transform), type_info(struct fall));
 
-		transform->position = v2f_add(transform->position, v2f_mul(fall->velocity, make_v2f(ts, ts)));
-	}
+	/* TODO: Make a separate system function for this.
+	 *
+	 * Particles are spawned through the command buffer, since this is two
+	 * views deep, and applied once both views are done. */
+	struct ecs_commands* cmds = logic_store->commands;
 
-	/* TODO: As above, same here. */
 	for (view(room->world, view, type_info(struct lava))) {
 		struct lava* lava = view_get(&view, struct lava);
 
@@ -798,15 +827,24 @@ void update_room(struct room* room, f64 ts, f64 actual_ts) {
 
 				struct sprite sprite = get_sprite(sprid_lava_particle);
 
-				for (u32 i = 0; i < random_int(10, 20); i++) {
-					entity e = new_entity(room->world);
-					add_componentv(room->world, e, struct transform, .position = transform->position,
+				/* The particles' randomness is drawn all at once. */
+				struct rng* rng = thread_rng();
+
+				f32 vx[20], vy[20], rot[20];
+				const u32 count = (u32)rng_int(rng, 10, 20);
+				rng_fill_f32(rng, vx, count, -100.0f, 100.0f);
+				rng_fill_f32(rng, vy, count, -600.0f, -300.0f);
+				rng_fill_f32(rng, rot, count, -100.0f, 100.0f);
+
+				for (u32 i = 0; i < count; i++) {
+					entity e = cmd_new_entity(cmds);
+					cmd_add_componentv(cmds, e, struct transform, .position = transform->position,
 						.dimentions = { sprite.rect.w * sprite_scale, sprite.rect.h * sprite_scale });
-					add_component(room->world, e, struct sprite, sprite);
-					add_componentv(room->world, e, struct lava_particle,
-						.velocity = { random_f64(-100, 100), random_f64(-600, -300) },
+					cmd_add_component(cmds, e, struct sprite, sprite);
+					cmd_add_componentv(cmds, e, struct lava_particle,
+						.velocity = { vx[i], vy[i] },
 						.lifetime = 1.0,
-						.rotation_inc = random_f64(-100, 100));
+						.rotation_inc = rot[i]);
 				}
 
 				destroy_entity(room->world, view.e);
@@ -814,10 +852,11 @@ void update_room(struct room* room, f64 ts, f64 actual_ts) {
 		}
 	}
 
-	for (view(room->world, view, type_info(struct transform), type_info(struct lava_particle), type_info(struct sprite))) {
-		struct transform* transform = view_get(&view, struct transform);
-		struct lava_particle* particle = view_get(&view, struct lava_particle);
-		struct sprite* sprite = view_get(&view, struct sprite);
+	apply_ecs_commands(cmds, room->world);
+
+	for (group_view(logic_store->lava_particles, view)) {
+		struct transform* transform = group_view_get(&view, struct transform);
+		struct lava_particle* particle = group_view_get(&view, struct lava_particle);
 
 		particle->velocity.y += g_gravity * ts;
 
@@ -873,6 +912,12 @@ void update_room(struct room* room, f64 ts, f64 actual_ts) {
 				position->y = entrance_pos->y - collider.h;
 
 				logic_store->camera_position = *position;
+
+				/* So that it isn't drawn sliding over from where it left
+				 * the last room. */
+				if (has_component(room->world, body, struct interpolated)) {
+					get_component(room->world, body, struct interpolated)->valid = false;
+				}
 			} else {
 				fprintf(stderr, "Failed to locate entrance with name `%s'\n", entrance);
 			}
@@ -975,6 +1020,10 @@ bool handle_body_collisions(struct room* room, struct rect collider, v2f* positi
 	return collided;
 }
 
+struct scene* get_room_scene(struct room* room) {
+	return room->entities;
+}
+
 char* get_room_path(struct room* room) {
 	return room->path;
 }
@@ -1024,7 +1073,7 @@ void handle_body_interactions(struct room** room_ptr, struct rect collider, enti
 	}
 	
 	struct door* door = null;
-	if (body_on_ground && key_just_pressed(main_window, mapped_key("interact"))) {
+	if (body_on_ground && action_just_pressed("interact")) {
 		for (u32 i = 0; i < room->door_count; i++) {
 			struct rect rect = room->doors[i].rect;
 
@@ -1138,7 +1187,7 @@ struct path* get_path(struct room* room, const char* name) {
 
 entity new_save_point(struct world* world, struct room* room, struct rect rect) {
 	entity e = new_entity(world);
-	add_componentv(world, e, struct room_child, .parent = room);
+	scene_add(room->entities, e);
 	add_componentv(world, e, struct save_point, .rect = rect);
 
 	return e;
@@ -38,15 +38,12 @@ void dialogue_ask(const char* text, dialogue_ask_submit_func on_submit, void* ct
 struct player* get_player();
 
 char* get_room_path(struct room* room);
+struct scene* get_room_scene(struct room* room);
 
 v2i get_spawn(struct room* room);
 struct rect room_get_camera_bounds(struct room* room);
 struct path* get_path(struct room* room, const char* name);
 
-struct room_child {
-	struct room* parent;
-};
-
 struct save_point {
 	struct rect rect;
 };
@@ -14,7 +14,8 @@ enum {
 	texid_icon,
 	texid_arms,
 	texid_bad,
-	texid_back
+	texid_back,
+	texid_count
 };
 
 /* Sprite IDs  */
@@ -8,4 +8,5 @@ include "bootstrapper"
 include "util/packer"
 include "util/mksdk"
 include "util/test"
+include "util/bench"
 include "util/imuitest"
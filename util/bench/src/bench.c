@@ -0,0 +1,130 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "core.h"
+#include "platform.h"
+
+static struct {
+	struct bench_result* results;
+	u32 result_count;
+	u32 result_capacity;
+
+	u32 format;
+	const char* filter;
+} bench;
+
+void bench_init(u32 format, const char* filter) {
+	init_time();
+
+	bench.format = format;
+	bench.filter = filter;
+}
+
+void bench_deinit() {
+	if (bench.results) {
+		core_free(bench.results);
+	}
+}
+
+bool bench_enabled(const char* name) {
+	return !bench.filter || strstr(name, bench.filter);
+}
+
+u64 bench_now() {
+	return get_time();
+}
+
+f64 bench_seconds_since(u64 start) {
+	return (f64)(get_time() - start) / (f64)get_frequency();
+}
+
+void bench_report(u64 ops, f64 seconds, const char* name_fmt, ...) {
+	if (bench.result_count >= bench.result_capacity) {
+		bench.result_capacity = bench.result_capacity < 8 ? 8 : bench.result_capacity * 2;
+		bench.results = core_realloc(bench.results, bench.result_capacity * sizeof(struct bench_result));
+	}
+
+	struct bench_result* r = bench.results + bench.result_count++;
+
+	va_list args;
+	va_start(args, name_fmt);
+	vsnprintf(r->name, sizeof(r->name), name_fmt, args);
+	va_end(args);
+
+	r->ns_per_op = ops > 0 ? (seconds * 1e9) / (f64)ops : 0.0;
+	r->ops_per_sec = seconds > 0.0 ? (f64)ops / seconds : 0.0;
+
+	/* Progress goes to stderr, so that stdout is only the results. */
+	fprintf(stderr, "%-40s %12.2f ns/op\n", r->name, r->ns_per_op);
+}
+
+void bench_print() {
+	switch (bench.format) {
+		case bench_format_csv:
+			printf("name,ns_per_op,ops_per_sec\n");
+			for (u32 i = 0; i < bench.result_count; i++) {
+				struct bench_result* r = bench.results + i;
+				printf("%s,%.4f,%.1f\n", r->name, r->ns_per_op, r->ops_per_sec);
+			}
+			break;
+		case bench_format_json:
+			printf("[\n");
+			for (u32 i = 0; i < bench.result_count; i++) {
+				struct bench_result* r = bench.results + i;
+				printf("\t{ \"name\": \"%s\", \"ns_per_op\": %.4f, \"ops_per_sec\": %.1f }%s\n",
+					r->name, r->ns_per_op, r->ops_per_sec, i + 1 < bench.result_count ? "," : "");
+			}
+			printf("]\n");
+			break;
+		default:
+			printf("%-40s %14s %16s\n", "name", "ns/op", "ops/s");
+			for (u32 i = 0; i < bench.result_count; i++) {
+				struct bench_result* r = bench.results + i;
+				printf("%-40s %14.2f %16.0f\n", r->name, r->ns_per_op, r->ops_per_sec);
+			}
+			break;
+	}
+}
+
+i32 bench_compare(const char* baseline_path, f64 threshold) {
+	FILE* file = fopen(baseline_path, "r");
+	if (!file) {
+		fprintf(stderr, "Failed to open baseline `%s'.\n", baseline_path);
+		return -1;
+	}
+
+	i32 regressions = 0;
+
+	printf("\n%-40s %14s %14s %10s\n", "name", "baseline", "current", "change");
+
+	char line[256];
+	while (fgets(line, sizeof(line), file)) {
+		char name[64];
+		f64 ns_per_op;
+
+		/* Also skips the header. */
+		if (sscanf(line, "%63[^,],%lf", name, &ns_per_op) != 2) { continue; }
+
+		for (u32 i = 0; i < bench.result_count; i++) {
+			struct bench_result* r = bench.results + i;
+			if (strcmp(r->name, name) != 0) { continue; }
+
+			const f64 change = ns_per_op > 0.0 ? ((r->ns_per_op - ns_per_op) / ns_per_op) * 100.0 : 0.0;
+			const bool regressed = change > threshold;
+
+			printf("%-40s %14.2f %14.2f %9.1f%%%s\n", name, ns_per_op, r->ns_per_op, change,
+				regressed ? " REGRESSION" : "");
+
+			if (regressed) { regressions++; }
+			break;
+		}
+	}
+
+	fclose(file);
+
+	printf("\n%d regression(s) over %g%%.\n", regressions, threshold);
+
+	return regressions;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common.h"
+
+/* Benchmarks time themselves and report how many operations they did in how
+ * long, under a unique name. Results are printed as a table, or as CSV or
+ * JSON, and can be compared against the CSV from an earlier run. */
+
+enum {
+	bench_format_table = 0,
+	bench_format_csv,
+	bench_format_json
+};
+
+struct bench_result {
+	char name[64];
+	f64 ns_per_op;
+	f64 ops_per_sec;
+};
+
+void bench_init(u32 format, const char* filter);
+void bench_deinit();
+
+/* Whether the benchmark with the given name should run, per the filter. */
+bool bench_enabled(const char* name);
+
+u64 bench_now();
+f64 bench_seconds_since(u64 start);
+
+void bench_report(u64 ops, f64 seconds, const char* name_fmt, ...);
+
+/* Prints the results in the chosen format, to stdout. */
+void bench_print();
+
+/* Compares the results against a CSV file written by an earlier run.
+ * Anything more than `threshold' percent slower is a regression. Returns the
+ * number of regressions, or -1 if the file can't be read. */
+i32 bench_compare(const char* baseline_path, f64 threshold);
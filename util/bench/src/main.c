@@ -0,0 +1,1108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "common.h"
+#include "core.h"
+#include "entity.h"
+#include "jobs.h"
+#include "platform.h"
+#include "res.h"
+#include "rewind.h"
+#include "rng.h"
+#include "tiled.h"
+#include "video.h"
+
+/* Micro-benchmarks for the entity component system.
+ *
+ * Build in release mode to get meaningful numbers; Debug builds track
+ * every allocation.
+ *
+ * Usage: bench [-csv | -json] [-filter <text>] [-compare <baseline.csv> [-threshold <percent>]]
+ *
+ * To catch regressions, save the output of a run with `-csv' as the
+ * baseline, then run with `-compare' against it after a change. The exit
+ * code is the number of benchmarks that got slower by more than the
+ * threshold, which defaults to 10%. */
+
+struct bench_position { f32 x, y; };
+struct bench_velocity { f32 x, y; };
+struct bench_health { i32 hp; };
+struct bench_sprite { f32 x, y, w, h; };
+struct bench_transform { f32 x, y, w, h; i32 z; f32 rotation; };
+struct bench_fall { f32 mul, vx, vy; };
+
+struct bench_parent { void* parent; };
+
+struct bench_particle { f32 vx, vy, rotation, rotation_inc, lifetime; };
+
+#define bench_repeat 50
+
+static struct world* populate(u32 count) {
+	struct world* world = new_world();
+
+	for (u32 i = 0; i < count; i++) {
+		entity e = new_entity(world);
+		add_componentv(world, e, struct bench_position, .x = (f32)i, .y = 0.0f);
+
+		/* Only some entities match, so that views have something to skip. */
+		if (i % 2 == 0) {
+			add_componentv(world, e, struct bench_velocity, .x = 1.0f, .y = 2.0f);
+		}
+
+		if (i % 3 == 0) {
+			add_componentv(world, e, struct bench_health, .hp = 100);
+		}
+	}
+
+	return world;
+}
+
+static void bench_view_sparse(u32 count) {
+	struct world* world = populate(count);
+
+	u32 visited = 0;
+	u64 start = bench_now();
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		for (view(world, view, type_info(struct bench_position), type_info(struct bench_velocity))) {
+			struct bench_position* p = view_get(&view, struct bench_position);
+			struct bench_velocity* v = view_get(&view, struct bench_velocity);
+
+			p->x += v->x * 0.016f;
+			p->y += v->y * 0.016f;
+
+			visited++;
+		}
+	}
+
+	f64 t = bench_seconds_since(start);
+	bench_report(visited, t, "view_sparse/2/%u", count);
+
+	free_world(world);
+}
+
+static void bench_group_sparse(u32 count) {
+	struct world* world = populate(count);
+	struct group* group = get_group(world, type_info(struct bench_position), type_info(struct bench_velocity));
+
+	u32 visited = 0;
+	u64 start = bench_now();
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		for (group_view(group, view)) {
+			struct bench_position* p = group_view_get(&view, struct bench_position);
+			struct bench_velocity* v = group_view_get(&view, struct bench_velocity);
+
+			p->x += v->x * 0.016f;
+			p->y += v->y * 0.016f;
+
+			visited++;
+		}
+	}
+
+	f64 t = bench_seconds_since(start);
+	bench_report(visited, t, "group_sparse/2/%u", count);
+
+	free_world(world);
+}
+
+static void bench_get_component(u32 count) {
+	struct world* world = populate(count);
+
+	entity* entities = core_alloc(count * sizeof(entity));
+	u32 entity_count = 0;
+
+	for (view(world, view, type_info(struct bench_position))) {
+		entities[entity_count++] = view.e;
+	}
+
+	f32 sum = 0.0f;
+	u64 start = bench_now();
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		for (u32 i = 0; i < entity_count; i++) {
+			sum += get_component(world, entities[i], struct bench_position)->x;
+		}
+	}
+
+	f64 t = bench_seconds_since(start);
+	bench_report((u64)entity_count * bench_repeat, t, "get_component/%u", count);
+
+	/* So that the loop isn't optimised away. */
+	if (sum < 0.0f) { printf("%g\n", sum); }
+
+	core_free(entities);
+	free_world(world);
+}
+
+static void bench_spawn(u32 count) {
+	struct bench_position* positions = core_alloc(count * sizeof(struct bench_position));
+	struct bench_velocity* velocities = core_alloc(count * sizeof(struct bench_velocity));
+	struct bench_health* healths = core_alloc(count * sizeof(struct bench_health));
+	struct bench_sprite* sprites = core_alloc(count * sizeof(struct bench_sprite));
+	entity* entities = core_alloc(count * sizeof(entity));
+
+	for (u32 i = 0; i < count; i++) {
+		positions[i] = (struct bench_position) { (f32)i, 0.0f };
+		velocities[i] = (struct bench_velocity) { 1.0f, 2.0f };
+		healths[i] = (struct bench_health) { 100 };
+		sprites[i] = (struct bench_sprite) { 0.0f, 0.0f, 16.0f, 16.0f };
+	}
+
+	f64 single = 0.0, batch = 0.0;
+
+	/* Fresh worlds each time, since spawning into a world that has
+	 * already grown is a different (cheaper) thing to measure. */
+	for (u32 r = 0; r < bench_repeat; r++) {
+		struct world* world = new_world();
+		u64 start = bench_now();
+
+		for (u32 i = 0; i < count; i++) {
+			entity e = new_entity(world);
+			add_component(world, e, struct bench_position, positions[i]);
+			add_component(world, e, struct bench_velocity, velocities[i]);
+			add_component(world, e, struct bench_health, healths[i]);
+			add_component(world, e, struct bench_sprite, sprites[i]);
+		}
+
+		single += bench_seconds_since(start);
+		free_world(world);
+
+		world = new_world();
+		start = bench_now();
+
+		spawn_batch(world, count, 4,
+			(struct type_info[]) {
+				type_info(struct bench_position), type_info(struct bench_velocity),
+				type_info(struct bench_health), type_info(struct bench_sprite) },
+			(void*[]) { positions, velocities, healths, sprites }, entities);
+
+		batch += bench_seconds_since(start);
+		free_world(world);
+	}
+
+	bench_report((u64)count * bench_repeat, single, "spawn/4/%u", count);
+	bench_report((u64)count * bench_repeat, batch, "spawn_batch/4/%u", count);
+
+	core_free(positions);
+	core_free(velocities);
+	core_free(healths);
+	core_free(sprites);
+	core_free(entities);
+}
+
+static void bench_particle_step(struct view* view, void* udata) {
+	const f32 ts = *(f32*)udata;
+
+	struct bench_position* p = view_get(view, struct bench_position);
+	struct bench_particle* particle = view_get(view, struct bench_particle);
+
+	particle->vy += 1500.0f * ts;
+	p->x += particle->vx * ts;
+	p->y += particle->vy * ts;
+	particle->rotation += particle->rotation_inc * ts;
+	particle->lifetime -= ts;
+}
+
+static void bench_job_nothing(u32 begin, u32 end, void* udata) {
+	*(volatile u32*)udata = end;
+}
+
+/* What a call to `run_jobs' costs when there is next to nothing to do. */
+static void bench_job_dispatch(u32 calls) {
+	const u32 default_thread_count = get_job_thread_count();
+	const u32 thread_counts[] = { 2, 4, 8 };
+
+	volatile u32 sink = 0;
+
+	for (u32 i = 0; i < sizeof(thread_counts) / sizeof(*thread_counts); i++) {
+		set_job_thread_count(thread_counts[i]);
+
+		u64 start = bench_now();
+
+		for (u32 r = 0; r < calls; r++) {
+			run_jobs(thread_counts[i], 1, bench_job_nothing, (void*)&sink);
+		}
+
+		bench_report(calls, bench_seconds_since(start), "job_dispatch/threads_%u", thread_counts[i]);
+	}
+
+	set_job_thread_count(default_thread_count);
+}
+
+static void bench_parallel(u32 count) {
+	struct world* world = populate(count);
+
+	for (view(world, view, type_info(struct bench_position))) {
+		add_componentv(world, view.e, struct bench_particle,
+			.vx = 10.0f, .vy = -300.0f, .rotation_inc = 45.0f, .lifetime = 1.0f);
+	}
+
+	const u32 default_thread_count = get_job_thread_count();
+	const u32 thread_counts[] = { 1, 2, 4, 8 };
+
+	f32 ts = 0.016f;
+
+	for (u32 i = 0; i < sizeof(thread_counts) / sizeof(*thread_counts); i++) {
+		set_job_thread_count(thread_counts[i]);
+
+		u64 start = bench_now();
+
+		for (u32 r = 0; r < bench_repeat; r++) {
+			view_for_each_parallel(world, bench_particle_step, &ts, 4096,
+				type_info(struct bench_position), type_info(struct bench_particle));
+		}
+
+		bench_report((u64)count * bench_repeat, bench_seconds_since(start),
+			"parallel_view/%u/threads_%u", count, thread_counts[i]);
+	}
+
+	set_job_thread_count(default_thread_count);
+
+	free_world(world);
+}
+
+static struct world* populate_fall(u32 count, bool soa) {
+	struct world* world = new_world();
+
+	if (soa) {
+		set_component_soa(world, struct bench_transform,
+			component_field(struct bench_transform, x),
+			component_field(struct bench_transform, y),
+			component_field(struct bench_transform, w),
+			component_field(struct bench_transform, h),
+			component_field(struct bench_transform, z),
+			component_field(struct bench_transform, rotation));
+		set_component_soa(world, struct bench_fall,
+			component_field(struct bench_fall, mul),
+			component_field(struct bench_fall, vx),
+			component_field(struct bench_fall, vy));
+	}
+
+	get_group(world, type_info(struct bench_transform), type_info(struct bench_fall));
+
+	for (u32 i = 0; i < count; i++) {
+		entity e = new_entity(world);
+		add_componentv(world, e, struct bench_transform, .x = (f32)i, .w = 16.0f, .h = 16.0f);
+		add_componentv(world, e, struct bench_fall, .mul = 1.0f, .vx = 10.0f);
+	}
+
+	return world;
+}
+
+/* The same integration as the `fall' loop in `update_room'. */
+static void bench_fall_aos(u32 count) {
+	struct world* world = populate_fall(count, false);
+	struct group* group = get_group(world, type_info(struct bench_transform), type_info(struct bench_fall));
+
+	const f32 ts = 0.016f;
+
+	u64 start = bench_now();
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		for (group_view(group, view)) {
+			struct bench_transform* t = group_view_get(&view, struct bench_transform);
+			struct bench_fall* f = group_view_get(&view, struct bench_fall);
+
+			f->vy += 1500.0f * ts * f->mul;
+			if (f->vy > 800.0f) { f->vy = 800.0f; }
+
+			t->x += f->vx * ts;
+			t->y += f->vy * ts;
+		}
+	}
+
+	f64 t = bench_seconds_since(start);
+	bench_report((u64)count * bench_repeat, t, "fall_aos/%u", count);
+
+	free_world(world);
+}
+
+/* As above, but over the component arrays, to separate the cost of
+ * `group_view_get' from that of the layout. */
+static void bench_fall_aos_array(u32 count) {
+	struct world* world = populate_fall(count, false);
+	struct group* group = get_group(world, type_info(struct bench_transform), type_info(struct bench_fall));
+
+	const f32 ts = 0.016f;
+
+	u64 start = bench_now();
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		const u32 size = get_group_size(group);
+
+		for (u32 i = 0; i < size;) {
+			u32 c0, c1;
+			struct bench_transform* restrict t = get_component_array(world, struct bench_transform, i, &c0);
+			struct bench_fall* restrict f = get_component_array(world, struct bench_fall, i, &c1);
+
+			const u32 n = minimum(c0, c1);
+
+			for (u32 ii = 0; ii < n; ii++) {
+				f32 v = f[ii].vy + 1500.0f * ts * f[ii].mul;
+				v = v > 800.0f ? 800.0f : v;
+				f[ii].vy = v;
+
+				t[ii].x += f[ii].vx * ts;
+				t[ii].y += v * ts;
+			}
+
+			i += n;
+		}
+	}
+
+	f64 t = bench_seconds_since(start);
+	bench_report((u64)count * bench_repeat, t, "fall_aos_array/%u", count);
+
+	free_world(world);
+}
+
+static void bench_fall_soa(u32 count) {
+	struct world* world = populate_fall(count, true);
+	struct group* group = get_group(world, type_info(struct bench_transform), type_info(struct bench_fall));
+
+	const f32 ts = 0.016f;
+
+	u64 start = bench_now();
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		const u32 size = get_group_size(group);
+
+		for (u32 i = 0; i < size;) {
+			u32 c[5];
+			f32* restrict x   = get_component_field_array(world, struct bench_transform, 0, i, c + 0);
+			f32* restrict y   = get_component_field_array(world, struct bench_transform, 1, i, c + 1);
+			f32* restrict mul = get_component_field_array(world, struct bench_fall, 0, i, c + 2);
+			f32* restrict vx  = get_component_field_array(world, struct bench_fall, 1, i, c + 3);
+			f32* restrict vy  = get_component_field_array(world, struct bench_fall, 2, i, c + 4);
+
+			u32 n = c[0];
+			for (u32 ii = 1; ii < 5; ii++) { n = minimum(n, c[ii]); }
+
+			for (u32 ii = 0; ii < n; ii++) {
+				f32 v = vy[ii] + 1500.0f * ts * mul[ii];
+				v = v > 800.0f ? 800.0f : v;
+				vy[ii] = v;
+
+				x[ii] += vx[ii] * ts;
+				y[ii] += v * ts;
+			}
+
+			i += n;
+		}
+	}
+
+	f64 t = bench_seconds_since(start);
+	bench_report((u64)count * bench_repeat, t, "fall_soa/%u", count);
+
+	free_world(world);
+}
+
+static void bench_churn(u32 count) {
+	struct world* world = new_world();
+
+	entity* entities = core_alloc(count * sizeof(entity));
+
+	u64 start = bench_now();
+
+	/* IDs are recycled after the first round. */
+	for (u32 r = 0; r < bench_repeat; r++) {
+		for (u32 i = 0; i < count; i++) {
+			entities[i] = new_entity(world);
+		}
+
+		for (u32 i = 0; i < count; i++) {
+			destroy_entity(world, entities[i]);
+		}
+	}
+
+	bench_report((u64)count * bench_repeat, bench_seconds_since(start), "entity_churn/%u", count);
+
+	core_free(entities);
+	free_world(world);
+}
+
+static void bench_add_remove(u32 count) {
+	struct world* world = new_world();
+
+	entity* entities = core_alloc(count * sizeof(entity));
+	for (u32 i = 0; i < count; i++) {
+		entities[i] = new_entity(world);
+	}
+
+	f64 add = 0.0, remove = 0.0;
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		u64 start = bench_now();
+
+		for (u32 i = 0; i < count; i++) {
+			add_componentv(world, entities[i], struct bench_position, .x = (f32)i);
+		}
+
+		add += bench_seconds_since(start);
+		start = bench_now();
+
+		for (u32 i = 0; i < count; i++) {
+			remove_component(world, entities[i], struct bench_position);
+		}
+
+		remove += bench_seconds_since(start);
+	}
+
+	bench_report((u64)count * bench_repeat, add, "add_component/%u", count);
+	bench_report((u64)count * bench_repeat, remove, "remove_component/%u", count);
+
+	core_free(entities);
+	free_world(world);
+}
+
+static struct world* populate_full(u32 count) {
+	struct world* world = new_world();
+
+	for (u32 i = 0; i < count; i++) {
+		entity e = new_entity(world);
+		add_componentv(world, e, struct bench_position, .x = (f32)i);
+		add_componentv(world, e, struct bench_velocity, .x = 1.0f, .y = 2.0f);
+		add_componentv(world, e, struct bench_health, .hp = 100);
+		add_componentv(world, e, struct bench_sprite, .w = 16.0f, .h = 16.0f);
+	}
+
+	return world;
+}
+
+/* Views over 1 to 4 of the components, where every entity has all of them. */
+static void bench_views(u32 count) {
+	struct world* world = populate_full(count);
+
+	f32 sum = 0.0f;
+
+	for (u32 k = 1; k <= 4; k++) {
+		u32 visited = 0;
+		u64 start = bench_now();
+
+		for (u32 r = 0; r < bench_repeat; r++) {
+			switch (k) {
+				case 1:
+					for (view(world, view, type_info(struct bench_position))) {
+						sum += view_get(&view, struct bench_position)->x;
+						visited++;
+					}
+					break;
+				case 2:
+					for (view(world, view, type_info(struct bench_position), type_info(struct bench_velocity))) {
+						sum += view_get(&view, struct bench_position)->x + view_get(&view, struct bench_velocity)->x;
+						visited++;
+					}
+					break;
+				case 3:
+					for (view(world, view, type_info(struct bench_position), type_info(struct bench_velocity),
+						type_info(struct bench_health))) {
+						sum += view_get(&view, struct bench_position)->x + view_get(&view, struct bench_velocity)->x +
+							(f32)view_get(&view, struct bench_health)->hp;
+						visited++;
+					}
+					break;
+				case 4:
+					for (view(world, view, type_info(struct bench_position), type_info(struct bench_velocity),
+						type_info(struct bench_health), type_info(struct bench_sprite))) {
+						sum += view_get(&view, struct bench_position)->x + view_get(&view, struct bench_velocity)->x +
+							(f32)view_get(&view, struct bench_health)->hp + view_get(&view, struct bench_sprite)->w;
+						visited++;
+					}
+					break;
+			}
+		}
+
+		bench_report(visited, bench_seconds_since(start), "view/%u/%u", k, count);
+	}
+
+	if (sum < 0.0f) { printf("%g\n", sum); }
+
+	free_world(world);
+}
+
+/* Destroys every other entity from inside of a view over them. */
+static void bench_destroy_iterating(u32 count) {
+	f64 t = 0.0;
+	u64 destroyed = 0;
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		struct world* world = new_world();
+
+		for (u32 i = 0; i < count; i++) {
+			add_componentv(world, new_entity(world), struct bench_position, .x = (f32)i);
+		}
+
+		u64 start = bench_now();
+
+		for (view(world, view, type_info(struct bench_position))) {
+			if (get_entity_id(view.e) % 2 == 0) {
+				destroy_entity(world, view.e);
+				destroyed++;
+			}
+		}
+
+		t += bench_seconds_since(start);
+
+		free_world(world);
+	}
+
+	bench_report(destroyed, t, "destroy_while_iterating/%u", count);
+}
+
+/* Tears down a room of 500 entities in a world of `count' others that
+ * belong to other parents, by scanning a view over a parent component as
+ * `free_room' used to, and by clearing a scene. */
+static void bench_room_teardown(u32 count) {
+	const u32 room_size = 500;
+
+	f64 t_view = 0.0, t_scene = 0.0;
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		struct world* world = populate(count);
+		struct scene* scene = new_scene(world, "room");
+
+		for (view(world, view, type_info(struct bench_position))) {
+			add_componentv(world, view.e, struct bench_parent, .parent = null);
+		}
+
+		for (u32 i = 0; i < room_size; i++) {
+			entity a = new_entity(world);
+			add_componentv(world, a, struct bench_position, .x = (f32)i);
+			add_componentv(world, a, struct bench_parent, .parent = scene);
+
+			entity b = new_entity(world);
+			add_componentv(world, b, struct bench_position, .x = (f32)i);
+			scene_add(scene, b);
+		}
+
+		u64 start = bench_now();
+
+		for (view(world, view, type_info(struct bench_parent))) {
+			if (view_get(&view, struct bench_parent)->parent == scene) {
+				destroy_entity(world, view.e);
+			}
+		}
+
+		t_view += bench_seconds_since(start);
+
+		start = bench_now();
+		clear_scene(scene);
+		t_scene += bench_seconds_since(start);
+
+		free_scene(scene);
+		free_world(world);
+	}
+
+	bench_report((u64)room_size * bench_repeat, t_view,  "room_teardown_view/%u", count);
+	bench_report((u64)room_size * bench_repeat, t_scene, "room_teardown_scene/%u", count);
+}
+
+/* Takes a snapshot of a whole world and reads it back. Each op is one
+ * snapshot, so ns/op is the time for the whole world. */
+static void bench_snapshot(u32 count) {
+	struct world* world = populate_full(count);
+
+	u64 size = 0;
+	f64 t_write = 0.0, t_read = 0.0;
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		u64 start = bench_now();
+		void* snapshot = world_snapshot_write(world, &size);
+		t_write += bench_seconds_since(start);
+
+		start = bench_now();
+		world_snapshot_read(world, snapshot, size);
+		t_read += bench_seconds_since(start);
+
+		core_free(snapshot);
+	}
+
+	free_world(world);
+
+	bench_report(bench_repeat, t_write, "snapshot_write/%u", count);
+	bench_report(bench_repeat, t_read,  "snapshot_read/%u", count);
+}
+
+/* Captures a frame after moving 1% of the entities, as a game would every
+ * frame, then seeks back through every frame that was kept. */
+static void bench_rewind(u32 count) {
+	struct world* world = populate_full(count);
+	struct rewind* rewind = new_rewind(world, 64 * 1024 * 1024, 1);
+
+	u64 start = bench_now();
+
+	for (u32 r = 0; r < bench_repeat; r++) {
+		u32 i = 0;
+		for (view(world, view, type_info(struct bench_position))) {
+			if (i++ % 100 == r) {
+				view_get(&view, struct bench_position)->x += 1.0f;
+			}
+		}
+
+		rewind_capture(rewind);
+	}
+
+	bench_report(bench_repeat, bench_seconds_since(start), "rewind_capture/%u", count);
+
+	const u32 frames = get_rewind_stats(rewind).frame_count;
+
+	start = bench_now();
+
+	for (u32 back = 0; back < frames; back++) {
+		rewind_seek(rewind, back);
+	}
+
+	bench_report(frames, bench_seconds_since(start), "rewind_seek/%u", count);
+
+	free_rewind(rewind);
+	free_world(world);
+}
+
+/* What `random_f64' used to be, for comparison. */
+static f64 libc_random_f64(f64 min, f64 max) {
+	f64 scale = rand() / (f64)RAND_MAX;
+	return min + scale * (max - min);
+}
+
+/* Draws `count' numbers from a range each way; The sums are only there so
+ * that the numbers can't be thrown away. */
+static void bench_random(u32 count) {
+	f32* out = core_alloc(count * sizeof(f32));
+	f64 sum = 0.0;
+
+	u64 start = bench_now();
+	for (u32 i = 0; i < count; i++) {
+		sum += libc_random_f64(-100.0, 100.0);
+	}
+	bench_report(count, bench_seconds_since(start), "random_libc_rand/%u", count);
+
+	start = bench_now();
+	for (u32 i = 0; i < count; i++) {
+		sum += random_f64(-100.0, 100.0);
+	}
+	bench_report(count, bench_seconds_since(start), "random_f64/%u", count);
+
+	struct rng rng;
+	rng_seed(&rng, 1);
+
+	start = bench_now();
+	for (u32 i = 0; i < count; i++) {
+		sum += rng_f64(&rng, -100.0, 100.0);
+	}
+	bench_report(count, bench_seconds_since(start), "rng_f64/%u", count);
+
+	start = bench_now();
+	for (u32 i = 0; i < count; i++) {
+		sum += rng_int(&rng, 10, 20);
+	}
+	bench_report(count, bench_seconds_since(start), "rng_int/%u", count);
+
+	start = bench_now();
+	rng_fill_f32(&rng, out, count, -100.0f, 100.0f);
+	bench_report(count, bench_seconds_since(start), "rng_fill_f32/%u", count);
+
+	for (u32 i = 0; i < count; i += 4096) {
+		sum += out[i];
+	}
+
+	if (sum == 0.0) {
+		fprintf(stderr, "Unlikely sum.\n");
+	}
+
+	core_free(out);
+}
+
+/* Compares looking files up in a package the way the game used to, opening it
+ * and scanning the header for each read, with the mapped, sorted index. */
+#define bench_package_file_size 4096
+
+static i32 u64_cmp(const void* a, const void* b) {
+	const u64 x = *(const u64*)a;
+	const u64 y = *(const u64*)b;
+	return (x > y) - (x < y);
+}
+
+static void bench_package(u32 count) {
+	const char* path = "bench_package.pck";
+
+	char name[64];
+	u8* data = core_calloc(1, bench_package_file_size);
+
+	u64* hashes = core_alloc(count * sizeof(u64));
+	for (u32 i = 0; i < count; i++) {
+		sprintf(name, "res/bench/%u.dat", i);
+		hashes[i] = elf_hash((const u8*)name, (u32)strlen(name));
+	}
+
+	qsort(hashes, count, sizeof(u64), u64_cmp);
+
+	FILE* out = fopen(path, "wb");
+	if (!out) {
+		fprintf(stderr, "Failed to open `%s' for writing.\n", path);
+		core_free(hashes);
+		core_free(data);
+		return;
+	}
+
+	const u64 header_size = count * (sizeof(u64) * 3) + sizeof(u64);
+	fwrite(&header_size, sizeof(header_size), 1, out);
+	for (u32 i = 0; i < count; i++) {
+		const u64 offset = header_size + (u64)i * bench_package_file_size;
+		const u64 size = bench_package_file_size;
+
+		fwrite(hashes + i, sizeof(u64), 1, out);
+		fwrite(&offset, sizeof(offset), 1, out);
+		fwrite(&size, sizeof(size), 1, out);
+	}
+
+	for (u32 i = 0; i < count; i++) {
+		fwrite(data, bench_package_file_size, 1, out);
+	}
+
+	fclose(out);
+
+	u64 found = 0;
+
+	u64 start = bench_now();
+	for (u32 i = 0; i < count; i++) {
+		sprintf(name, "res/bench/%u.dat", i);
+		const u64 hash = elf_hash((const u8*)name, (u32)strlen(name));
+
+		FILE* file = fopen(path, "rb");
+
+		u64 header;
+		fread(&header, sizeof(header), 1, file);
+
+		for (u64 ii = 0; ii < (header - sizeof(header)) / (sizeof(u64) * 3); ii++) {
+			u64 entry[3];
+			fread(entry, sizeof(u64), 3, file);
+
+			if (entry[0] == hash) {
+				fseek(file, (long)entry[1], SEEK_SET);
+				found += fread(data, 1, entry[2], file);
+				break;
+			}
+		}
+
+		fclose(file);
+	}
+	bench_report(count, bench_seconds_since(start), "package_legacy_read/%u", count);
+
+	start = bench_now();
+	struct package* package = open_package(path);
+	bench_report(1, bench_seconds_since(start), "package_open/%u", count);
+
+	if (package) {
+		start = bench_now();
+		for (u32 i = 0; i < count; i++) {
+			sprintf(name, "res/bench/%u.dat", i);
+
+			const u8* view;
+			u64 size;
+			if (package_find(package, name, &view, &size)) {
+				memcpy(data, view, size);
+				found += size;
+			}
+		}
+		bench_report(count, bench_seconds_since(start), "package_read/%u", count);
+
+		close_package(package);
+	}
+
+	if (found != (u64)count * bench_package_file_size * 2) {
+		fprintf(stderr, "Package lookups failed.\n");
+	}
+
+	remove(path);
+
+	core_free(hashes);
+	core_free(data);
+}
+
+static void find_maps(const char* dir_name, char*** paths, u32* count, u32* capacity) {
+	struct dir_iter* it = new_dir_iter(dir_name);
+	if (!it) { return; }
+
+	do {
+		struct dir_entry* entry = dir_iter_cur(it);
+
+		if (file_is_dir(entry->name)) {
+			find_maps(entry->name, paths, count, capacity);
+		} else if (file_is_regular(entry->name) && strcmp(get_file_extension(entry->name), "dat") == 0) {
+			if (*count >= *capacity) {
+				*capacity = *capacity < 8 ? 8 : *capacity * 2;
+				*paths = core_realloc(*paths, *capacity * sizeof(char*));
+			}
+
+			(*paths)[(*count)++] = copy_string(entry->name);
+		}
+	} while (dir_iter_next(it));
+
+	free_dir_iter(it);
+}
+
+/* Loads every map under `res/maps', so it must be run from the root of the
+ * repository. Tilesets are loaded once before the clock starts, so that
+ * decoding their images isn't counted. */
+static void bench_load_maps(u32 iterations) {
+	char** paths = null;
+	u32 count = 0, capacity = 0;
+	find_maps("res/maps", &paths, &count, &capacity);
+
+	if (count == 0) {
+		fprintf(stderr, "No maps found; Run from the root of the repository.\n");
+		return;
+	}
+
+	video_init_headless();
+	res_init();
+
+	u64 bytes = 0;
+	for (u32 i = 0; i < count; i++) {
+		struct file file = file_open(paths[i]);
+		bytes += file.size;
+		file_close(&file);
+
+		free_map(load_map(paths[i]));
+	}
+
+	u64 start = bench_now();
+	for (u32 i = 0; i < iterations; i++) {
+		for (u32 ii = 0; ii < count; ii++) {
+			free_map(load_map(paths[ii]));
+		}
+	}
+	const f64 seconds = bench_seconds_since(start);
+
+	bench_report((u64)iterations * count, seconds, "load_map/%u", count);
+	fprintf(stderr, "%-40s %12.2f MB/s\n", "load_map", ((f64)bytes * iterations / 1000000.0) / seconds);
+
+	res_deinit();
+
+	for (u32 i = 0; i < count; i++) {
+		core_free(paths[i]);
+	}
+	core_free(paths);
+}
+
+/* Pushes `count' sprites from a handful of textures, and as many lights as
+ * there can be, each frame. Video is headless, so this is the time spent on
+ * the CPU side of batching and flushing. */
+static void bench_render(u32 count, u32 batch_size) {
+	const u32 frames = 100;
+
+	video_init_headless();
+
+	struct texture textures[4];
+	for (u32 i = 0; i < 4; i++) {
+		textures[i] = (struct texture) { 0, 256, 256 };
+	}
+
+	struct renderer* renderer = new_renderer_ex((struct shader) { 0 }, make_v2i(1366, 768), batch_size);
+
+	u32 draw_calls = 0;
+	f64 flush_time = 0.0;
+
+	u64 start = bench_now();
+	for (u32 f = 0; f < frames; f++) {
+		for (u32 i = 0; i < max_lights; i++) {
+			renderer_push_light(renderer, (struct light) { { (f32)i * 10.0f, 100.0f }, 100.0f, 1.0f });
+		}
+
+		for (u32 i = 0; i < count; i++) {
+			struct textured_quad quad = {
+				.texture = textures + (i * 4 / count),
+				.position = { (i32)(i % 1366), (i32)((i / 1366) * 16) },
+				.dimentions = { 16, 16 },
+				.rect = { (i32)(i % 16) * 16, 0, 16, 16 },
+				.color = { 255, 255, 255, 255 }
+			};
+
+			renderer_push(renderer, &quad);
+		}
+
+		renderer_end_frame(renderer);
+
+		struct renderer_stats stats = get_renderer_stats(renderer);
+		draw_calls += stats.draw_calls;
+		flush_time += stats.flush_time;
+	}
+	const f64 seconds = bench_seconds_since(start);
+
+	bench_report(frames, seconds, "render_frame/%u/batch_%u", count, batch_size);
+	bench_report(frames, flush_time, "render_flush/%u/batch_%u", count, batch_size);
+	fprintf(stderr, "%-40s %12u draw calls/frame\n", "render_frame", draw_calls / frames);
+
+	free_renderer(renderer);
+}
+
+/* Sprites from more sheets than there are texture slots, interleaved, with
+ * and without the sheets in a texture array. */
+static void bench_texture_array(u32 count, u32 texture_count, bool use_array) {
+	const u32 frames = 100;
+
+	video_init_headless();
+
+	struct texture_array array;
+	init_texture_array(&array, 512, 512, texture_count, sprite_texture);
+
+	struct texture* textures = core_calloc(texture_count, sizeof(struct texture));
+	for (u32 i = 0; i < texture_count; i++) {
+		textures[i] = (struct texture) { 0, 64 + (i % 4) * 64, 128 };
+
+		if (use_array) {
+			texture_array_add(&array, textures + i);
+		}
+	}
+
+	struct renderer* renderer = new_renderer_ex((struct shader) { 0 }, make_v2i(1366, 768), default_batch_size);
+	renderer->texture_array = &array;
+
+	u32 draw_calls = 0;
+
+	u64 start = bench_now();
+	for (u32 f = 0; f < frames; f++) {
+		for (u32 i = 0; i < count; i++) {
+			struct textured_quad quad = {
+				.texture = textures + (i % texture_count),
+				.position = { (i32)(i % 1366), (i32)((i / 1366) * 16) },
+				.dimentions = { 16, 16 },
+				.rect = { 0, 0, 16, 16 },
+				.color = { 255, 255, 255, 255 }
+			};
+
+			renderer_push(renderer, &quad);
+		}
+
+		renderer_end_frame(renderer);
+
+		draw_calls += get_renderer_stats(renderer).draw_calls;
+	}
+	const f64 seconds = bench_seconds_since(start);
+
+	bench_report(frames, seconds, "render_textures/%u/%u/%s", count, texture_count, use_array ? "array" : "slots");
+	fprintf(stderr, "%-40s %12u draw calls/frame\n", "render_textures", draw_calls / frames);
+
+	free_renderer(renderer);
+	core_free(textures);
+	deinit_texture_array(&array);
+}
+
+static void bench_push(u32 count) {
+	video_init_headless();
+
+	struct texture texture = { 0, 256, 256 };
+
+	struct renderer* renderer = new_renderer_ex((struct shader) { 0 }, make_v2i(1366, 768), default_batch_size);
+
+	struct textured_quad* quads = core_alloc(count * sizeof(struct textured_quad));
+	for (u32 i = 0; i < count; i++) {
+		quads[i] = (struct textured_quad) {
+			.texture = &texture,
+			.position = { (i32)(i % 1366), (i32)((i / 1366) * 16) },
+			.dimentions = { 16, 16 },
+			.rect = { (i32)(i % 16) * 16, 0, 16, 16 },
+			.color = { 255, 255, 255, 255 },
+			.origin = { 0.5f, 0.5f }
+		};
+	}
+
+	/* Once to fault in the batch. */
+	renderer_push_n(renderer, quads, count);
+	renderer_end_frame(renderer);
+
+	u64 start = bench_now();
+	for (u32 i = 0; i < count; i++) {
+		renderer_push(renderer, quads + i);
+	}
+	bench_report(count, bench_seconds_since(start), "renderer_push/%u", count);
+	renderer_end_frame(renderer);
+
+	start = bench_now();
+	renderer_push_n(renderer, quads, count);
+	bench_report(count, bench_seconds_since(start), "renderer_push_n/%u", count);
+	renderer_end_frame(renderer);
+
+	for (u32 i = 0; i < count; i++) {
+		quads[i].rotation = (f32)(i % 360);
+	}
+
+	start = bench_now();
+	for (u32 i = 0; i < count; i++) {
+		renderer_push(renderer, quads + i);
+	}
+	bench_report(count, bench_seconds_since(start), "renderer_push_rotated/%u", count);
+	renderer_end_frame(renderer);
+
+	core_free(quads);
+	free_renderer(renderer);
+}
+
+i32 main(i32 argc, const char** argv) {
+	u32 format = bench_format_table;
+	const char* filter = null;
+	const char* baseline = null;
+	f64 threshold = 10.0;
+
+	for (i32 i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-csv") == 0) {
+			format = bench_format_csv;
+		} else if (strcmp(argv[i], "-json") == 0) {
+			format = bench_format_json;
+		} else if (strcmp(argv[i], "-filter") == 0 && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (strcmp(argv[i], "-compare") == 0 && i + 1 < argc) {
+			baseline = argv[++i];
+		} else if (strcmp(argv[i], "-threshold") == 0 && i + 1 < argc) {
+			threshold = atof(argv[++i]);
+		} else {
+			fprintf(stderr, "Unknown argument `%s'.\n", argv[i]);
+			return -1;
+		}
+	}
+
+	bench_init(format, filter);
+
+	const u32 counts[] = { 1000, 10000, 100000 };
+
+	for (u32 i = 0; i < sizeof(counts) / sizeof(*counts); i++) {
+		if (bench_enabled("view"))                    { bench_views(counts[i]); }
+		if (bench_enabled("view_sparse"))             { bench_view_sparse(counts[i]); }
+		if (bench_enabled("group_sparse"))            { bench_group_sparse(counts[i]); }
+		if (bench_enabled("entity_churn"))            { bench_churn(counts[i]); }
+		if (bench_enabled("add_component") || bench_enabled("remove_component")) { bench_add_remove(counts[i]); }
+		if (bench_enabled("get_component"))           { bench_get_component(counts[i]); }
+		if (bench_enabled("destroy_while_iterating")) { bench_destroy_iterating(counts[i]); }
+		if (bench_enabled("room_teardown"))           { bench_room_teardown(counts[i]); }
+	}
+
+	if (bench_enabled("spawn"))          { bench_spawn(50000); }
+	if (bench_enabled("parallel_view"))  { bench_parallel(100000); }
+	if (bench_enabled("job_dispatch"))   { bench_job_dispatch(2000); }
+	if (bench_enabled("fall_aos"))       { bench_fall_aos(100000); bench_fall_aos_array(100000); }
+	if (bench_enabled("fall_soa"))       { bench_fall_soa(100000); }
+	if (bench_enabled("snapshot"))       { bench_snapshot(50000); }
+	if (bench_enabled("rewind"))         { bench_rewind(10000); }
+	if (bench_enabled("random") || bench_enabled("rng")) { bench_random(1000000); }
+	if (bench_enabled("package"))        { bench_package(1000); }
+	if (bench_enabled("load_map"))       { bench_load_maps(100); }
+	if (bench_enabled("renderer_push"))  { bench_push(100000); }
+	if (bench_enabled("render_textures")) { bench_texture_array(10000, 40, false); bench_texture_array(10000, 40, true); }
+	if (bench_enabled("render"))         { bench_render(10000, 100); bench_render(10000, default_batch_size); }
+
+	deinit_jobs();
+
+	bench_print();
+
+	i32 r = 0;
+	if (baseline) {
+		r = bench_compare(baseline, threshold);
+	}
+
+	bench_deinit();
+
+	return r;
+}
@@ -10,6 +10,7 @@ project "packer"
 	staticruntime "on"
 
 	files {
+		"src/atlas.c",
 		"src/packer.c",
 	}
 
@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atlas.h"
+#include "core.h"
+#include "res.h"
+
+/* Not all of stb_rect_pack's static functions are used. */
+#if defined(__GNUC__)
+	#pragma GCC diagnostic push
+	#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "util/stb_rect_pack.h"
+
+#if defined(__GNUC__)
+	#pragma GCC diagnostic pop
+#endif
+
+/* Left on the right and bottom of each sheet, so that filtering at the edge
+ * of a sheet never picks up its neighbours. */
+#define sheet_padding 1
+
+#pragma pack(push, 1)
+struct bmp_file_header {
+	u16 ftype;
+	u32 fsize;
+	u16 res1, res2;
+	u32 bmp_offset;
+};
+
+struct bmp_info_header {
+	u32 size;
+	i32 w, h;
+	u16 planes;
+	u16 bits_per_pixel;
+	u32 compression;
+	u32 image_size;
+	i32 x_ppm, y_ppm;
+	u32 colors_used;
+	u32 colors_important;
+};
+#pragma pack(pop)
+
+bool atlas_add_sheet(struct atlas* atlas, const char* path) {
+	u8* raw;
+	u64 raw_size;
+	if (!read_raw_no_pck(path, &raw, &raw_size, false)) {
+		return false;
+	}
+
+	const struct bmp_file_header* file_header = (const struct bmp_file_header*)raw;
+	const struct bmp_info_header* info_header = (const struct bmp_info_header*)(raw + sizeof(struct bmp_file_header));
+
+	/* Only bottom-up bitmaps are read by the game. */
+	if (raw_size < sizeof(struct bmp_file_header) + sizeof(struct bmp_info_header) ||
+		raw[0] != 'B' || raw[1] != 'M' ||
+		info_header->bits_per_pixel != 32 || info_header->w <= 0 || info_header->h <= 0 ||
+		file_header->bmp_offset + (u64)info_header->w * (u64)info_header->h * 4 > raw_size) {
+		core_free(raw);
+		return false;
+	}
+
+	if (atlas->sheet_count >= atlas->sheet_capacity) {
+		atlas->sheet_capacity = atlas->sheet_capacity < 8 ? 8 : atlas->sheet_capacity * 2;
+		atlas->sheets = core_realloc(atlas->sheets, atlas->sheet_capacity * sizeof(struct atlas_sheet));
+	}
+
+	struct atlas_sheet* sheet = atlas->sheets + atlas->sheet_count++;
+	memset(sheet, 0, sizeof(struct atlas_sheet));
+
+	sheet->path = path;
+	sheet->width = (u32)info_header->w;
+	sheet->height = (u32)info_header->h;
+	sheet->pixels = core_alloc(sheet->width * sheet->height * 4);
+
+	const u8* src = raw + file_header->bmp_offset;
+	const u32 stride = sheet->width * 4;
+	for (u32 y = 0; y < sheet->height; y++) {
+		memcpy(sheet->pixels + y * stride, src + (sheet->height - y - 1) * stride, stride);
+	}
+
+	core_free(raw);
+
+	return true;
+}
+
+void atlas_pack(struct atlas* atlas, u32 page_size) {
+	atlas->page_size = page_size;
+	atlas->page_count = 0;
+
+	stbrp_rect* rects = core_alloc(atlas->sheet_count * sizeof(stbrp_rect));
+	stbrp_node* nodes = core_alloc(page_size * sizeof(stbrp_node));
+
+	for (u32 i = 0; i < atlas->sheet_count; i++) {
+		rects[i] = (stbrp_rect) {
+			.id = (i32)i,
+			.w = (stbrp_coord)(atlas->sheets[i].width + sheet_padding),
+			.h = (stbrp_coord)(atlas->sheets[i].height + sheet_padding)
+		};
+	}
+
+	/* Fill one page at a time, until nothing more will fit on an
+	 * empty page. */
+	u32 remaining = atlas->sheet_count;
+	while (remaining > 0) {
+		stbrp_context context;
+		stbrp_init_target(&context, (i32)page_size, (i32)page_size, nodes, (i32)page_size);
+		stbrp_pack_rects(&context, rects, (i32)remaining);
+
+		u32 left = 0;
+		for (u32 i = 0; i < remaining; i++) {
+			if (!rects[i].was_packed) {
+				rects[left++] = rects[i];
+				continue;
+			}
+
+			struct atlas_sheet* sheet = atlas->sheets + rects[i].id;
+
+			sheet->packed = true;
+			sheet->page = atlas->page_count;
+			sheet->x = (u32)rects[i].x;
+			sheet->y = (u32)rects[i].y;
+		}
+
+		if (left == remaining) { break; }
+
+		atlas->page_count++;
+		remaining = left;
+	}
+
+	core_free(nodes);
+	core_free(rects);
+}
+
+bool atlas_packed(const struct atlas* atlas, const char* path) {
+	for (u32 i = 0; i < atlas->sheet_count; i++) {
+		if (strcmp(atlas->sheets[i].path, path) == 0) {
+			return atlas->sheets[i].packed;
+		}
+	}
+
+	return false;
+}
+
+/* Written uncompressed, with the fourth byte of each pixel being alpha, as
+ * the game reads it for every 32-bit bitmap. */
+u8* atlas_make_page(const struct atlas* atlas, u32 page, u64* size) {
+	const u32 page_size = atlas->page_size;
+	const u32 stride = page_size * 4;
+	const u32 offset = sizeof(struct bmp_file_header) + sizeof(struct bmp_info_header);
+
+	*size = offset + (u64)stride * page_size;
+
+	u8* data = core_calloc(1, *size);
+
+	struct bmp_file_header file_header = {
+		.ftype = 'B' | ('M' << 8),
+		.fsize = (u32)*size,
+		.bmp_offset = offset
+	};
+
+	struct bmp_info_header info_header = {
+		.size = sizeof(struct bmp_info_header),
+		.w = (i32)page_size,
+		.h = (i32)page_size,
+		.planes = 1,
+		.bits_per_pixel = 32,
+		.image_size = stride * page_size
+	};
+
+	memcpy(data, &file_header, sizeof(file_header));
+	memcpy(data + sizeof(file_header), &info_header, sizeof(info_header));
+
+	u8* pixels = data + offset;
+
+	for (u32 i = 0; i < atlas->sheet_count; i++) {
+		const struct atlas_sheet* sheet = atlas->sheets + i;
+		if (!sheet->packed || sheet->page != page) { continue; }
+
+		/* Sheets are placed from the top, but the rows of the page are
+		 * stored from the bottom. */
+		for (u32 y = 0; y < sheet->height; y++) {
+			memcpy(pixels + (page_size - (sheet->y + y) - 1) * stride + sheet->x * 4,
+				sheet->pixels + y * sheet->width * 4, sheet->width * 4);
+		}
+	}
+
+	return data;
+}
+
+static i32 atlas_entry_cmp(const void* a, const void* b) {
+	const u64 x = ((const struct atlas_entry*)a)->hash;
+	const u64 y = ((const struct atlas_entry*)b)->hash;
+	return (x > y) - (x < y);
+}
+
+u8* atlas_make_map(const struct atlas* atlas, u64* size) {
+	u32 entry_count = 0;
+	for (u32 i = 0; i < atlas->sheet_count; i++) {
+		entry_count += atlas->sheets[i].packed ? 1 : 0;
+	}
+
+	*size = sizeof(u32) * 2 + entry_count * sizeof(struct atlas_entry);
+
+	u8* data = core_calloc(1, *size);
+
+	memcpy(data, &entry_count, sizeof(u32));
+	memcpy(data + sizeof(u32), &atlas->page_count, sizeof(u32));
+
+	struct atlas_entry* entries = (struct atlas_entry*)(data + sizeof(u32) * 2);
+
+	u32 e = 0;
+	for (u32 i = 0; i < atlas->sheet_count; i++) {
+		const struct atlas_sheet* sheet = atlas->sheets + i;
+		if (!sheet->packed) { continue; }
+
+		entries[e++] = (struct atlas_entry) {
+			.hash = elf_hash((const u8*)sheet->path, (u32)strlen(sheet->path)),
+			.page = sheet->page,
+			.x = sheet->x,
+			.y = sheet->y,
+			.w = sheet->width,
+			.h = sheet->height
+		};
+	}
+
+	qsort(entries, entry_count, sizeof(struct atlas_entry), atlas_entry_cmp);
+
+	return data;
+}
+
+void deinit_atlas(struct atlas* atlas) {
+	for (u32 i = 0; i < atlas->sheet_count; i++) {
+		core_free(atlas->sheets[i].pixels);
+	}
+
+	if (atlas->sheets) {
+		core_free(atlas->sheets);
+	}
+
+	memset(atlas, 0, sizeof(struct atlas));
+}
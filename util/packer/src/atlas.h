@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common.h"
+
+/* Packs 32-bit bitmaps into square atlas pages, to be put into the package
+ * in place of the bitmaps themselves, along with the table that the game
+ * uses to find where each one ended up (see `atlas_map_path' in res.h). */
+
+struct atlas_sheet {
+	const char* path;
+	u32 width, height;
+
+	/* Top row first, in the same byte order as the bitmap. */
+	u8* pixels;
+
+	bool packed;
+	u32 page;
+	u32 x, y;
+};
+
+struct atlas {
+	struct atlas_sheet* sheets;
+	u32 sheet_count;
+	u32 sheet_capacity;
+
+	u32 page_size;
+	u32 page_count;
+};
+
+/* Returns false if `path' can't be read, or isn't a 32-bit bitmap; Such
+ * files are better off packed as they are. */
+bool atlas_add_sheet(struct atlas* atlas, const char* path);
+
+/* Sheets that don't fit on a page of their own are left unpacked. */
+void atlas_pack(struct atlas* atlas, u32 page_size);
+
+bool atlas_packed(const struct atlas* atlas, const char* path);
+
+/* Both return a new buffer, to be freed with `core_free'. */
+u8* atlas_make_page(const struct atlas* atlas, u32 page, u64* size);
+u8* atlas_make_map(const struct atlas* atlas, u64* size);
+
+void deinit_atlas(struct atlas* atlas);
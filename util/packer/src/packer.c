@@ -1,7 +1,9 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "atlas.h"
 #include "common.h"
 #include "core.h"
 #include "imui.h"
@@ -13,6 +15,10 @@
 u8* buffer;
 
 #define max_files 1024
+
+/* The same as the layers of the game's sprite array, so that a page takes
+ * up a layer. */
+#define atlas_page_size 512
 char** files;
 u32 file_count;
 
@@ -27,6 +33,34 @@ static void on_text_input(struct window* window, const char* text, void* udata)
 	ui_text_input_event(udata, text);
 }
 
+/* Something to go into the package: Either a file on disk, or, if `data'
+ * isn't null, something made while packing. */
+struct pack_entry {
+	u64 hash;
+	const char* name;
+
+	u8* data;
+	u64 size;
+};
+
+static i32 pack_entry_cmp(const void* a, const void* b) {
+	const u64 x = ((const struct pack_entry*)a)->hash;
+	const u64 y = ((const struct pack_entry*)b)->hash;
+	return (x > y) - (x < y);
+}
+
+static void add_pack_entry(struct pack_entry* entry, const char* name, u8* data, u64 size) {
+	entry->hash = elf_hash((const u8*)name, (u32)strlen(name));
+	entry->name = name;
+	entry->data = data;
+	entry->size = size;
+}
+
+static bool is_bitmap(const char* name) {
+	const u64 len = strlen(name);
+	return len > 4 && strcmp(name + len - 4, ".bmp") == 0;
+}
+
 void pack_files_worker(struct thread* thread) {
 	lock_mutex(get_thread_uptr(thread));
 	i32* pack_progress = mutex_get_ptr(get_thread_uptr(thread));
@@ -41,37 +75,88 @@ void pack_files_worker(struct thread* thread) {
 		return;
 	}
 
-	u64 header_size = file_count * (sizeof(u64) * 3) + sizeof(u64);
+	/* Sprite sheets are packed into atlas pages, which go into the package
+	 * in their place. */
+	struct atlas atlas = { 0 };
+	for (u32 i = 0; i < file_count; i++) {
+		if (is_bitmap(files[i])) {
+			atlas_add_sheet(&atlas, files[i]);
+		}
+	}
+
+	atlas_pack(&atlas, atlas_page_size);
+
+	struct pack_entry* entries = core_alloc((file_count + atlas.page_count + 1) * sizeof(struct pack_entry));
+	u32 entry_count = 0;
+
+	for (u32 i = 0; i < file_count; i++) {
+		if (atlas_packed(&atlas, files[i])) { continue; }
+
+		add_pack_entry(entries + entry_count++, files[i], null, 0);
+	}
+
+	char (*page_names)[64] = core_alloc(atlas.page_count * sizeof(*page_names));
+	for (u32 i = 0; i < atlas.page_count; i++) {
+		u64 size;
+		u8* page = atlas_make_page(&atlas, i, &size);
+
+		sprintf(page_names[i], atlas_page_path, i);
+		add_pack_entry(entries + entry_count++, page_names[i], page, size);
+	}
+
+	if (atlas.page_count > 0) {
+		u64 size;
+		u8* map = atlas_make_map(&atlas, &size);
+
+		add_pack_entry(entries + entry_count++, atlas_map_path, map, size);
+	}
+
+	/* The game looks files up with a binary search over the header, so the
+	 * entries, and the files along with them, are written in order of
+	 * their hashes. */
+	qsort(entries, entry_count, sizeof(struct pack_entry), pack_entry_cmp);
+
+	u64 header_size = entry_count * (sizeof(u64) * 3) + sizeof(u64);
 	u64 cur_size = header_size;
 
 	fwrite(&header_size, sizeof(header_size), 1, out);
 
-	for (u32 i = 0; i < file_count; i++) {
-		u64 hash = elf_hash((const u8*)files[i], (u32)strlen(files[i]));
+	for (u32 i = 0; i < entry_count; i++) {
+		struct pack_entry* entry = entries + i;
 
-		FILE* file = fopen(files[i], "rb");
-		if (!file) { continue; }
+		if (!entry->data) {
+			FILE* file = fopen(entry->name, "rb");
+			if (!file) { continue; }
 
-		fseek(file, 0, SEEK_END);
+			fseek(file, 0, SEEK_END);
 
-		u64 size = ftell(file);
+			entry->size = ftell(file);
 
-		fwrite(&hash, sizeof(hash), 1, out);
-		fwrite(&cur_size, sizeof(cur_size), 1, out);
-		fwrite(&size, sizeof(size), 1, out);
+			fclose(file);
+		}
 
-		cur_size += size;
+		fwrite(&entry->hash, sizeof(entry->hash), 1, out);
+		fwrite(&cur_size, sizeof(cur_size), 1, out);
+		fwrite(&entry->size, sizeof(entry->size), 1, out);
 
-		fclose(file);
+		cur_size += entry->size;
 	}
 
 	lock_mutex(get_thread_uptr(thread));
 
-	for (u32 i = 0; i < file_count; i++) {
-		*pack_progress = (i32)(((f32)i / (f32)file_count) * 100.0f);
-		strcpy(current_file, files[i]);
+	for (u32 i = 0; i < entry_count; i++) {
+		const struct pack_entry* entry = entries + i;
+
+		*pack_progress = (i32)(((f32)i / (f32)entry_count) * 100.0f);
+		strcpy(current_file, entry->name);
 
-		FILE* file = fopen(files[i], "rb");
+		if (entry->data) {
+			fwrite(entry->data, entry->size, 1, out);
+			core_free(entry->data);
+			continue;
+		}
+
+		FILE* file = fopen(entry->name, "rb");
 		if (!file) { continue; }
 
 		fseek(file, 0, SEEK_END);
@@ -86,6 +171,10 @@ void pack_files_worker(struct thread* thread) {
 		fclose(file);
 	}
 
+	core_free(page_names);
+	core_free(entries);
+	deinit_atlas(&atlas);
+
 	unlock_mutex(get_thread_uptr(thread));
 
 	fclose(out);
@@ -1,12 +1,22 @@
 #include <string.h>
 #include <stdio.h>
 
+#include "clock.h"
 #include "common.h"
 #include "core.h"
 #include "coroutine.h"
+#include "entity.h"
+#include "jobs.h"
+#include "rewind.h"
 #include "lsp.h"
 #include "maths.h"
+#include "platform.h"
+#include "replay.h"
+#include "res.h"
+#include "rng.h"
+#include "scheduler.h"
 #include "test.h"
+#include "video.h"
 
 static coroutine_decl(test_coroutine)
 	*(i32*)co_udata = 10;
@@ -442,9 +452,1069 @@ bool m_m4f_identity() {
 		a.m[3][3] == 1.0f;
 }
 
-#include "platform.h"
+struct test_position { f32 x, y; };
+struct test_velocity { f32 x, y; };
+struct test_tag { i32 value; };
+
+bool fixed_clock() {
+	struct fixed_clock clock = { .max_ticks = 5 };
+
+	/* Off until it has a rate. */
+	bool good = fixed_clock_advance(&clock, 1.0) == 0;
+
+	set_tick_rate(&clock, 100.0);
+
+	good = good && fixed_clock_advance(&clock, 0.025) == 2;
+	good = good && clock.alpha > 0.49 && clock.alpha < 0.51;
+
+	/* The half tick left over carries into the next frame. */
+	good = good && fixed_clock_advance(&clock, 0.006) == 1;
+
+	/* A long frame runs no more than `max_ticks', and drops the rest. */
+	good = good && fixed_clock_advance(&clock, 0.1) == 5;
+	good = good && clock.dropped_ticks == 5 && clock.total_ticks == 8;
+	good = good && clock.alpha >= 0.0 && clock.alpha < 1.0;
+
+	return good;
+}
+
+bool seeded_random() {
+	i32 a[64], b[64];
+
+	seed_random(1234);
+	for (u32 i = 0; i < 64; i++) { a[i] = random_int(0, 1000); }
+
+	seed_random(1234);
+	for (u32 i = 0; i < 64; i++) { b[i] = random_int(0, 1000); }
+
+	bool good = memcmp(a, b, sizeof(a)) == 0;
+
+	for (u32 i = 0; i < 1000; i++) {
+		i32 n = random_int(-5, 5);
+		f64 f = random_f64(2.0, 3.0);
+		good = good && n >= -5 && n <= 5 && f >= 2.0 && f <= 3.0;
+	}
+
+	return good;
+}
+
+bool rng_ranges() {
+	struct rng a, b;
+	rng_seed(&a, 5);
+	rng_seed(&b, 5);
+
+	bool good = true;
+	for (u32 i = 0; i < 100; i++) {
+		good = good && rng_u64(&a) == rng_u64(&b);
+	}
+
+	/* Both ends of an integer range come up. */
+	u32 counts[3] = { 0 };
+	for (u32 i = 0; i < 3000; i++) {
+		i32 n = rng_int(&a, -1, 1);
+		good = good && n >= -1 && n <= 1;
+		if (good) { counts[n + 1]++; }
+	}
+
+	good = good && counts[0] > 800 && counts[1] > 800 && counts[2] > 800;
+
+	f32 out[1000];
+	rng_fill_f32(&a, out, 1000, 2.0f, 4.0f);
+
+	f32 sum = 0.0f;
+	for (u32 i = 0; i < 1000; i++) {
+		good = good && out[i] >= 2.0f && out[i] < 4.0f;
+		sum += out[i];
+	}
+
+	good = good && sum > 2900.0f && sum < 3100.0f;
+
+	return good;
+}
+
+bool input_replay() {
+	const char* path = "test_input.rec";
+
+	struct window* window = new_headless_window(make_v2i(100, 100));
+
+	struct input_state states[3] = { 0 };
+	states[1].held_keys[key_Z] = true;
+	states[1].pressed_keys[key_Z] = true;
+	states[2].held_keys[key_Z] = true;
+	states[2].mouse_pos = make_v2i(40, -3);
+
+	const f64 timesteps[4] = { 0.016, 0.017, 0.018, 0.019 };
+
+	struct input_recording* recording = new_input_recording(path, 99);
+	for (u32 i = 0; i < 4; i++) {
+		set_window_input(window, &states[i < 3 ? i : 2]);
+		record_input(recording, window, timesteps[i]);
+	}
+	free_input_recording(recording);
+
+	recording = open_input_recording(path);
+	bool good = recording && get_input_recording_seed(recording) == 99;
+
+	set_window_input(window, &states[0]);
+
+	f64 ts;
+	for (u32 i = 0; good && i < 4; i++) {
+		good = replay_input(recording, window, &ts) && ts == timesteps[i];
+
+		const struct input_state* expected = &states[i < 3 ? i : 2];
+		good = good &&
+			key_pressed(window, key_Z) == expected->held_keys[key_Z] &&
+			key_just_pressed(window, key_Z) == expected->pressed_keys[key_Z] &&
+			v2i_eq(get_mouse_position(window), expected->mouse_pos);
+	}
+
+	good = good && !replay_input(recording, window, &ts);
+
+	if (recording) { free_input_recording(recording); }
+	free_window(window);
+	remove(path);
+
+	return good;
+}
+
+bool renderer_shared_texture() {
+	video_init_headless();
+
+	struct renderer* a = new_renderer_ex((struct shader) { 0 }, make_v2i(100, 100), 64);
+	struct renderer* b = new_renderer_ex((struct shader) { 0 }, make_v2i(100, 100), 64);
+
+	struct texture texture = { .width = 16, .height = 16 };
+
+	struct textured_quad quad = {
+		.texture = &texture,
+		.dimentions = { 16, 16 },
+		.rect = { 0, 0, 16, 16 },
+		.color = { 255, 255, 255, 255 }
+	};
+
+	/* The texture is in a different slot in each renderer, and each push
+	 * leaves the other renderer's slot on the texture. */
+	struct texture other = { .width = 16, .height = 16 };
+	struct textured_quad other_quad = quad;
+	other_quad.texture = &other;
+	renderer_push(b, &other_quad);
+
+	for (u32 i = 0; i < 40; i++) {
+		renderer_push(a, &quad);
+		renderer_push(b, &quad);
+	}
+
+	bool good = a->texture_count == 1 && b->texture_count == 2 &&
+		a->quad_count == 40 && b->quad_count == 41;
+
+	free_renderer(a);
+	free_renderer(b);
+
+	return good;
+}
+
+bool shader_uniform_names() {
+	/* "ab" and "`r" have the same hash. */
+	struct shader_uniform uniforms[] = {
+		{ .hash = elf_hash((const u8*)"ab", 2), .name = "ab", .location = 1 },
+		{ .hash = elf_hash((const u8*)"`r", 2), .name = "`r", .location = 2 },
+		{ .hash = elf_hash((const u8*)"camera", 6), .name = "camera", .location = 3 }
+	};
+
+	struct shader shader = {
+		.uniforms = uniforms,
+		.uniform_count = 3
+	};
+
+	bool good = uniforms[0].hash == uniforms[1].hash && uniforms[0].hash < uniforms[2].hash;
+
+	good = good && shader_get_location(&shader, "ab") == 1;
+	good = good && shader_get_location(&shader, "`r") == 2;
+	good = good && shader_get_location(&shader, "camera") == 3;
+	good = good && shader_get_location(&shader, "view") == -1;
+
+	return good;
+}
+
+bool package() {
+	const char* path = "test_package.pck";
+	const char* names[3] = { "res/a.txt", "res/b.txt", "res/c.txt" };
+	const char* contents[3] = { "first", "the second", "3" };
+
+	/* Written in list order, like packages from before the packer sorted
+	 * them. */
+	FILE* out = fopen(path, "wb");
+	if (!out) { return false; }
+
+	const u64 header_size = 3 * (sizeof(u64) * 3) + sizeof(u64);
+	u64 offset = header_size;
+
+	fwrite(&header_size, sizeof(header_size), 1, out);
+	for (u32 i = 0; i < 3; i++) {
+		const u64 hash = elf_hash((const u8*)names[i], (u32)strlen(names[i]));
+		const u64 size = strlen(contents[i]);
+
+		fwrite(&hash, sizeof(hash), 1, out);
+		fwrite(&offset, sizeof(offset), 1, out);
+		fwrite(&size, sizeof(size), 1, out);
+
+		offset += size;
+	}
+
+	for (u32 i = 0; i < 3; i++) {
+		fwrite(contents[i], strlen(contents[i]), 1, out);
+	}
+
+	fclose(out);
+
+	struct package* package = open_package(path);
+	bool good = package != null;
+
+	for (u32 i = 0; good && i < 3; i++) {
+		const u8* data;
+		u64 size;
+		good = package_find(package, names[i], &data, &size) &&
+			size == strlen(contents[i]) && memcmp(data, contents[i], size) == 0;
+	}
+
+	const u8* data;
+	u64 size;
+	good = good && !package_find(package, "res/d.txt", &data, &size);
+
+	if (package) { close_package(package); }
+	remove(path);
+
+	return good;
+}
+
+bool type_registry() {
+	char name[] = "struct test_position";
+
+	u32 a = type_info(struct test_position).id;
+	u32 b = type_info(struct test_velocity).id;
+
+	return a != b && type_index(name) == a && type_info(struct test_position).id == a &&
+		strcmp(get_type_name(a), "struct test_position") == 0;
+}
+
+struct type_registry_job {
+	char names[128][32];
+	u32 ids[1024];
+};
+
+static void type_registry_resolve(u32 begin, u32 end, void* udata) {
+	struct type_registry_job* job = udata;
+
+	for (u32 i = begin; i < end; i++) {
+		job->ids[i] = type_index(job->names[i % 128]);
+	}
+}
+
+bool type_registry_threads() {
+	const u32 a = type_info(struct test_position).id;
+	const u32 b = type_info(struct test_velocity).id;
+
+	/* Each copy of a name is at an address of its own, so each one misses
+	 * the cache once, while other threads are hitting it. */
+	struct type_registry_job* job = core_calloc(1, sizeof(struct type_registry_job));
+	for (u32 i = 0; i < 128; i++) {
+		strcpy(job->names[i], i % 2 == 0 ? "struct test_position" : "struct test_velocity");
+	}
+
+	const u32 thread_count = get_job_thread_count();
+	set_job_thread_count(4);
+
+	run_jobs(1024, 4, type_registry_resolve, job);
+
+	set_job_thread_count(thread_count);
+
+	bool good = get_type_count() > a && get_type_count() > b;
+	for (u32 i = 0; i < 1024; i++) {
+		good = good && job->ids[i] == ((i % 128) % 2 == 0 ? a : b);
+	}
+
+	core_free(job);
+
+	return good;
+}
+
+bool ecs_pointer_stability() {
+	struct world* world = new_world();
+
+	entity first = new_entity(world);
+	struct test_position* p = _add_component(world, first, type_info(struct test_position),
+		&(struct test_position) { 1.0f, 2.0f });
+
+	for (u32 i = 0; i < 10000; i++) {
+		entity e = new_entity(world);
+		add_componentv(world, e, struct test_position, .x = (f32)i);
+	}
+
+	bool good = p == get_component(world, first, struct test_position) && p->x == 1.0f && p->y == 2.0f;
+
+	/* Leave a large gap in the entity IDs. */
+	entity last = 0;
+	for (u32 i = 0; i < 100000; i++) {
+		last = new_entity(world);
+	}
+
+	add_componentv(world, last, struct test_velocity, .x = 3.0f);
+	good = good && has_component(world, last, struct test_velocity) &&
+		!has_component(world, first, struct test_velocity) &&
+		get_component(world, last, struct test_velocity)->x == 3.0f;
+
+	free_world(world);
+	return good;
+}
+
+bool ecs_signature() {
+	struct world* world = new_world();
+
+	entity a = new_entity(world);
+	entity b = new_entity(world);
+	add_componentv(world, a, struct test_position, 0);
+	add_componentv(world, a, struct test_tag, 0);
+	add_componentv(world, b, struct test_velocity, 0);
+
+	struct type_info types[4];
+	u32 c = get_entity_component_types(world, a, types, 4);
+
+	bool good = c == 2 && get_entity_component_types(world, a, types, 1) == 1 &&
+		has_component(world, a, struct test_tag) && !has_component(world, a, struct test_velocity);
+
+	destroy_entity(world, a);
+	entity recycled = new_entity(world);
+
+	good = good && get_entity_component_types(world, recycled, types, 4) == 0 &&
+		!has_component(world, recycled, struct test_position) &&
+		has_component(world, b, struct test_velocity);
+
+	u32 seen = 0;
+	for (view(world, view, type_info(struct test_position))) { seen++; }
+	good = good && seen == 0;
+
+	free_world(world);
+	return good;
+}
+
+bool ecs_commands() {
+	struct world* world = new_world();
+	struct ecs_commands* cmds = new_ecs_commands();
+
+	entity a = new_entity(world);
+	add_componentv(world, a, struct test_position, .x = 1.0f);
+
+	for (view(world, view, type_info(struct test_position))) {
+		entity e = cmd_new_entity(cmds);
+		cmd_add_componentv(cmds, e, struct test_position, .x = 2.0f);
+		cmd_add_componentv(cmds, e, struct test_tag, .value = 7);
+		cmd_add_componentv(cmds, view.e, struct test_velocity, .x = 3.0f);
+		cmd_remove_component(cmds, view.e, struct test_position);
+	}
+
+	bool good = get_alive_entity_count(world) == 1 && has_component(world, a, struct test_position);
+
+	apply_ecs_commands(cmds, world);
+
+	good = good && get_alive_entity_count(world) == 2 &&
+		!has_component(world, a, struct test_position) &&
+		get_component(world, a, struct test_velocity)->x == 3.0f;
+
+	u32 tagged = 0;
+	for (view(world, view, type_info(struct test_position), type_info(struct test_tag))) {
+		good = good && view_get(&view, struct test_tag)->value == 7 &&
+			view_get(&view, struct test_position)->x == 2.0f;
+		cmd_destroy_entity(cmds, view.e);
+		tagged++;
+	}
+
+	apply_ecs_commands(cmds, world);
+	good = good && tagged == 1 && get_alive_entity_count(world) == 1;
+
+	free_ecs_commands(cmds);
+	free_world(world);
+	return good;
+}
+
+static void job_pool_fill(u32 begin, u32 end, void* udata) {
+	for (u32 i = begin; i < end; i++) {
+		((u32*)udata)[i]++;
+	}
+}
+
+bool job_pool() {
+	const u32 thread_count = get_job_thread_count();
+
+	u32 counts[1000] = { 0 };
+
+	/* The pool is kept between calls, and between changes to the thread
+	 * count, and can be started again after it's stopped. */
+	const u32 thread_counts[] = { 4, 2, 8, 4 };
+	for (u32 i = 0; i < 4; i++) {
+		set_job_thread_count(thread_counts[i]);
+
+		for (u32 ii = 0; ii < 100; ii++) {
+			run_jobs(1000, 16, job_pool_fill, counts);
+		}
+
+		if (i == 2) {
+			deinit_jobs();
+		}
+	}
+
+	set_job_thread_count(thread_count);
+
+	bool good = true;
+	for (u32 i = 0; i < 1000; i++) {
+		good = good && counts[i] == 400;
+	}
+
+	return good;
+}
+
+static void job_rng_streams_record(u32 begin, u32 end, void* udata) {
+	/* Nothing is drawn, so every job sees its thread's stream as seeded. */
+	for (u32 i = begin; i < end; i++) {
+		((u64*)udata)[i] = thread_rng()->s[0];
+	}
+}
+
+bool job_rng_streams() {
+	const u32 thread_count = get_job_thread_count();
+	set_job_thread_count(4);
+
+	struct rng streams[4];
+	for (u32 i = 0; i < 4; i++) {
+		rng_seed_stream(streams + i, 77, i);
+	}
+
+	/* Stream zero is the seed's own sequence. */
+	struct rng plain;
+	rng_seed(&plain, 77);
+	bool good = memcmp(&plain, streams, sizeof(plain)) == 0;
+
+	for (u32 run = 0; run < 2; run++) {
+		seed_random(77);
+
+		u64 seen[64];
+		run_jobs(64, 1, job_rng_streams_record, seen);
+
+		for (u32 i = 0; i < 64; i++) {
+			bool found = false;
+			for (u32 ii = 0; ii < 4; ii++) {
+				found = found || seen[i] == streams[ii].s[0];
+			}
+
+			good = good && found;
+		}
+	}
+
+	set_job_thread_count(thread_count);
+
+	return good;
+}
+
+static void ecs_parallel_step(struct view* view, void* udata) {
+	struct test_position* p = view_get(view, struct test_position);
+	struct test_velocity* v = view_get(view, struct test_velocity);
+
+	p->x += v->x;
+	p->y += *(f32*)udata;
+}
+
+bool ecs_parallel_view() {
+	struct world* world = new_world();
+
+	entity es[3000];
+	for (u32 i = 0; i < 3000; i++) {
+		es[i] = new_entity(world);
+		add_componentv(world, es[i], struct test_position, .x = (f32)i);
+		if (i % 3 != 0) {
+			add_componentv(world, es[i], struct test_velocity, .x = 1.0f);
+		}
+	}
+
+	const u32 thread_count = get_job_thread_count();
+	set_job_thread_count(4);
+
+	f32 dy = 2.0f;
+	for (u32 i = 0; i < 2; i++) {
+		view_for_each_parallel(world, ecs_parallel_step, &dy, 64,
+			type_info(struct test_position), type_info(struct test_velocity));
+	}
+
+	/* The jobs must find their types through the view, without writing
+	 * to the type cache. */
+	struct type_info types[] = { type_info(struct test_position), type_info(struct test_velocity) };
+	flush_type_cache();
+
+	_view_for_each_parallel(world, 2, types, ecs_parallel_step, &dy, 64);
+
+	bool good = true;
+	for (u32 i = 0; i < type_cache_size; i++) {
+		good = good && type_cache[i] == 0;
+	}
+
+	set_job_thread_count(thread_count);
+
+	for (u32 i = 0; i < 3000; i++) {
+		struct test_position* p = get_component(world, es[i], struct test_position);
+		good = good && (i % 3 == 0 ?
+			p->x == (f32)i && p->y == 0.0f :
+			p->x == (f32)i + 3.0f && p->y == 6.0f);
+	}
+
+	free_world(world);
+	return good;
+}
+
+static void sched_move(struct world* world, void* udata) {
+	for (view(world, view, type_info(struct test_position))) {
+		view_get(&view, struct test_position)->x += 1.0f;
+	}
+}
+
+static void sched_read_velocity(struct world* world, void* udata) {
+	for (view(world, view, type_info(struct test_velocity))) {
+		*(f32*)udata += view_get(&view, struct test_velocity)->x;
+	}
+}
+
+static void sched_read_position(struct world* world, void* udata) {
+	for (view(world, view, type_info(struct test_position))) {
+		*(f32*)udata = view_get(&view, struct test_position)->x;
+	}
+}
+
+static void sched_spawn(struct world* world, void* udata) {
+	add_componentv(world, new_entity(world), struct test_tag, .value = 1);
+}
+
+bool scheduler_order() {
+	struct world* world = new_world();
+
+	entity e = new_entity(world);
+	add_componentv(world, e, struct test_position, .x = 0.0f);
+	add_componentv(world, e, struct test_velocity, .x = 2.0f);
+
+	f32 velocity_sum = 0.0f, position_seen = 0.0f;
+
+	struct scheduler* s = new_scheduler(world);
+
+	u32 move = scheduler_add(s, "move", sched_move, null, 0);
+	system_writes(s, move, type_info(struct test_position));
+
+	u32 read_velocity = scheduler_add(s, "read_velocity", sched_read_velocity, &velocity_sum, 0);
+	system_reads(s, read_velocity, type_info(struct test_velocity));
+
+	u32 read_position = scheduler_add(s, "read_position", sched_read_position, &position_seen, 0);
+	system_reads(s, read_position, type_info(struct test_position));
+
+	u32 spawn = scheduler_add(s, "spawn", sched_spawn, null, system_exclusive);
+
+	run_scheduler(s);
+	run_scheduler(s);
+
+	bool good = get_system_timing(s, move).wave == 0 &&
+		get_system_timing(s, read_velocity).wave == 0 &&
+		get_system_timing(s, read_position).wave == 1 &&
+		get_system_timing(s, spawn).wave == 2 &&
+		get_system_timing(s, spawn).critical &&
+		strcmp(get_system_timing(s, move).name, "move") == 0;
+
+	good = good && velocity_sum == 4.0f && position_seen == 2.0f && get_alive_entity_count(world) == 3;
+
+	free_scheduler(s);
+	free_world(world);
+	return good;
+}
+
+bool ecs_soa() {
+	struct world* world = new_world();
+
+	set_component_soa(world, struct test_position,
+		component_field(struct test_position, x),
+		component_field(struct test_position, y));
+
+	struct group* group = get_group(world,
+		type_info(struct test_position), type_info(struct test_velocity));
+
+	enum { count = 3000 };
+
+	entity es[count];
+	for (u32 i = 0; i < count; i++) {
+		es[i] = new_entity(world);
+		add_componentv(world, es[i], struct test_position, .x = (f32)i, .y = (f32)(i * 2));
+		if (i % 2 == 0) {
+			add_componentv(world, es[i], struct test_velocity, .x = 1.0f, .y = 0.5f);
+		}
+	}
+
+	/* Holes, so that components get moved about. */
+	for (u32 i = 0; i < count; i += 10) {
+		destroy_entity(world, es[i]);
+	}
+
+	const u32 size = get_group_size(group);
+
+	for (u32 i = 0; i < size;) {
+		u32 c0, c1, c2;
+		f32* x = get_component_field_array(world, struct test_position, 0, i, &c0);
+		f32* y = get_component_field_array(world, struct test_position, 1, i, &c1);
+		struct test_velocity* v = get_component_array(world, struct test_velocity, i, &c2);
+		const u32 c = minimum(minimum(c0, c1), c2);
+
+		for (u32 ii = 0; ii < c; ii++) {
+			x[ii] += v[ii].x;
+			y[ii] += v[ii].y;
+		}
+
+		i += c;
+	}
+
+	bool good = size == count / 2 - count / 10;
+
+	for (u32 i = 0; i < count; i++) {
+		if (i % 10 == 0) { continue; }
+
+		struct test_position p;
+		read_component(world, es[i], struct test_position, &p);
+
+		const f32 dx = i % 2 == 0 ? 1.0f : 0.0f;
+		good = good && p.x == (f32)i + dx && p.y == (f32)(i * 2) + dx * 0.5f;
+	}
+
+	write_component(world, es[1], struct test_position, ((struct test_position) { -1.0f, -2.0f }));
+
+	struct test_position p;
+	read_component(world, es[1], struct test_position, &p);
+	good = good && p.x == -1.0f && p.y == -2.0f;
+
+	free_world(world);
+	return good;
+}
+
+static u32 count_changed(struct world* world, u32 since) {
+	u32 c = 0;
+	for (view_changed(world, view, since, type_info(struct test_position), type_info(struct test_velocity))) {
+		c++;
+	}
+
+	return c;
+}
+
+bool ecs_change_tracking() {
+	struct world* world = new_world();
+	set_component_tracking(world, struct test_position);
+
+	entity es[100];
+	for (u32 i = 0; i < 100; i++) {
+		es[i] = new_entity(world);
+		add_componentv(world, es[i], struct test_position, .x = (f32)i);
+		add_componentv(world, es[i], struct test_velocity, .x = 1.0f);
+	}
+
+	const u32 t0 = get_world_tick(world);
+	bool good = count_changed(world, t0) == 100;
+
+	const u32 t1 = world_tick(world);
+	good = good && count_changed(world, t1) == 0;
+
+	/* Writes through plain pointers aren't seen. */
+	get_component(world, es[3], struct test_position)->x = 0.0f;
+	get_component_mut(world, es[5], struct test_position)->x = 0.0f;
+	write_component(world, es[7], struct test_position, ((struct test_position) { 1.0f, 1.0f }));
+
+	for (view(world, view, type_info(struct test_position))) {
+		if (get_entity_id(view.e) == 9) {
+			view_get_mut(&view, struct test_position)->y = 2.0f;
+		}
+	}
+
+	/* Moving components about, as removal does, keeps their ticks. */
+	destroy_entity(world, es[0]);
+
+	good = good && count_changed(world, t1) == 3 &&
+		component_changed(world, es[5], struct test_position, t1) &&
+		!component_changed(world, es[3], struct test_position, t1) &&
+		component_changed(world, es[9], struct test_position, t1);
+
+	world_tick(world);
+	good = good && count_changed(world, get_world_tick(world)) == 0 && count_changed(world, t0) == 99;
+
+	free_world(world);
+	return good;
+}
+
+bool ecs_scene() {
+	struct world* world = new_world();
+
+	struct scene* a = new_scene(world, "a");
+	struct scene* b = new_scene(world, "b");
+
+	entity es[100];
+	for (u32 i = 0; i < 100; i++) {
+		es[i] = new_entity(world);
+		add_componentv(world, es[i], struct test_position, .x = (f32)i);
+
+		scene_add(i % 2 == 0 ? a : b, es[i]);
+	}
+
+	entity loose = new_entity(world);
+
+	/* Destroying a member takes it out of its scene. */
+	destroy_entity(world, es[0]);
+	destroy_entity(world, es[1]);
+	scene_remove(b, es[3]);
+
+	bool good = get_scene_size(a) == 49 && get_scene_size(b) == 48 &&
+		get_entity_scene(world, es[2]) == a && get_entity_scene(world, es[3]) == null;
+
+	/* A recycled ID isn't in the scene its last owner was in. */
+	entity recycled = new_entity(world);
+	good = good && get_entity_scene(world, recycled) == null;
+
+	clear_scene(a);
+
+	good = good && get_scene_size(a) == 0 && get_scene_size(b) == 48 &&
+		entity_valid(world, es[3]) && entity_valid(world, loose) && entity_valid(world, recycled) &&
+		!entity_valid(world, es[2]) && entity_valid(world, es[5]);
+
+	u32 count = 0;
+	for (view(world, view, type_info(struct test_position))) {
+		count++;
+	}
+
+	good = good && count == 49;
+
+	free_scene(b);
+	free_scene(a);
+
+	good = good && get_alive_entity_count(world) == 3;
+
+	free_world(world);
+	return good;
+}
+
+struct test_named { const char* name; };
+
+static const char* test_names[] = { "bat", "coin", "heart" };
+
+static void on_test_named_save(struct world* world, entity e, void* component) {
+	struct test_named* named = component;
+
+	for (u32 i = 0; i < 3; i++) {
+		if (named->name == test_names[i]) {
+			named->name = (const char*)(uintptr_t)i;
+		}
+	}
+}
+
+static void on_test_named_load(struct world* world, entity e, void* component) {
+	struct test_named* named = component;
+	named->name = test_names[(uintptr_t)named->name];
+}
+
+static bool check_snapshot_world(struct world* world, entity* es, u32 count) {
+	struct group* group = get_group(world, type_info(struct test_position), type_info(struct test_velocity));
+
+	bool good = get_group_size(group) == count / 2;
+
+	for (group_view(group, view)) {
+		good = good && group_view_get(&view, struct test_velocity)->x == (f32)get_entity_id(view.e);
+	}
+
+	for (u32 i = 0; i < count; i++) {
+		const bool alive = i % 4 != 0;
+		good = good && entity_valid(world, es[i]) == alive;
+
+		if (!alive) { continue; }
+
+		good = good && get_component(world, es[i], struct test_position)->x == (f32)i &&
+			strcmp(get_component(world, es[i], struct test_named)->name, test_names[i % 3]) == 0 &&
+			has_component(world, es[i], struct test_velocity) == (i % 2 == 1);
+	}
+
+	/* The free list comes back too, so IDs are recycled in the same order. */
+	const entity e = new_entity(world);
+	good = good && get_entity_id(e) == get_entity_id(es[count - 4]);
+
+	return good;
+}
+
+bool ecs_snapshot() {
+	struct world* world = new_world();
+	set_component_snapshot_funcs(world, struct test_named, on_test_named_save, on_test_named_load);
+	get_group(world, type_info(struct test_position), type_info(struct test_velocity));
+
+	entity es[400];
+	for (u32 i = 0; i < 400; i++) {
+		es[i] = new_entity(world);
+		add_componentv(world, es[i], struct test_position, .x = (f32)i);
+		add_componentv(world, es[i], struct test_named, .name = test_names[i % 3]);
+
+		if (i % 2 == 1) {
+			add_componentv(world, es[i], struct test_velocity, .x = (f32)i);
+		}
+	}
+
+	for (u32 i = 0; i < 400; i += 4) {
+		destroy_entity(world, es[i]);
+	}
+
+	u64 size;
+	void* snapshot = world_snapshot_write(world, &size);
+
+	/* Into the same world, after making a mess of it. */
+	for (u32 i = 1; i < 400; i += 2) {
+		if (i % 4 != 0) { destroy_entity(world, es[i]); }
+	}
+	add_componentv(world, new_entity(world), struct test_tag, .value = 1);
+
+	bool good = world_snapshot_read(world, snapshot, size) && check_snapshot_world(world, es, 400);
+
+	u32 tags = 0;
+	for (view(world, view, type_info(struct test_tag))) { tags++; }
+	good = good && tags == 0;
+
+	free_world(world);
+
+	/* Into a fresh world. */
+	world = new_world();
+	set_component_snapshot_funcs(world, struct test_named, on_test_named_save, on_test_named_load);
+
+	good = good && world_snapshot_read(world, snapshot, size) && check_snapshot_world(world, es, 400);
+
+	/* A truncated snapshot is refused, and the world is left alone. */
+	const u32 alive = get_alive_entity_count(world);
+	good = good && !world_snapshot_read(world, snapshot, size - 16) && get_alive_entity_count(world) == alive;
+
+	free_world(world);
+
+	/* So is one whose pool names an entity that doesn't exist, and no pools
+	 * are made for it. A pool's section starts with its header, whose
+	 * first field is the length of its name, then the name and the dense
+	 * array, each padded to eight bytes. */
+	struct snapshot_section sections[4];
+	world_snapshot_sections(snapshot, size, sections, 4);
+
+	u8* bad = core_alloc(size);
+	memcpy(bad, snapshot, size);
+
+	u32 name_length;
+	memcpy(&name_length, bad + sections[2].offset, sizeof(u32));
+
+	const u64 dense = sections[2].offset + 24 + ((name_length + 7) & ~7u);
+	const entity stranger = make_handle(1000000, 0);
+	memcpy(bad + dense, &stranger, sizeof(entity));
+
+	world = new_world();
+
+	good = good && !world_snapshot_read(world, bad, size) &&
+		get_component_pool_count(world) == 0 && get_alive_entity_count(world) == 0;
+
+	free_world(world);
+	core_free(bad);
+	core_free(snapshot);
+
+	return good;
+}
+
+/* A frame of the rewind test's world, summed up. */
+static f64 rewind_test_sum(struct world* world) {
+	f64 sum = (f64)get_alive_entity_count(world) * 1000000.0;
+
+	for (view(world, view, type_info(struct test_position))) {
+		sum += (f64)view_get(&view, struct test_position)->x * (f64)(get_entity_id(view.e) + 1);
+	}
+
+	return sum;
+}
+
+bool ecs_rewind() {
+	struct world* world = new_world();
+
+	/* Small enough that old frames get dropped and the ring wraps. */
+	struct rewind* rewind = new_rewind(world, 256 * 1024, 1);
+
+	entity es[2000];
+	for (u32 i = 0; i < 2000; i++) {
+		es[i] = new_entity(world);
+		add_componentv(world, es[i], struct test_position, .x = (f32)i);
+		add_componentv(world, es[i], struct test_velocity, .x = 1.0f);
+	}
+
+	f64 sums[200];
+
+	for (u32 frame = 0; frame < 200; frame++) {
+		/* A few entities move each frame, and some come and go. */
+		for (u32 i = 0; i < 10; i++) {
+			const entity e = es[(frame * 37 + i * 101) % 2000];
+			if (entity_valid(world, e)) {
+				get_component(world, e, struct test_position)->x += 1.0f;
+			}
+		}
+
+		const u32 victim = (frame * 13) % 2000;
+		if (entity_valid(world, es[victim])) {
+			destroy_entity(world, es[victim]);
+		} else {
+			es[victim] = new_entity(world);
+			add_componentv(world, es[victim], struct test_position, .x = (f32)frame);
+		}
+
+		rewind_capture(rewind);
+		sums[frame] = rewind_test_sum(world);
+	}
+
+	struct rewind_stats stats = get_rewind_stats(rewind);
+
+	bool good = stats.frame_count > 2 && stats.frame_count < 200 && stats.used <= stats.budget;
+
+	/* Scrub backwards, then forwards again. */
+	for (u32 back = 0; back < stats.frame_count; back++) {
+		good = good && rewind_seek(rewind, back) && rewind_test_sum(world) == sums[199 - back];
+	}
+
+	for (u32 back = stats.frame_count; back > 0; back--) {
+		good = good && rewind_seek(rewind, back - 1) && rewind_test_sum(world) == sums[199 - (back - 1)];
+	}
+
+	good = good && !rewind_seek(rewind, stats.frame_count);
+
+	/* Carrying on from an older frame drops the ones after it. */
+	rewind_seek(rewind, 2);
+	rewind_capture(rewind);
+
+	good = good && get_rewind_stats(rewind).frame_count == stats.frame_count - 1 &&
+		rewind_seek(rewind, 1) && rewind_test_sum(world) == sums[197] &&
+		rewind_seek(rewind, 2) && rewind_test_sum(world) == sums[196];
+
+	free_rewind(rewind);
+	free_world(world);
+
+	return good;
+}
+
+static u32 count_group(struct group* group) {
+	u32 c = 0;
+	for (group_view(group, view)) {
+		struct test_position* p = group_view_get(&view, struct test_position);
+		struct test_velocity* v = group_view_get(&view, struct test_velocity);
+		if (p->x != v->x) { return UINT32_MAX; }
+		c++;
+	}
+
+	return c;
+}
+
+bool ecs_spawn_batch() {
+	struct world* world = new_world();
+	struct group* group = get_group(world,
+		type_info(struct test_position), type_info(struct test_velocity));
+
+	/* A couple of destroyed entities, so that some IDs get recycled. */
+	for (u32 i = 0; i < 4; i++) {
+		entity e = new_entity(world);
+		add_componentv(world, e, struct test_tag, .value = -1);
+		if (i % 2 == 0) { destroy_entity(world, e); }
+	}
+
+	/* Enough to span more than one page of positions. */
+	enum { count = 5000 };
+	static struct test_position positions[count];
+	for (u32 i = 0; i < count; i++) {
+		positions[i] = (struct test_position) { (f32)i, (f32)-i };
+	}
+
+	static entity es[count];
+	spawn_batch(world, count, 2,
+		(struct type_info[]) { type_info(struct test_position), type_info(struct test_velocity) },
+		(void*[]) { positions, null }, es);
+
+	bool good = get_alive_entity_count(world) == count + 2 && get_group_size(group) == count;
+
+	for (u32 i = 0; i < count; i++) {
+		struct test_position* p = get_component(world, es[i], struct test_position);
+		struct test_velocity* v = get_component(world, es[i], struct test_velocity);
+
+		good = good && entity_valid(world, es[i]) && !has_component(world, es[i], struct test_tag) &&
+			p->x == (f32)i && p->y == (f32)-i && v->x == 0.0f && v->y == 0.0f;
+	}
+
+	free_world(world);
+	return good;
+}
+
+bool ecs_group() {
+	struct world* world = new_world();
+	struct group* group = get_group(world,
+		type_info(struct test_position), type_info(struct test_velocity));
+
+	entity es[100];
+	for (u32 i = 0; i < 100; i++) {
+		es[i] = new_entity(world);
+		add_componentv(world, es[i], struct test_position, .x = (f32)i);
+		if (i % 3 == 0) {
+			add_componentv(world, es[i], struct test_velocity, .x = (f32)i);
+		}
+	}
+
+	bool good = count_group(group) == 34;
+
+	for (u32 i = 0; i < 100; i += 6) {
+		remove_component(world, es[i], struct test_velocity);
+	}
+	good = good && count_group(group) == 17;
+
+	for (group_view(group, view)) {
+		destroy_entity(world, view.e);
+	}
+	good = good && count_group(group) == 0 && get_alive_entity_count(world) == 83;
+
+	free_world(world);
+	return good;
+}
+
+bool ecs_nested_group() {
+	struct world* world = new_world();
+
+	entity es[64];
+	for (u32 i = 0; i < 64; i++) {
+		es[i] = new_entity(world);
+		add_componentv(world, es[i], struct test_position, .x = (f32)i);
+		add_componentv(world, es[i], struct test_velocity, .x = (f32)i);
+		if (i % 2 == 0) {
+			add_componentv(world, es[i], struct test_tag, .value = (i32)i);
+		}
+	}
+
+	struct group* outer = get_group(world,
+		type_info(struct test_position), type_info(struct test_velocity));
+	struct group* inner = get_group(world,
+		type_info(struct test_position), type_info(struct test_velocity), type_info(struct test_tag));
+
+	bool good = count_group(outer) == 64 && get_group_size(inner) == 32;
+
+	for (u32 i = 0; i < 64; i += 4) {
+		destroy_entity(world, es[i]);
+	}
+
+	good = good && count_group(outer) == 48 && get_group_size(inner) == 16;
+
+	for (group_view(inner, view)) {
+		struct test_position* p = group_view_get(&view, struct test_position);
+		struct test_tag* t = group_view_get(&view, struct test_tag);
+		good = good && (i32)p->x == t->value;
+	}
+
+	free_world(world);
+	return good;
+}
 
 i32 main() {
+	init_time();
+
 	struct test_func funcs[] = {
 		make_test_func(coroutine),
 		make_test_func(lsp_add),
@@ -485,6 +1555,30 @@ i32 main() {
 		make_test_func(m_v2i_mag),
 		make_test_func(m_make_m4f),
 		make_test_func(m_m4f_identity),
+		make_test_func(fixed_clock),
+		make_test_func(seeded_random),
+		make_test_func(rng_ranges),
+		make_test_func(input_replay),
+		make_test_func(package),
+		make_test_func(shader_uniform_names),
+		make_test_func(renderer_shared_texture),
+		make_test_func(type_registry),
+		make_test_func(type_registry_threads),
+		make_test_func(ecs_pointer_stability),
+		make_test_func(ecs_signature),
+		make_test_func(ecs_commands),
+		make_test_func(ecs_spawn_batch),
+		make_test_func(job_pool),
+		make_test_func(job_rng_streams),
+		make_test_func(ecs_parallel_view),
+		make_test_func(scheduler_order),
+		make_test_func(ecs_soa),
+		make_test_func(ecs_change_tracking),
+		make_test_func(ecs_scene),
+		make_test_func(ecs_snapshot),
+		make_test_func(ecs_rewind),
+		make_test_func(ecs_group),
+		make_test_func(ecs_nested_group),
 	};
 
 	run_tests(funcs, sizeof(funcs) / sizeof(*funcs));